@@ -0,0 +1,84 @@
+#include "allocationCounter.h"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+namespace {
+	// Relaxed, nobody reads these to synchronize with anything:
+	std::atomic<uint64_t> numAllocations{ 0 };
+	std::atomic<uint64_t> numBytes{ 0 };
+	std::atomic<uint64_t> liveBytes{ 0 };
+	std::atomic<uint64_t> peakLiveBytes{ 0 };
+
+	// Every allocation carries its size in front of it so delete knows how much went away.  16 so what new hands
+	// out stays as aligned as malloc's:
+	constexpr std::size_t HEADER_SIZE = 16;
+	static_assert(HEADER_SIZE >= alignof(std::max_align_t), "header would misalign allocations");
+
+	void* countedAlloc(std::size_t size)
+	{
+		numAllocations.fetch_add(1, std::memory_order_relaxed);
+		numBytes.fetch_add(size, std::memory_order_relaxed);
+		uint64_t live = liveBytes.fetch_add(size, std::memory_order_relaxed) + size;
+		uint64_t peak = peakLiveBytes.load(std::memory_order_relaxed);
+		while (live > peak && !peakLiveBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {}
+
+		void* block = std::malloc(size + HEADER_SIZE);
+		if (block == nullptr) {
+			liveBytes.fetch_sub(size, std::memory_order_relaxed);
+			return nullptr;
+		}
+		*static_cast<std::size_t*>(block) = size;
+		return static_cast<char*>(block) + HEADER_SIZE;
+	}
+
+	void countedFree(void* p)
+	{
+		if (p == nullptr) return;
+		void* block = static_cast<char*>(p) - HEADER_SIZE;
+		liveBytes.fetch_sub(*static_cast<std::size_t*>(block), std::memory_order_relaxed);
+		std::free(block);
+	}
+}
+
+AllocationCounts currentAllocationCounts()
+{
+	AllocationCounts c;
+	c.allocations = numAllocations.load(std::memory_order_relaxed);
+	c.bytes = numBytes.load(std::memory_order_relaxed);
+	return c;
+}
+
+HeapUsage currentHeapUsage()
+{
+	HeapUsage u;
+	u.liveBytes = liveBytes.load(std::memory_order_relaxed);
+	u.peakBytes = peakLiveBytes.load(std::memory_order_relaxed);
+	return u;
+}
+
+void resetPeakHeapUsage()
+{
+	peakLiveBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+// The nothrow versions (and std::allocator) end up in these too:
+void* operator new(std::size_t size)
+{
+	void* p = countedAlloc(size);
+	if (p == nullptr) throw std::bad_alloc();
+	return p;
+}
+
+void* operator new[](std::size_t size)
+{
+	void* p = countedAlloc(size);
+	if (p == nullptr) throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept { countedFree(p); }
+void operator delete[](void* p) noexcept { countedFree(p); }
+void operator delete(void* p, std::size_t) noexcept { countedFree(p); }
+void operator delete[](void* p, std::size_t) noexcept { countedFree(p); }
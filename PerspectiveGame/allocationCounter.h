@@ -0,0 +1,33 @@
+#pragma once
+#include <cstdint>
+#include <cstddef>
+
+// allocationCounter.cpp replaces the global operator new/delete with ones that count on their way to malloc/free,
+// so anything can see how many heap allocations a piece of code made (the micro benchmarks report it per op).
+// Counts are for the whole process, every thread, since startup.  Over-aligned news aren't counted.
+// It also keeps how many of those bytes are still live and the most that ever were at once.
+// It's linked into the game too, on purpose: the Memory debug panel and the scenario timings show the heap's live
+// and peak bytes.  That costs every allocation a few relaxed atomics and 16 bytes of header.
+struct AllocationCounts {
+	uint64_t allocations = 0;
+	uint64_t bytes = 0; // asked for, not what malloc actually used.
+
+	AllocationCounts operator-(const AllocationCounts& other) const
+	{
+		AllocationCounts c;
+		c.allocations = allocations - other.allocations;
+		c.bytes = bytes - other.bytes;
+		return c;
+	}
+};
+
+AllocationCounts currentAllocationCounts();
+
+struct HeapUsage {
+	uint64_t liveBytes = 0;
+	uint64_t peakBytes = 0;
+};
+
+HeapUsage currentHeapUsage();
+// So a peak can be taken over just a part of the run (a scenario, say):
+void resetPeakHeapUsage();
@@ -1,6 +1,5 @@
 #pragma once
 
-//#define RUNNING_TEST_SCENARIOS
 #define RUNNING_DEBUG
 
 #include<iostream>
@@ -8,6 +7,7 @@
 #include<iomanip>
 #include <stdlib.h>
 #include <time.h>
+#include <thread>
 
 #include"dependancyHeaders.h"
 
@@ -30,8 +30,15 @@
 #include "scenarioSetup.h"
 #include "forceManager.h"
 #include "pov.h"
+#include "profiler.h"
+#include "headlessContext.h"
+#include "benchmark.h"
+#include "simulation.h"
+#include "memoryAccounting.h"
+#include "allocationCounter.h"
 
 struct App {
+	HeadlessContext headlessContext; // first so it's the last thing torn down.
 	Window window;
 	#ifdef USE_GUI_WINDOW
 	Window imGuiWindow;
@@ -53,11 +60,20 @@ struct App {
 	
 	TileNodeNetwork* p_nodeNetwork;
 	POV* p_pov;
+	Simulation simulation;
+
+	// Set before run() to go round these scenarios (see scenarioSetup.h) instead of the usual world:
+	std::vector<std::string> scenarioFiles;
+	int currentScenario = -1;
+	int scenarioStartTick = 0;
+	int scenarioTicks = 0;
+	ScenarioTiming scenarioTiming;
 
 	App() {}
 
 	~App()
 	{
+		simulation.stop(); // before the world it runs goes away.
 		delete p_guiManager;
 		delete p_wave;
 		//delete p_tileManager;
@@ -86,11 +102,39 @@ struct App {
 
 		ImGui::SetCurrentContext(ImGui::GetCurrentContext());
 
-		framebuffer.init();
-
 		initGlobalVariables(window.window);
 		glfwSetScrollCallback(window.window, scroll_callback);
 
+		#ifdef USE_GUI_WINDOW
+		initScene(imGuiWindow.window);
+		#else
+		initScene(nullptr);
+		#endif
+
+		int bufferWidth, bufferHeight;
+		glfwGetFramebufferSize(window.window, &bufferWidth, &bufferHeight);
+		glViewport(0, 0, bufferWidth, bufferHeight);
+
+		return true;
+	}
+
+	// Same as init() but with nothing on screen and no ImGui window, for runBenchmark() and runScenarios():
+	bool initHeadless(HeadlessBackend backend)
+	{
+		if (!headlessContext.init(backend, WindowSize)) return false;
+		window.window = headlessContext.window;
+
+		initGlobalVariables(nullptr);
+		initScene(nullptr);
+		glViewport(0, 0, WindowSize.x, WindowSize.y);
+		return true;
+	}
+
+	// Everything after the windows and context exist:
+	void initScene(GLFWwindow* imGuiWindowPtr)
+	{
+		framebuffer.init();
+
 		inputManager.init(window.window);
 		shaderManager.init();
 		vertManager.init(&shaderManager);
@@ -108,6 +152,7 @@ struct App {
 		//p_tileManager->texID = p_wave->ID;
 		
 		p_nodeNetwork = new TileNodeNetwork(&camera, &forceManager);
+		p_nodeNetwork->initGpuBuffers();
 		p_nodeNetwork->texID = p_wave->ID;
 
 		p_pov = new POV(p_nodeNetwork, &camera, &p_buttonManager->buttons[ButtonManager::pov3d3rdPersonViewButtonIndex]);
@@ -115,30 +160,27 @@ struct App {
 		//p_forceManager = new ForceManager(p_tileManager);
 
 		p_entityManager = new EntityManager(p_nodeNetwork, &forceManager);
+		p_entityManager->initGpuBuffers();
+		simulation.init(p_nodeNetwork, p_entityManager, p_pov);
 
 		p_currentSelection = new CurrentSelection(&inputManager, p_entityManager, p_buttonManager, 
 												  &camera, p_basisManager, p_nodeNetwork, p_pov);
+		simulation.p_selectionPov = p_currentSelection->addTileParentPOV;
 
 		#ifdef USE_GUI_WINDOW
-		p_guiManager = new GuiManager(window.window, imGuiWindow.window, &shaderManager, &inputManager, &camera,
+		p_guiManager = new GuiManager(window.window, imGuiWindowPtr, &shaderManager, &inputManager, &camera,
 									  &framebuffer, p_buttonManager, p_currentSelection, p_entityManager, 
-									  p_nodeNetwork, p_pov);
+									  p_nodeNetwork, p_pov, &simulation);
 		#else
 		p_guiManager = new GuiManager(window.window, nullptr, &shaderManager, &inputManager, &camera, p_tileManager, &framebuffer, p_buttonManager);
 		#endif
-		glfwMakeContextCurrent(window.window);
+		if (window.window != nullptr) glfwMakeContextCurrent(window.window);
 
-		int bufferWidth, bufferHeight;
-		glfwGetFramebufferSize(window.window, &bufferWidth, &bufferHeight);
-
-		glViewport(0, 0, bufferWidth, bufferHeight);
 		p_guiManager->io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 
 		srand((unsigned int)time(NULL));
 
 		setupWorld();
-
-		return true;
 	}
 
 	void setupWorld()
@@ -154,35 +196,30 @@ struct App {
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 	}
 
+	// The input thread's side of the world.  The pov and the selection only read it, so they run alongside the
+	// simulation, just not while it's changing things: then they skip a frame rather than wait for an edit to finish.
+	// Clicks still get queued from the last selection.  The rest of updating the world is Simulation::step().
 	void updateWorld()
 	{
-		//p_tileManager->update();
-		p_pov->update();
-		p_nodeNetwork->update();
-		p_currentSelection->tryEditWorld();
-
-		if ((TimeSinceProgramStart - LastUpdateTime) > UpdateTime) {
-
-			if (CurrentTick % 4 == 0) {
-				//p_currentSelection->tryEditWorld();
-				//p_currentSelection->addQueuedEntities();
-				//p_forceManager->update();
-				//p_basisManager->update();
+		{
+			std::shared_lock<std::shared_mutex> world(simulation.worldMutex, std::try_to_lock);
+			if (world.owns_lock()) {
+				updatePov();
+				PROFILE_SCOPE(PROFILE_PHASE_SELECTION_UPDATE);
+				p_currentSelection->update();
 			}
-
-			p_entityManager->moveEntities();
-			//p_tileManager->updateTileGpuInfos();
-			//p_entityManager->updateGpuInfos();
-
-			LastUpdateTime = TimeSinceProgramStart;
-			CurrentTick++;
-
-			#ifdef RUNNING_TEST_SCENARIOS
-			TICKS_IN_SCENARIO++;
-			#endif
 		}
+		p_currentSelection->tryEditWorld();
+		simulation.queueEdits(p_currentSelection->queuedEdits);
 
-		p_entityManager->updateAllGpuTiles();
+		if (!simulation.isRunning()) simulation.step(TimeSinceProgramStart);
+	}
+
+	// Needs simulation.worldMutex, unless the simulation isn't running:
+	void updatePov()
+	{
+		p_pov->update();
+		p_guiManager->livePov = simulation.capturePov();
 	}
 
 	void updateGui()
@@ -192,51 +229,264 @@ struct App {
 		#endif
 		updateGraphicsAPI();
 		p_guiManager->render();
-		glfwSwapBuffers(window.window);
+		{
+			PROFILE_SCOPE(PROFILE_PHASE_SWAP_BUFFERS);
+			glfwSwapBuffers(window.window);
+		}
 
 		#ifdef USE_GUI_WINDOW
 		glfwMakeContextCurrent(imGuiWindow.window);
 		updateGraphicsAPI();
-		p_guiManager->renderImGuiDebugWindows();
-		glfwSwapBuffers(imGuiWindow.window);
+		{
+			PROFILE_SCOPE(PROFILE_PHASE_IMGUI);
+			p_guiManager->renderImGuiDebugWindows();
+		}
+		{
+			PROFILE_SCOPE(PROFILE_PHASE_SWAP_BUFFERS);
+			glfwSwapBuffers(imGuiWindow.window);
+		}
 		#endif
 	}
 
+	// Flies the camera along the path with a fixed time step and no input, timing every frame.  Game time is
+	// simulated so entity movement (and so the image hashes) is the same run to run.
+	bool runBenchmark(const BenchmarkSettings& settings)
+	{
+		CameraPath path;
+		if (!path.load(settings.cameraPathFile.c_str())) return false;
+		if (!settings.scenarioFile.empty()) {
+			Scenario scenario;
+			if (!scenario.load(settings.scenarioFile)) return false;
+			ScenarioTiming loaded = simulation.loadScenario(scenario);
+			std::cout << "Benchmarking over " << loaded.name << ": " << loaded.numTilePairs << " tile pairs, "
+				<< loaded.numEntities << " entities" << std::endl;
+		}
+
+		float dt = 1.0f / settings.frameRate;
+		int numFrames = settings.numFrames > 0 ? settings.numFrames : (int)(path.duration() * settings.frameRate) + 1;
+		std::vector<BenchmarkFrame> frames(numFrames);
+		std::vector<unsigned char> pixels;
+
+		CurrentFrame = 0;
+		CurrentTick = 0;
+		TimeSinceProgramStart = 0;
+		LastUpdateTime = 0;
+		DeltaTime = dt;
+		CameraPath::Key last = path.sample(0);
+		camera.viewPlanePos += glm::vec3(last.offset, 0);
+
+		// GpuTimer tags each result with the profiler frame that issued it, frame f here is firstProfilerFrame + f:
+		uint32_t firstProfilerFrame = GlobalProfiler.currentFrame;
+		int gpuSamples[NUM_GPU_PASSES] = {};
+		int entityPassFrames = 0; // that pass only runs when the view is small enough to unfold.
+
+		// Extra frames at the end so the last real frames' gpu timers get read back (they're two frames late):
+		int numDrainFrames = GpuTimer::NUM_QUERY_SETS;
+		for (int frame = 0; frame < numFrames + numDrainFrames; frame++) {
+			int gpuSamplesBefore[NUM_GPU_PASSES];
+			std::copy(GlobalProfiler.gpuNumSamples, GlobalProfiler.gpuNumSamples + NUM_GPU_PASSES, gpuSamplesBefore);
+
+			auto start = std::chrono::high_resolution_clock::now();
+			{
+				PROFILE_SCOPE(PROFILE_PHASE_FRAME);
+				CameraPath::Key key = path.sample(frame * dt);
+				camera.viewPlanePos += glm::vec3(key.offset - last.offset, 0);
+				camera.zoom = key.zoom;
+				camera.yaw = key.yaw;
+				last = key;
+				{
+					PROFILE_SCOPE(PROFILE_PHASE_CAMERA_UPDATE);
+					camera.getProjectionMatrix();
+					camera.updateWindowFrustum();
+				}
+				// No simulation thread here, so every frame sees the same ticks run to run:
+				updatePov();
+				simulation.step(TimeSinceProgramStart);
+				p_guiManager->render();
+			}
+			GlobalProfiler.endFrame();
+			auto end = std::chrono::high_resolution_clock::now();
+
+			for (int p = 0; p < NUM_GPU_PASSES; p++) {
+				if (GlobalProfiler.gpuNumSamples[p] == gpuSamplesBefore[p]) continue;
+				int issued = (int)(GlobalProfiler.gpuLastSampleFrame[p] - firstProfilerFrame);
+				if (issued < 0 || issued >= numFrames) continue;
+				frames[issued].gpuMs[p] = GlobalProfiler.lastGpuSample((GpuPass)p);
+				gpuSamples[p]++;
+			}
+			if (frame >= numFrames) continue;
+			if (p_guiManager->drawingEntityInstances) entityPassFrames++;
+
+			frames[frame].cpuMs = std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count();
+			if (settings.hashImages) {
+				frames[frame].imageHashes[0] = hashRenderTarget(RENDER_TARGET_POV_2D_3RD_PERSON, pixels);
+				frames[frame].imageHashes[1] = hashRenderTarget(RENDER_TARGET_POV_3D_3RD_PERSON, pixels);
+			}
+			if (window.window != nullptr) glfwSwapBuffers(window.window);
+
+			TimeSinceProgramStart += dt;
+			CurrentFrame++;
+		}
+
+		// A result that wasn't ready in time is dropped, and a frame without all its timings isn't worth comparing:
+		bool allSamples = true;
+		for (int p = 0; p < NUM_GPU_PASSES; p++) {
+			if (gpuSamples[p] == 0) continue; // pass never ran here (imgui).
+			int expected = p == GPU_PASS_2D_ENTITIES ? entityPassFrames : numFrames;
+			if (gpuSamples[p] == expected) continue;
+			std::cout << "ERROR::BENCHMARK:: " << GPU_PASS_NAMES[p] << " got " << gpuSamples[p]
+				<< " gpu samples for " << expected << " frames" << std::endl;
+			allSamples = false;
+		}
+
+		return writeBenchmarkReport(settings, frames) && allSamples;
+	}
+
+	// Once the current scenario has had its ticks, logs how it went and loads the next one (going back round
+	// to the first).  Files are read again every time round, so they can be changed while it runs.
+	void updateScenarios(float lastFrameMs)
+	{
+		if (scenarioFiles.empty()) return;
+		if (currentScenario != -1) {
+			scenarioTiming.frames++;
+			scenarioTiming.frameMs += lastFrameMs; // summed until it's logged.
+			// The simulation thread's tick, as of the snapshot this frame drew:
+			int tick = simulation.snapshots.read().tick;
+			if (tick - scenarioStartTick < scenarioTicks) return;
+			scenarioTiming.ticks = tick - scenarioStartTick;
+			scenarioTiming.frameMs /= std::max(scenarioTiming.frames, 1);
+			scenarioTiming.recordMemory(simulation.snapshots.read().memory, GlobalGlBufferMemory.total, currentHeapUsage().peakBytes);
+			printScenarioTiming(scenarioTiming);
+		}
+
+		// Skips files that don't load, and stops cycling if none do:
+		for (int tries = 0; tries < (int)scenarioFiles.size(); tries++) {
+			currentScenario = (currentScenario + 1) % (int)scenarioFiles.size();
+			Scenario scenario;
+			if (!scenario.load(scenarioFiles[currentScenario])) continue;
+			scenarioTiming = simulation.loadScenario(scenario);
+			scenarioTiming.tickMs = -1; // the simulation thread ticks on its own time here.
+			resetPeakHeapUsage();
+			scenarioTicks = scenario.ticks;
+			scenarioStartTick = simulation.snapshots.read().tick;
+			return;
+		}
+		std::cout << "ERROR::APP:: none of the scenarios load" << std::endl;
+		scenarioFiles.clear();
+	}
+
+	// Every scenario's ticks back to back with nothing on screen (after initHeadless()), one tick a frame with
+	// simulated game time like runBenchmark(), so it's the same run to run.  Writes a csv row per scenario.
+	bool runScenarios(const std::vector<std::string>& files, const std::string& outputFile)
+	{
+		using clock = std::chrono::steady_clock;
+		CurrentFrame = 0;
+		CurrentTick = 0;
+		TimeSinceProgramStart = 0;
+		LastUpdateTime = 0;
+		DeltaTime = UpdateTime;
+
+		bool allLoaded = true;
+		std::vector<ScenarioTiming> timings;
+		for (const std::string& path : files) {
+			Scenario scenario;
+			if (!scenario.load(path)) {
+				allLoaded = false;
+				continue;
+			}
+			ScenarioTiming timing = simulation.loadScenario(scenario);
+			resetPeakHeapUsage();
+			float stepMs = 0, frameMs = 0;
+			for (int tick = 0; tick < scenario.ticks; tick++) {
+				// Exactly one tick's worth of game time, so every step ticks:
+				TimeSinceProgramStart = LastUpdateTime + UpdateTime;
+				auto start = clock::now();
+				{
+					PROFILE_SCOPE(PROFILE_PHASE_FRAME);
+					updatePov();
+					auto stepStart = clock::now();
+					simulation.step(TimeSinceProgramStart);
+					stepMs += std::chrono::duration<float, std::milli>(clock::now() - stepStart).count();
+					p_guiManager->render();
+				}
+				GlobalProfiler.endFrame();
+				frameMs += std::chrono::duration<float, std::milli>(clock::now() - start).count();
+				if (window.window != nullptr) glfwSwapBuffers(window.window);
+				CurrentFrame++;
+			}
+			timing.ticks = timing.frames = scenario.ticks;
+			timing.tickMs = stepMs / scenario.ticks;
+			timing.frameMs = frameMs / scenario.ticks;
+			timing.recordMemory(simulation.snapshots.read().memory, GlobalGlBufferMemory.total, currentHeapUsage().peakBytes);
+			printScenarioTiming(timing);
+			timings.push_back(timing);
+		}
+
+		std::ofstream file(outputFile);
+		if (!file.is_open()) {
+			std::cout << "ERROR::APP:: could not open " << outputFile << std::endl;
+			return false;
+		}
+		file << "scenario,tile_pairs,entities,load_ms,ticks,tick_ms,frame_ms,memory_bytes,peak_memory_bytes,"
+			"bytes_per_tile_pair,gl_buffer_bytes,peak_heap_bytes\n";
+		for (const ScenarioTiming& t : timings) {
+			file << t.name << "," << t.numTilePairs << "," << t.numEntities << "," << t.loadMs << "," << t.ticks << ","
+				<< t.tickMs << "," << t.frameMs << "," << t.memoryBytes << "," << t.peakMemoryBytes << ","
+				<< t.bytesPerTilePair << "," << t.glBufferBytes << "," << t.peakHeapBytes << "\n";
+		}
+		std::cout << "Scenario timings written to " << outputFile << std::endl;
+		return allLoaded && !timings.empty();
+	}
+
+	uint64_t hashRenderTarget(RenderTargetID id, std::vector<unsigned char>& pixels)
+	{
+		RenderTarget& target = framebuffer.renderTargets[id];
+		if (target.FBO == 0) return 0;
+		pixels.resize((size_t)target.desc.size.x * target.desc.size.y * 4);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, target.FBO);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, target.desc.size.x, target.desc.size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		return hashBytes(pixels.data(), pixels.size());
+	}
+
 	void run()
 	{
 		int counter = 0;
+		float lastFrameTime = 0;
 		int lastFPS = 0;
 		float runningFPS = 0;
 		float lastUpdateTime = 0;
 		CurrentFrame = 0;
 		CurrentTick = 0;
+		simulation.start();
 
 		while (!glfwWindowShouldClose(window.window)) {
 			auto start = std::chrono::high_resolution_clock::now();
-
-			#ifdef RUNNING_TEST_SCENARIOS
-			if (CURRENT_SCENARIO_ID == 0 || TICKS_IN_SCENARIO > ticksPerScenario(CURRENT_SCENARIO_ID)) {
-				setupTestScenario(CURRENT_SCENARIO_ID % NUM_OF_SCENARIOS, p_tileManager, p_entityManager, p_currentSelection);
-				CURRENT_SCENARIO_ID++;
-				TICKS_IN_SCENARIO = 0;
+			{
+				PROFILE_SCOPE(PROFILE_PHASE_FRAME);
+
+				updateScenarios(lastFrameTime);
+
+				updateGlobalVariables(window.window);
+				inputManager.update();
+				p_buttonManager->updateButtons();
+				{
+					PROFILE_SCOPE(PROFILE_PHASE_CAMERA_UPDATE);
+					camera.update();
+				}
+				updateWorld();
+				//p_tileManager->updateVisualInfos();
+
+				updateGui();
 			}
-			#endif
-
-			updateGlobalVariables(window.window);
-			inputManager.update();
-			p_buttonManager->updateButtons();
-			camera.update();
-			
-			p_currentSelection->update();
-			updateWorld();
-			//p_tileManager->updateVisualInfos();
-
-			updateGui();
+			GlobalProfiler.endFrame();
 
 			auto end = std::chrono::high_resolution_clock::now();
 			float thisFrameTime = std::chrono::duration<float, std::chrono::milliseconds::period>(end - start).count();
+			lastFrameTime = thisFrameTime;
 			//std::cout << FrameTime << std::endl;
-			Sleep((DWORD)std::max(16.0f - FrameTime, 0.0f));
+			std::this_thread::sleep_for(std::chrono::duration<float, std::milli>(std::max(16.0f - FrameTime, 0.0f)));
 			CurrentFrame++;
 
 			counter++;
@@ -248,5 +498,6 @@ struct App {
 				runningFPS = 0;
 			}
 		}
+		simulation.stop();
 	}
 };
\ No newline at end of file
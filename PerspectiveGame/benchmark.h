@@ -0,0 +1,144 @@
+#pragma once
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "profiler.h"
+
+// A scripted camera for App::runBenchmark().  Text file, one key per line (# starts a comment):
+//   time(s)  x  y  zoom  yaw
+// x and y are how far the camera has moved since the start, not a position, since the pov's tile space
+// wraps every time it crosses into a new tile.  Keys are lerped between and must be in time order.
+struct CameraPath {
+	struct Key {
+		float time;
+		glm::vec2 offset;
+		float zoom;
+		float yaw;
+	};
+	std::vector<Key> keys;
+
+	float duration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+	bool load(const char* path)
+	{
+		std::ifstream file(path);
+		if (!file.is_open()) {
+			std::cout << "ERROR::CAMERA_PATH:: could not open " << path << std::endl;
+			return false;
+		}
+		keys.clear();
+		std::string line;
+		for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+			line = line.substr(0, line.find('#'));
+			if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+			std::istringstream in(line);
+			Key k;
+			if (!(in >> k.time >> k.offset.x >> k.offset.y >> k.zoom >> k.yaw)) {
+				std::cout << "ERROR::CAMERA_PATH:: " << path << ":" << lineNumber << " wants 'time x y zoom yaw'" << std::endl;
+				return false;
+			}
+			if (!keys.empty() && k.time < keys.back().time) {
+				std::cout << "ERROR::CAMERA_PATH:: " << path << ":" << lineNumber << " goes back in time" << std::endl;
+				return false;
+			}
+			keys.push_back(k);
+		}
+		if (keys.empty()) {
+			std::cout << "ERROR::CAMERA_PATH:: " << path << " has no keys" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	Key sample(float t) const
+	{
+		if (t <= keys.front().time) return keys.front();
+		if (t >= keys.back().time) return keys.back();
+		int i = 1;
+		while (keys[i].time < t) i++;
+		const Key& a = keys[i - 1];
+		const Key& b = keys[i];
+		float w = (b.time > a.time) ? (t - a.time) / (b.time - a.time) : 1.0f;
+		return { t, glm::mix(a.offset, b.offset, w), glm::mix(a.zoom, b.zoom, w), glm::mix(a.yaw, b.yaw, w) };
+	}
+};
+
+struct BenchmarkSettings {
+	std::string cameraPathFile;
+	std::string scenarioFile; // the world to fly over (see scenarioSetup.h), empty is just the starting tile pair.
+	std::string outputFile = "benchmark.csv";
+	float frameRate = 60.0f; // simulated, frames are rendered back to back with this much game time between them.
+	int numFrames = 0; // 0 runs the whole path.
+	bool hashImages = true; // reads the render targets back every frame, which stalls, but not inside the timed part.
+};
+
+struct BenchmarkFrame {
+	float cpuMs = 0;
+	float gpuMs[NUM_GPU_PASSES]; // -1 if the query didn't come back (or the pass didn't run).
+	uint64_t imageHashes[2] = {}; // 2D and 3D views.
+
+	BenchmarkFrame() { std::fill(std::begin(gpuMs), std::end(gpuMs), -1.0f); }
+};
+
+// FNV-1a, plenty for telling whether two runs drew the same thing:
+inline uint64_t hashBytes(const unsigned char* data, size_t size, uint64_t h = 14695981039346656037ull)
+{
+	for (size_t i = 0; i < size; i++) {
+		h ^= data[i];
+		h *= 1099511628211ull;
+	}
+	return h;
+}
+
+// One csv row a frame, then a summary to stdout:
+inline bool writeBenchmarkReport(const BenchmarkSettings& settings, const std::vector<BenchmarkFrame>& frames)
+{
+	std::ofstream file(settings.outputFile);
+	if (!file.is_open()) {
+		std::cout << "ERROR::BENCHMARK:: could not open " << settings.outputFile << std::endl;
+		return false;
+	}
+
+	file << "frame,cpu_ms";
+	for (int p = 0; p < NUM_GPU_PASSES; p++) file << ",gpu_ms " << GPU_PASS_NAMES[p];
+	file << ",hash_2d,hash_3d\n";
+	for (int i = 0; i < (int)frames.size(); i++) {
+		const BenchmarkFrame& f = frames[i];
+		file << i << "," << f.cpuMs;
+		for (int p = 0; p < NUM_GPU_PASSES; p++) file << "," << f.gpuMs[p];
+		file << std::hex << "," << f.imageHashes[0] << "," << f.imageHashes[1] << std::dec << "\n";
+	}
+
+	auto summarize = [&](const char* name, auto getMs) {
+		std::vector<float> ms;
+		for (const BenchmarkFrame& f : frames) {
+			float t = getMs(f);
+			if (t >= 0) ms.push_back(t);
+		}
+		if (ms.empty()) return;
+		std::sort(ms.begin(), ms.end());
+		float sum = 0;
+		for (float t : ms) sum += t;
+		auto percentile = [&](float q) { return ms[std::min((int)(q * ms.size()), (int)ms.size() - 1)]; };
+		std::cout << "  " << name << ": avg " << sum / ms.size() << " p50 " << percentile(0.5f)
+			<< " p95 " << percentile(0.95f) << " max " << ms.back() << " ms\n";
+	};
+	std::cout << "Benchmark: " << frames.size() << " frames of " << settings.cameraPathFile << " over "
+		<< (settings.scenarioFile.empty() ? "the starting tile pair" : settings.scenarioFile) << "\n";
+	summarize("cpu", [](const BenchmarkFrame& f) { return f.cpuMs; });
+	for (int p = 0; p < NUM_GPU_PASSES; p++) {
+		summarize(GPU_PASS_NAMES[p], [p](const BenchmarkFrame& f) { return f.gpuMs[p]; });
+	}
+	std::cout << "  per frame results in " << settings.outputFile << std::endl;
+	return true;
+}
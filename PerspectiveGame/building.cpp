@@ -1,4 +1,4 @@
-//#include "building.h"
+//#include "Building.h"
 //#include "tile.h"
 //
 //Building::Building(Building::Side orientation, Building::Type buildingType, Tile *parentTile) :
@@ -23,7 +23,6 @@ public:
 
 	std::vector<Button> buttons;
 	const static int pov2d3rdPersonViewButtonIndex = 0;
-	int pov2d3rdPersonViewTexId;
 	const static int pov3d3rdPersonViewButtonIndex = 1;
 
 	// Used for when hovering over a button:
@@ -37,8 +36,6 @@ public:
 public:
 	ButtonManager(Framebuffer *fb, ShaderManager *sm, GLFWwindow* w, InputManager *im) 
 		: p_framebuffer(fb), p_shaderManager(sm), p_window(w), p_inputManager(im) {
-		
-		pov2d3rdPersonViewTexId = p_framebuffer->pov2D3rdPersonTextureID;
 
 		Button pov2d3rdPersonViewButton;
 		pov2d3rdPersonViewButton.size = glm::ivec2(10, 10);
@@ -192,23 +189,13 @@ public:
 		glDisable(GL_BLEND);
 		glViewport(0, 0, WindowSize.x, WindowSize.y);
 
-		glBindVertexArray(p_framebuffer->VAO);
-		glBindBuffer(GL_ARRAY_BUFFER, p_framebuffer->VBO);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p_framebuffer->EBO);
-
 		std::vector<GLfloat> verts;
 		if (button.hasTexture) {
-			setVertAttribVec3PosVec3NormVec3ColorVec2TextCoord();
 			p_shaderManager->simpleShader.use();
 
-			GLuint transfMatrixID = glGetUniformLocation(p_shaderManager->simpleShader.ID, "inTransfMatrix");
-			glUniformMatrix4fv(transfMatrixID, 1, GL_FALSE, glm::value_ptr(glm::mat4(1)));
-
-			GLuint alphaID = glGetUniformLocation(p_shaderManager->simpleShader.ID, "inAlpha");
-			glUniform1f(alphaID, 0.0f);
-
-			GLuint colorAlphaID = glGetUniformLocation(p_shaderManager->simpleShader.ID, "inColorAlpha");
-			glUniform1f(colorAlphaID, 0.0f);
+			p_shaderManager->simpleUniforms.inTransfMatrix.set(glm::mat4(1));
+			p_shaderManager->simpleUniforms.inAlpha.set(0.0f);
+			p_shaderManager->simpleUniforms.inColorAlpha.set(0.0f);
 
 			glActiveTexture(GL_TEXTURE0);
 			glBindTexture(GL_TEXTURE_2D, texId);
@@ -232,7 +219,6 @@ public:
 				verts.push_back(button.texCoords[i].y);
 			}
 		} else {
-			setVertAttribVec2PosVec2TexCoordVec3Color();
 			p_shaderManager->justVertsAndColors.use();
 
 			for (int i = 0; i < 4; i++) {
@@ -253,10 +239,14 @@ public:
 			0, 1, 3, 1, 2, 3,
 		};
 
-		//glActiveTexture(GL_TEXTURE0);
-		//glBindTexture(GL_TEXTURE_2D, texID);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * verts.size(), verts.data(), GL_DYNAMIC_DRAW);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
-		glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
+		StreamBuffer& stream = p_framebuffer->streamBuffer;
+		GLsizei vertStride = (GLsizei)(sizeof(GLfloat) * verts.size() / 4);
+		StreamAllocation alloc = stream.uploadIndexed(verts.data(), sizeof(GLfloat) * verts.size(), vertStride,
+													  indices.data(), sizeof(GLuint) * indices.size());
+		stream.bind();
+		if (button.hasTexture) setVertAttribVec3PosVec3NormVec3ColorVec2TextCoord();
+		else                   setVertAttribVec2PosVec2TexCoordVec3Color();
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT,
+								 alloc.indexOffset(), alloc.baseVertex());
 	}
 };
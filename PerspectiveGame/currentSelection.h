@@ -11,6 +11,8 @@
 #include "cameraManager.h"
 #include "tileNodeNetwork.h"
 #include "pov.h"
+#include "stepHistogram.h"
+#include "worldEdit.h"
 
 struct QueuedEntity {
 	int tileIndex;
@@ -41,7 +43,10 @@ struct CurrentSelection {
 	POV* p_pov;
 
 	CenterNode* hoveredTile;
+	int hoveredTileIndex = -1; // hoveredTile's tile as of the last update(), safe to use without the world locked.
 	int	hoveredTileConnectionIndex;
+	bool cursorIn3DView = false;
+	int hoveredTile3DIndex = -1; // tile under the cursor in the 3D view, -1 if none.  Like hoveredTileIndex, safe unlocked.
 	POV* addTileParentPOV;
 	LocalDirection addTileParentAddDirection;
 
@@ -53,6 +58,7 @@ struct CurrentSelection {
 	LocalDirection heldEntityDirection;
 
 	std::vector<QueuedEntity> queuedEntities;
+	std::vector<WorldEdit> queuedEdits; // handed to the simulation every frame, see App::updateWorld().
 
 	bool canEditEntities;
 	bool canEditBases;
@@ -64,6 +70,10 @@ struct CurrentSelection {
 
 	bool leftClick = false;
 
+	// Steps the cursor raycast in findHoveredTile() takes, since the last reset:
+	static const int MAX_CURSOR_RAY_STEPS = 1000;
+	StepHistogram cursorRaySteps{ MAX_CURSOR_RAY_STEPS };
+
 	CurrentSelection(InputManager* im, EntityManager* em, ButtonManager* bm, Camera* (cam),
 					 BasisManager* bam, TileNodeNetwork* nn, POV* pov) : p_inputManager(im),
 		p_entityManager(em), p_buttonManager(bm), p_camera(cam), p_basisManager(bam), p_nodeNetwork(nn), p_pov(pov)
@@ -135,11 +145,11 @@ struct CurrentSelection {
 		runningDist.x = goingEast ? (1.0f - povPos.x) * stepDist.x : povPos.x * stepDist.x;
 		runningDist.y = goingNorth ? (1.0f - povPos.y) * stepDist.y : povPos.y * stepDist.y;
 
-		const int MAX_STEPS = 1000; int stepCount = 0;
+		int stepCount = 0;
 		float currentDist = 0;
 
 		// Raycast:
-		while (stepCount++ < MAX_STEPS) {
+		while (stepCount++ < MAX_CURSOR_RAY_STEPS) {
 			if (runningDist.x > totalDist && runningDist.y > totalDist) break; // We have arrived!
 			
 			if (runningDist.x < runningDist.y) {
@@ -155,6 +165,30 @@ struct CurrentSelection {
 			targetPOV.shiftTileSimple(addTileParentAddDirection);
 		}
 		hoveredTile = targetPOV.getNode();
+		cursorRaySteps.add(stepCount - 1);
+	}
+
+	// Casts a ray from the cursor through the 3D view and asks the node network's bvh what it hits.
+	void findHoveredTile3D()
+	{
+		hoveredTile3DIndex = -1;
+		Button* view3D = &p_buttonManager->buttons[ButtonManager::pov3d3rdPersonViewButtonIndex];
+		cursorIn3DView = view3D->isHoveredOver(CursorPixelPos) != BUTTON_AREA_OUTSIDE;
+		if (!cursorIn3DView) return;
+
+		glm::vec2 buttonPixelPos = Button::guiGridUnitSpaceToPixelSpace(view3D->pos);
+		glm::vec2 ndc = 2.0f * (glm::vec2(CursorPixelPos) - buttonPixelPos)
+			/ glm::vec2(view3D->pixelWidth(), view3D->pixelHeight()) - 1.0f;
+
+		// depth is [0, 1] so those are the near and far planes:
+		glm::mat4 inverseView = glm::inverse(p_pov->finalRotation);
+		glm::vec4 nearPos = inverseView * glm::vec4(ndc, 0, 1);
+		glm::vec4 farPos = inverseView * glm::vec4(ndc, 1, 1);
+		glm::vec3 origin = glm::vec3(nearPos) / nearPos.w;
+		glm::vec3 dir = glm::normalize(glm::vec3(farPos) / farPos.w - origin);
+
+		Tile* tile = p_nodeNetwork->pickTile(origin, dir);
+		if (tile != nullptr) hoveredTile3DIndex = tile->index;
 	}
 
 	void findPreviewTile()
@@ -187,24 +221,25 @@ struct CurrentSelection {
 		heldTileInfo = Tile(newTileType,-1, -1, -1, color);
 	}
 
+	// Only queues the edit up, the simulation thread does it (and checks the pov isn't on the tile being removed):
 	void tryEditTiles()
 	{
 		using namespace tnav;
 
+		// In the 3D view the preview tile (from the 2D cursor) isn't where the cursor is, so only removing works there:
+		if (cursorIn3DView) {
+			if (p_inputManager->rightClicked() && hoveredTile3DIndex != -1) {
+				queuedEdits.push_back(WorldEdit::removeTilePair(hoveredTile3DIndex));
+			}
+			return;
+		}
+
 		if (p_inputManager->leftClicked()) {
-			p_nodeNetwork->createTilePair(heldTilePos, tnav::getSuperTileType(heldTileInfo.type));
-			
-			p_nodeNetwork->printSize();
-			p_nodeNetwork->printCornerNodePositions();
+			queuedEdits.push_back(WorldEdit::createTilePair(heldTilePos, tnav::getSuperTileType(heldTileInfo.type)));
 		}
-		else if (p_inputManager->rightClicked()) {
-			CenterNode* sibling = static_cast<CenterNode*>(p_nodeNetwork->getNode(p_nodeNetwork->getTile(p_pov->getTile()->siblingIndex)->centerNodeIndex));
-			if (hoveredTile != p_pov->getNode() && hoveredTile != sibling)
-				p_nodeNetwork->removeTilePair(p_nodeNetwork->getTile(hoveredTile->getTileIndex()));
+		else if (p_inputManager->rightClicked() && hoveredTileIndex != -1) {
+			queuedEdits.push_back(WorldEdit::removeTilePair(hoveredTileIndex));
 			//p_tileManager->deleteTilePair(hoveredTile, false);
-
-			p_nodeNetwork->printSize();
-			//p_nodeNetwork->printCornerNodePositions();
 		}
 	}
 	void tryEditBases()
@@ -250,6 +285,8 @@ struct CurrentSelection {
 	void update()
 	{
 		findHoveredTile();
+		hoveredTileIndex = (hoveredTile != nullptr) ? hoveredTile->getTileIndex() : -1;
+		findHoveredTile3D();
 		findPreviewTile();
 
 		if (p_inputManager->keys[ROTATE_KEY].click) {
@@ -1,11 +1,16 @@
 #pragma once
 #ifndef VAGUE_HEADERS_DEFINED
 
+#ifdef _WIN32
 #define NOMINMAX
 #define USING_WINDOWS
 #include "Windows.h"
+#endif
 
 	#include<iostream>
+	// Windows.h brings these in, everywhere else they have to be asked for:
+	#include <cfloat>
+	#include <climits>
 	
 	#ifndef GLAD_INCLUDED
 		#include <glad/glad.h>
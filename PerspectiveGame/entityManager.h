@@ -4,6 +4,8 @@
 #include "entity.h"
 #include "tileNodeNetwork.h"
 #include "collisionSolver.h"
+#include "mapBatch.h"
+#include "jobSystem.h"
 
 struct EntityManager
 {
@@ -18,37 +20,199 @@ struct EntityManager
 	std::vector<TriBCollisionSolver> triBSolvers;
 	std::vector<QuadCollisionSolver> quadSolvers;
 
+	// Entities as each tile sees them, grouped by tile.  Tile i's entities are
+	// gpuEntities[gpuTileEntityOffsets[i]] up to (not including) gpuEntities[gpuTileEntityOffsets[i + 1]].
+	std::vector<GPU_Entity> gpuEntities;
+	std::vector<int> gpuTileEntityOffsets;
+
+	// What the 2D view draws, rebuilt from the above once a tick: every quad overlapping a tile, spill-over from
+	// neighbors included, grouped by tile.  Tile i's quads start at gpuTileEntityQuadRanges[2 * i] and there are
+	// gpuTileEntityQuadRanges[2 * i + 1] of them (an ivec2 in the shader), no cap on how many.
+	std::vector<GPU_EntityQuad> gpuEntityQuads;
+	std::vector<int> gpuEntityQuadOwners; // index into entities for each quad, cpu side only.
+	std::vector<int> gpuTileEntityQuadRanges;
+	int gpuTileEntityQuadRangesVersion = 0; // bumped when the ranges actually change, the renderer re-uploads them then.
+	int gpuEntityQuadsVersion = 0; // bumped by every rebuild.
+	GLuint tileEntityQuadRangesBufferID = 0; // 0 until initGpuBuffers().
+	bool gpuEntitiesDirty = true; // entities moved/added since the last rebuild.
+
+private:
+	std::vector<std::pair<int, GPU_Entity>> tileEntityScratch; // (tile index, entity) before sorting by tile.
+	std::vector<int> tileEntityCountScratch;
+	struct TileQuad { int tile; GPU_EntityQuad quad; int owner; };
+	std::vector<TileQuad> tileQuadScratch;
+	std::vector<int> tileQuadRangesScratch; // the next gpuTileEntityQuadRanges, swapped in if it changed.
+	std::vector<uint8_t> moveMapScratch, moveDirScratch; // one per entity, for mapBatch().
+
+public:
 	EntityManager(TileNodeNetwork* tnn,
 				  ForceManager* fm)
 		: p_nodeNetwork(tnn)
 		, p_forceManager(fm)
 	{
+	}
 
+	~EntityManager()
+	{
+		if (tileEntityQuadRangesBufferID == 0) return;
+		GlobalGlBufferMemory.remove(tileEntityQuadRangesBufferID);
+		glDeleteBuffers(1, &tileEntityQuadRangesBufferID);
 	}
 
+	// Needs a gl context, like TileNodeNetwork::initGpuBuffers():
+	void initGpuBuffers() { glGenBuffers(1, &tileEntityQuadRangesBufferID); }
+
 	void update()
 	{
 	}
 
-	void updateAllGpuTiles()
+	// Rebuilds gpuEntities/gpuTileEntityOffsets with a counting sort on tile index, then the quads from those.
+	// Only does anything after a tick, a new entity or a tile edit (which can change who spills over where).
+	void updateGpuEntities()
+	{
+		if (!gpuEntitiesDirty && !p_nodeNetwork->gpuTilesDirty) return;
+		gpuEntitiesDirty = false;
+
+		tileEntityScratch.clear();
+		for (int i = 0; i < (int)entities.size(); i++) {
+			addGpuEntities(i);
+		}
+
+		int numTiles = p_nodeNetwork->numTiles();
+		tileEntityCountScratch.assign(numTiles + 1, 0);
+		for (auto& te : tileEntityScratch) {
+			tileEntityCountScratch[te.first + 1]++;
+		}
+		for (int i = 0; i < numTiles; i++) {
+			tileEntityCountScratch[i + 1] += tileEntityCountScratch[i];
+		}
+
+		gpuTileEntityOffsets = tileEntityCountScratch;
+
+		gpuEntities.resize(tileEntityScratch.size());
+		for (auto& te : tileEntityScratch) {
+			gpuEntities[tileEntityCountScratch[te.first]++] = te.second;
+		}
+
+		buildEntityQuads();
+	}
+
+	// Turns gpuEntities into quads in the coords of every tile they overlap.  Used to be worked out per pixel
+	// (with 4 neighbor probes each) in the 2D pov shader, now it's once per tile with entities on it.
+	void buildEntityQuads()
+	{
+		tileQuadScratch.clear();
+		int numTiles = p_nodeNetwork->numTiles();
+		for (int t = 0; t < numTiles; t++) {
+			int first = gpuTileEntityOffsets[t], last = gpuTileEntityOffsets[t + 1];
+			if (first == last) continue;
+
+			for (int i = first; i < last; i++) {
+				GPU_Entity& e = gpuEntities[i];
+				tileQuadScratch.push_back({ t, GPU_EntityQuad(GPU_EntityQuad::localPosToCoord(e.position),
+															   GPU_EntityQuad::localDirToVec(e.direction) / 2.0f), e.entityIndex });
+			}
+
+			// A lone entity in the middle of a tile heading off it pokes into the neighbor it's heading for:
+			if (last - first != 1 || gpuEntities[first].position != LOCAL_POSITION_CENTER) continue;
+			addSpillOverQuads(t, (LocalDirection)gpuEntities[first].direction, gpuEntities[first].entityIndex);
+		}
+
+		// Counting sort by tile again:
+		tileEntityCountScratch.assign(numTiles + 1, 0);
+		for (auto& tq : tileQuadScratch) {
+			tileEntityCountScratch[tq.tile + 1]++;
+		}
+		for (int i = 0; i < numTiles; i++) {
+			tileEntityCountScratch[i + 1] += tileEntityCountScratch[i];
+		}
+
+		std::vector<int>& ranges = tileQuadRangesScratch;
+		ranges.resize(2 * numTiles);
+		for (int i = 0; i < numTiles; i++) {
+			ranges[2 * i] = tileEntityCountScratch[i];
+			ranges[2 * i + 1] = tileEntityCountScratch[i + 1] - tileEntityCountScratch[i];
+		}
+		if (ranges != gpuTileEntityQuadRanges) {
+			gpuTileEntityQuadRangesVersion++;
+			gpuTileEntityQuadRanges.swap(ranges);
+		}
+
+		gpuEntityQuads.assign(tileQuadScratch.size(), GPU_EntityQuad(glm::vec2(0), glm::vec2(0)));
+		gpuEntityQuadOwners.resize(tileQuadScratch.size());
+		for (auto& tq : tileQuadScratch) {
+			int i = tileEntityCountScratch[tq.tile]++;
+			gpuEntityQuads[i] = tq.quad;
+			gpuEntityQuadOwners[i] = tq.owner;
+		}
+		gpuEntityQuadsVersion++;
+	}
+
+	// Every tile that has the entity's tile as a neighbor on the side the entity is heading for gets a quad
+	// that starts over the edge (in the entity's tile) and slides in towards that side.
+	void addSpillOverQuads(int tileIndex, LocalDirection heading, int owner)
 	{
-		for (Entity& e : entities) {
-			updateGpuTiles(e);
+		if (heading > LOCAL_DIRECTION_3) return; // static or diagonal, stays put.
+		Tile* tile = p_nodeNetwork->getTile(tileIndex);
+		for (int k = 0; k < 4; k++) {
+			int ni = tile->getNeighborIndex((LocalDirection)k);
+			if (ni < 0) continue;
+			bool seen = false; // tiny worlds can have the same neighbor on more than one side.
+			for (int j = 0; j < k; j++) seen |= tile->getNeighborIndex((LocalDirection)j) == ni;
+			if (seen) continue;
+
+			Tile* neighbor = p_nodeNetwork->getTile(ni);
+			if (neighbor->index == -1) continue;
+			for (int d = 0; d < 4; d++) {
+				LocalDirection dir = (LocalDirection)d;
+				if (neighbor->getNeighborIndex(dir) != tileIndex) continue;
+				// The entity has to be heading back across this edge, as seen from the entity's tile:
+				if (tnav::map(neighbor->getNeighborMap(dir), tnav::inverse(dir)) != heading) continue;
+
+				glm::vec2 toEdge = GPU_EntityQuad::localDirToVec(d) / 2.0f;
+				tileQuadScratch.push_back({ ni, GPU_EntityQuad(GPU_EntityQuad::localPosToCoord(d) + toEdge, -toEdge), owner });
+			}
 		}
 	}
 
+	// Same as moveEntity() on each of them, but with all the force maps done in one mapBatch() in the middle:
 	void moveEntities()
 	{
-		for (Entity& e : entities) {
-			moveEntity(e);
+		gpuEntitiesDirty = true;
+		int n = (int)entities.size();
+		moveMapScratch.resize(n);
+		moveDirScratch.resize(n);
+		// Over the maps, the nodes still need the old directions:
+		std::vector<uint8_t>& newDirs = moveMapScratch;
+		GlobalJobSystem.parallelFor(n, 4096, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				Entity& e = entities[i];
+				LocalDirection d = p_forceManager->getForce(e.forceListIndex);
+				moveDirScratch[i] = (uint8_t)d;
+				moveMapScratch[i] = (uint8_t)(d == LOCAL_DIRECTION_STATIC ? MAP_TYPE_IDENTITY : e.node->getNeighborMap(d));
+			}
+			tnav::mapBatch(moveMapScratch.data() + begin, moveDirScratch.data() + begin, newDirs.data() + begin, end - begin);
+		});
+
+		// The forces go back in one at a time, neighboring entities' bits can share a byte of the force list:
+		for (int i = 0; i < n; i++) {
+			LocalDirection d = (LocalDirection)moveDirScratch[i];
+			if (d != LOCAL_DIRECTION_STATIC) p_forceManager->setForce(entities[i].forceListIndex, (LocalDirection)newDirs[i]);
 			//p_forceManager->setForce(e.forceListIndex, LOCAL_DIRECTION_STATIC);
 		}
+		GlobalJobSystem.parallelFor(n, 4096, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				LocalDirection d = (LocalDirection)moveDirScratch[i];
+				if (d != LOCAL_DIRECTION_STATIC) entities[i].node = p_nodeNetwork->getNeighbor(*entities[i].node, d);
+			}
+		});
 	}
 
 	bool createEntity(CenterNode* node, LocalDirection entityDir)
 	{
 		if (node->hasEntity) return false;
 
+		gpuEntitiesDirty = true;
 		entities.push_back(Entity(Entity::Type::ENTITY_TYPE_DEFAULT,
 								  glm::vec3(0.5, 0.5, 0.5),
 								  node, (int)p_forceManager->forceList.size()));
@@ -57,6 +221,25 @@ struct EntityManager
 		return true;
 	}
 
+	// Their forces live in the force list with the nodes', so this only makes sense alongside TileNodeNetwork::clear():
+	void clear()
+	{
+		entities.clear();
+		gpuEntitiesDirty = true;
+	}
+
+	// Entities, their solvers and gpu lists into report.  Their forces are in the node network's share of the force list.
+	void accountMemory(MemoryReport& report) const
+	{
+		report.bytes[MEMORY_ENTITIES] += vectorBytes(entities);
+		report.bytes[MEMORY_COLLISION_SOLVERS] += vectorBytes(orthSolvers) + vectorBytes(diagSolvers) + vectorBytes(peekSolvers) +
+			vectorBytes(triASolvers) + vectorBytes(triBSolvers) + vectorBytes(quadSolvers);
+		report.bytes[MEMORY_ENTITY_GPU_LISTS] += vectorBytes(gpuEntities) + vectorBytes(gpuTileEntityOffsets) +
+			vectorBytes(gpuEntityQuads) + vectorBytes(gpuEntityQuadOwners) + vectorBytes(gpuTileEntityQuadRanges) +
+			vectorBytes(tileEntityScratch) + vectorBytes(tileEntityCountScratch) + vectorBytes(tileQuadScratch) + vectorBytes(tileQuadRangesScratch) +
+			vectorBytes(moveMapScratch) + vectorBytes(moveDirScratch);
+	}
+
 	void moveEntity(Entity& e)
 	{
 		LocalDirection d = p_forceManager->getForce(e.forceListIndex);
@@ -65,20 +248,19 @@ struct EntityManager
 		e.node = p_nodeNetwork->getNeighbor(*e.node, d);
 	}
 
-	void updateGpuTiles(Entity& e)
+	void addGpuEntities(int entityIndex)
 	{
+		Entity& e = entities[entityIndex];
 		SideNode* sideNode;
 		int ti;
 		LocalDirection toTile;
 		MapType m;
 		LocalPosition p;
 
-
-		std::vector<GPU_Tile>* gpuTiles = &(p_nodeNetwork->gpuTiles);
 		switch (e.node->type) {
 		case NODE_TYPE_CENTER:
-			(*gpuTiles)[static_cast<CenterNode*>(e.node)->getTileIndex()].addEntity(
-				LOCAL_POSITION_CENTER, p_forceManager->getForce(e.forceListIndex));
+			tileEntityScratch.push_back({ static_cast<CenterNode*>(e.node)->getTileIndex(),
+										  GPU_Entity(LOCAL_POSITION_CENTER, p_forceManager->getForce(e.forceListIndex), entityIndex) });
 			return;
 		case NODE_TYPE_SIDE:
 			sideNode = static_cast<SideNode*>(e.node);
@@ -86,13 +268,13 @@ struct EntityManager
 			toTile = sideNode->getLocalDirDirect(0);
 			m = sideNode->getNeighborMapDirect(0);
 			p = tnav::map(m, tnav::inverse(toTile));
-			(*gpuTiles)[ti].addEntity(p, tnav::map(m, p_forceManager->getForce(e.forceListIndex)));
+			tileEntityScratch.push_back({ ti, GPU_Entity(p, tnav::map(m, p_forceManager->getForce(e.forceListIndex)), entityIndex) });
 
 			ti = static_cast<CenterNode*>(p_nodeNetwork->getNode(sideNode->getNeighborIndexDirect(1)))->getTileIndex();
 			toTile = sideNode->getLocalDirDirect(1);
 			m = sideNode->getNeighborMapDirect(1);
 			p = tnav::map(m, tnav::inverse(toTile));
-			(*gpuTiles)[ti].addEntity(p, tnav::map(m, p_forceManager->getForce(e.forceListIndex)));
+			tileEntityScratch.push_back({ ti, GPU_Entity(p, tnav::map(m, p_forceManager->getForce(e.forceListIndex)), entityIndex) });
 			return;
 		case NODE_TYPE_CORNER:
 
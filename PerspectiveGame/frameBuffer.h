@@ -4,96 +4,160 @@
 #include <glad/glad.h>
 #endif
 #include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
 #include "vectorHelperFunctions.h"
+#include "streamBuffer.h"
 
-class Framebuffer {
-public:
-	GLint width = 800;
-	GLint height = 600;
-	glm::ivec2 textureSizes[2];
-	GLuint VAO;
-	GLuint VBO;
-	GLuint FBO;
-	GLuint RBO;
-	GLuint EBO;
-	GLuint pov2D3rdPersonTextureID;
-	GLuint pov3D3rdPersonTextureID;
+// Formats a render target is created with.  Two targets with the same description are interchangeable.
+struct RenderTargetDesc {
+	glm::ivec2 size = glm::ivec2(0, 0);
+	GLenum colorFormat = GL_RGB;
+	GLenum depthStencilFormat = GL_DEPTH24_STENCIL8;
 
-public:
-	void init() {
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
+	RenderTargetDesc() {}
+	RenderTargetDesc(glm::ivec2 size, GLenum colorFormat, GLenum depthStencilFormat)
+		: size(size), colorFormat(colorFormat), depthStencilFormat(depthStencilFormat) {}
+
+	bool operator==(const RenderTargetDesc& o) const
+	{
+		return size == o.size && colorFormat == o.colorFormat && depthStencilFormat == o.depthStencilFormat;
+	}
+	bool operator!=(const RenderTargetDesc& o) const { return !(*this == o); }
+};
 
-		glGenFramebuffers(1, &FBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+// One FBO with a color texture and a depth/stencil renderbuffer.
+struct RenderTarget {
+	GLuint FBO = 0;
+	GLuint colorTextureID = 0;
+	GLuint depthStencilRBO = 0;
+	RenderTargetDesc desc;
+	uint64_t retiredFrame = 0; // when it was last handed back, for spares.
+};
 
-		glGenTextures(1, &pov2D3rdPersonTextureID);
-		glBindTexture(GL_TEXTURE_2D, pov2D3rdPersonTextureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pov2D3rdPersonTextureID, 0);
+// Every view that renders offscreen gets its own target so they never fight over attachments:
+enum RenderTargetID {
+	RENDER_TARGET_POV_2D_3RD_PERSON,
+	RENDER_TARGET_POV_3D_3RD_PERSON,
+	NUM_RENDER_TARGETS,
+};
 
-		glGenTextures(1, &pov3D3rdPersonTextureID);
-		glBindTexture(GL_TEXTURE_2D, pov3D3rdPersonTextureID);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, pov3D3rdPersonTextureID, 0);
+class Framebuffer {
+public:
+	// All the per-frame geometry/ssbo uploads go through this:
+	StreamBuffer streamBuffer;
 
-		glGenRenderbuffers(1, &RBO);
-		glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
+	RenderTarget renderTargets[NUM_RENDER_TARGETS];
+	// Targets that were handed back on a resize, kept around in case something asks for that description again
+	// before the frames that drew with them are done.  Freed after that, so a resize doesn't keep full size
+	// targets alive for good:
+	std::vector<RenderTarget> spareTargets;
+	static const int MAX_SPARE_TARGETS = 4;
+	static const int SPARE_TARGET_FRAMES = StreamBuffer::NUM_FRAMES_IN_FLIGHT;
+	uint64_t currentFrame = 0;
 
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-			std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n";
+	int numReallocations = 0; // times texture/renderbuffer storage had to be (re)allocated.
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-		glBindTexture(GL_TEXTURE_2D, 0);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+public:
+	void init() {
+		streamBuffer.init();
 	}
 
 	~Framebuffer() {
-		glDeleteFramebuffers(1, &FBO);
-		glDeleteTextures(1, &pov2D3rdPersonTextureID);
-		glDeleteTextures(1, &pov3D3rdPersonTextureID);
-		glDeleteRenderbuffers(1, &RBO);
-		glDeleteBuffers(1, &VAO);
-		glDeleteBuffers(1, &VBO);
-		glDeleteBuffers(1, &EBO);
+		for (RenderTarget& t : renderTargets) deleteTarget(t);
+		for (RenderTarget& t : spareTargets) deleteTarget(t);
+	}
+
+	GLuint getTextureID(RenderTargetID id) { return renderTargets[id].colorTextureID; }
+
+	// Once a frame, frees the spares nothing can be using anymore:
+	void beginFrame() {
+		currentFrame++;
+		for (int i = (int)spareTargets.size() - 1; i >= 0; i--) {
+			if (currentFrame - spareTargets[i].retiredFrame <= SPARE_TARGET_FRAMES) continue;
+			deleteTarget(spareTargets[i]);
+			spareTargets.erase(spareTargets.begin() + i);
+		}
+	}
+
+	// Binds the target for the given view, making sure it matches the description first.
+	// Storage is only touched when the description actually changed (i.e. the view was resized).
+	RenderTarget& bindRenderTarget(RenderTargetID id, RenderTargetDesc desc) {
+		RenderTarget& target = renderTargets[id];
+		if (target.desc != desc || target.FBO == 0) {
+			swapOrReallocate(target, desc);
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, target.FBO);
+		return target;
 	}
 
-	void bind_framebuffer() {
-		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	RenderTarget& bindRenderTarget(RenderTargetID id, GLsizei width, GLsizei height) {
+		return bindRenderTarget(id, RenderTargetDesc(glm::ivec2(width, height), GL_RGB, GL_DEPTH24_STENCIL8));
 	}
 
 	void unbind_framebuffer() {
 		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 	}
 
-	void rescale_framebuffer(GLsizei width, GLsizei height, GLuint texture_id) {
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-
-		int texIndex = 0;
-		if (texture_id == pov2D3rdPersonTextureID) {
-			texIndex = 0;
-		} else if (texture_id == pov3D3rdPersonTextureID) {
-			texIndex = 1;
+private:
+	void swapOrReallocate(RenderTarget& target, RenderTargetDesc desc) {
+		// a spare with the right description can just be swapped in, no driver work needed:
+		for (int i = 0; i < spareTargets.size(); i++) {
+			if (spareTargets[i].desc != desc) continue;
+			std::swap(target, spareTargets[i]);
+			spareTargets[i].retiredFrame = currentFrame;
+			if (spareTargets[i].FBO == 0) spareTargets.erase(spareTargets.begin() + i);
+			return;
 		}
 
-		if (textureSizes[texIndex].x != width || textureSizes[texIndex].y != height) {
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
-			textureSizes[texIndex].x = width;
-			textureSizes[texIndex].y = height;
+		if (target.FBO == 0) {
+			glGenFramebuffers(1, &target.FBO);
+			glGenTextures(1, &target.colorTextureID);
+			glGenRenderbuffers(1, &target.depthStencilRBO);
+		}
+		else {
+			// keep the old one around if there is room, otherwise just resize it in place:
+			if (spareTargets.size() < MAX_SPARE_TARGETS) {
+				target.retiredFrame = currentFrame;
+				spareTargets.push_back(target);
+				target = RenderTarget();
+				glGenFramebuffers(1, &target.FBO);
+				glGenTextures(1, &target.colorTextureID);
+				glGenRenderbuffers(1, &target.depthStencilRBO);
+			}
 		}
+		allocateStorage(target, desc);
+	}
+
+	void allocateStorage(RenderTarget& target, RenderTargetDesc desc) {
+		target.desc = desc;
+		numReallocations++;
+
+		glBindTexture(GL_TEXTURE_2D, target.colorTextureID);
+		glTexImage2D(GL_TEXTURE_2D, 0, desc.colorFormat, desc.size.x, desc.size.y, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture_id, 0);
 
-		glBindRenderbuffer(GL_RENDERBUFFER, RBO);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, RBO);
+		glBindRenderbuffer(GL_RENDERBUFFER, target.depthStencilRBO);
+		glRenderbufferStorage(GL_RENDERBUFFER, desc.depthStencilFormat, desc.size.x, desc.size.y);
+
+		// attachments only need to be set once per storage change:
+		glBindFramebuffer(GL_FRAMEBUFFER, target.FBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.colorTextureID, 0);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, target.depthStencilRBO);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::FRAMEBUFFER:: Framebuffer is not complete!\n";
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	}
+
+	void deleteTarget(RenderTarget& t) {
+		if (t.FBO == 0) return;
+		glDeleteFramebuffers(1, &t.FBO);
+		glDeleteTextures(1, &t.colorTextureID);
+		glDeleteRenderbuffers(1, &t.depthStencilRBO);
+		t = RenderTarget();
 	}
 };
\ No newline at end of file
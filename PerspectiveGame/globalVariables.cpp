@@ -22,8 +22,4 @@ int CurrentTick = 0;
 
 float guiEdit1 = -1, guiEdit2 = 1, guiEdit4 = 1, guiEdit3 = -1;
 
-bool CanEditSubWindows = false;
-
-int TICKS_IN_SCENARIO = 0;
-int CURRENT_SCENARIO_ID = 0;
-int NUM_OF_SCENARIOS = 5;
\ No newline at end of file
+bool CanEditSubWindows = false;
\ No newline at end of file
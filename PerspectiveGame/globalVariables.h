@@ -22,14 +22,14 @@ extern std::chrono::steady_clock::time_point FrameStart;
 extern float DeltaTime;
 extern float TimeSinceProgramStart;
 extern float UpdateTime;
-extern float LastUpdateTime;
+extern float LastUpdateTime; // written by the simulation thread only, the renderer goes by its snapshot's copy.
 
 extern int PixelsPerGuiGridUnit;
 
 extern float FPS;
 extern float FrameTime;
 extern int CurrentFrame;
-extern int CurrentTick;
+extern int CurrentTick; // same.
 
 extern float guiEdit1;
 extern float guiEdit2;
@@ -38,14 +38,9 @@ extern float guiEdit3;
 
 extern bool CanEditSubWindows;
 
-
-extern int TICKS_IN_SCENARIO;
-extern int CURRENT_SCENARIO_ID;
-extern int NUM_OF_SCENARIOS;
-
 inline void updateTimeSinceProgramStart()
 {
-	auto currentTime = std::chrono::high_resolution_clock::now();
+	auto currentTime = std::chrono::steady_clock::now();
 	TimeSinceProgramStart = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - ProgramStart).count();
 }
 
@@ -58,27 +53,33 @@ inline void updateGlobalVariables(GLFWwindow* window) {
 	CursorScreenPos.x = -(CursorPixelPos.x / WindowSize.x * 2 - 1);
 	CursorScreenPos.y = -(CursorPixelPos.y / WindowSize.y * 2 - 1);
 
-	auto currentTime = std::chrono::high_resolution_clock::now();
+	auto currentTime = std::chrono::steady_clock::now();
 	DeltaTime = std::chrono::duration<float, std::chrono::seconds::period>(currentTime - FrameStart).count();
 	updateTimeSinceProgramStart();
 	if (DeltaTime < 16.0f / 1000.0f) {
 		/*Sleep(16.0f - DeltaTime / 1000.0f);
 		DeltaTime = 16.0f / 1000.0f;
-		currentTime = std::chrono::high_resolution_clock::now();*/
+		currentTime = std::chrono::steady_clock::now();*/
 	}
 	FrameStart = currentTime;
 }
 
+// window is null when headless, there is no monitor or cursor then.
 inline void initGlobalVariables(GLFWwindow* window) {
-	const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
-	MonitorSize.x = mode->width;
-	MonitorSize.y = mode->height;
 	WindowSize = glm::ivec2(600, 600);
 
 	DeltaTime = 0.0f;
-	ProgramStart = std::chrono::high_resolution_clock::now();
+	ProgramStart = std::chrono::steady_clock::now();
 	FrameStart = ProgramStart;
 
+	if (window == nullptr) {
+		MonitorSize = WindowSize;
+		return;
+	}
+	const GLFWvidmode* mode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+	MonitorSize.x = mode->width;
+	MonitorSize.y = mode->height;
+
 	glfwSetWindowPos(window, MonitorSize.x / 2 - WindowSize.x / 2, MonitorSize.y / 2 - WindowSize.y / 2);
 	updateGlobalVariables(window);
 }
@@ -0,0 +1,106 @@
+#pragma once
+#include <iostream>
+#ifndef __gl_h_
+#include <glad/glad.h>
+#endif
+
+#include "profiler.h"
+
+// GL_TIME_ELAPSED queries around whole render passes.  Results are read back NUM_QUERY_SETS frames late (when
+// their set comes round again), and only if the gpu is already done with them, so timing never stalls the
+// pipeline; a late result is just dropped.  Each result is tagged with the profiler frame that issued it.
+// Query objects are not shared between contexts, so each window gets its own GpuTimer and must only
+// be used while its context is current.  Core since 3.3, so this works on Mesa llvmpipe as well.
+struct GpuTimer {
+	static const int NUM_QUERY_SETS = 2; // double buffered: write one set while the other is read back.
+	static const int MAX_RANGES_PER_PASS = 4; // a pass can be timed in a few pieces, they get summed.
+
+private:
+	GLuint queries[NUM_QUERY_SETS][NUM_GPU_PASSES][MAX_RANGES_PER_PASS] = {};
+	int numRanges[NUM_QUERY_SETS][NUM_GPU_PASSES] = {};
+	uint32_t issuedFrame[NUM_QUERY_SETS] = {}; // GlobalProfiler.currentFrame when each set was last written.
+	int currentSet = 0;
+	int activePass = -1; // time elapsed queries can't nest, only one pass at a time.
+	bool initialized = false;
+
+public: // Stats:
+	int numDroppedResults = 0; // results that weren't ready when their set came round again.
+
+public:
+	// Not a destructor since the owning context may be gone by then, call with it current:
+	void destroy()
+	{
+		if (!initialized) return;
+		glDeleteQueries(NUM_QUERY_SETS * NUM_GPU_PASSES * MAX_RANGES_PER_PASS, &queries[0][0][0]);
+		initialized = false;
+	}
+
+	// Reads back the set issued NUM_QUERY_SETS frames ago (if ready) into GlobalProfiler and starts writing to it again.
+	void beginFrame()
+	{
+		if (!initialized) {
+			glGenQueries(NUM_QUERY_SETS * NUM_GPU_PASSES * MAX_RANGES_PER_PASS, &queries[0][0][0]);
+			initialized = true;
+		}
+
+		currentSet = (currentSet + 1) % NUM_QUERY_SETS;
+		// The set we're about to reuse was written NUM_QUERY_SETS frames ago (two frames, double buffered), the
+		// other one last frame is still in flight:
+		for (int p = 0; p < NUM_GPU_PASSES; p++) {
+			int n = numRanges[currentSet][p];
+			if (n == 0) continue;
+
+			GLuint64 totalNs = 0;
+			bool ready = true;
+			for (int r = 0; r < n && ready; r++) {
+				GLint available = 0;
+				glGetQueryObjectiv(queries[currentSet][p][r], GL_QUERY_RESULT_AVAILABLE, &available);
+				if (!available) { ready = false; break; }
+				GLuint64 ns = 0;
+				glGetQueryObjectui64v(queries[currentSet][p][r], GL_QUERY_RESULT, &ns);
+				totalNs += ns;
+			}
+
+			if (ready) GlobalProfiler.recordGpu((GpuPass)p, totalNs / 1000000.0f, issuedFrame[currentSet]);
+			else numDroppedResults++;
+			numRanges[currentSet][p] = 0;
+		}
+		issuedFrame[currentSet] = GlobalProfiler.currentFrame;
+	}
+
+	void begin(GpuPass pass)
+	{
+		if (activePass != -1) {
+			std::cout << "ERROR::GPU_TIMER:: " << GPU_PASS_NAMES[pass] << " started inside "
+				<< GPU_PASS_NAMES[activePass] << std::endl;
+			return;
+		}
+		int& n = numRanges[currentSet][pass];
+		if (n == MAX_RANGES_PER_PASS) return; // out of queries this frame, just time what we can.
+		glBeginQuery(GL_TIME_ELAPSED, queries[currentSet][pass][n]);
+		n++;
+		activePass = pass;
+	}
+
+	void end(GpuPass pass)
+	{
+		if (activePass != pass) return;
+		glEndQuery(GL_TIME_ELAPSED);
+		activePass = -1;
+	}
+};
+
+// Times everything in the enclosing scope with the given GpuTimer:
+struct ScopedGpuTimer {
+	GpuTimer& timer;
+	GpuPass pass;
+
+	ScopedGpuTimer(GpuTimer& timer, GpuPass pass) : timer(timer), pass(pass) { timer.begin(pass); }
+	~ScopedGpuTimer() { timer.end(pass); }
+};
+
+#ifdef PROFILER_ENABLED
+#define GPU_PROFILE_SCOPE(timer, pass) ScopedGpuTimer PROFILE_CONCAT(gpuProfileTimer, __LINE__)(timer, pass)
+#else
+#define GPU_PROFILE_SCOPE(timer, pass)
+#endif
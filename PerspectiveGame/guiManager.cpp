@@ -1,7 +1,12 @@
 #include "guiManager.h"
+#include "allocationCounter.h"
+#include "jobSystem.h"
+
+#include <cstdio>
 
 void GuiManager::imGuiSetup() {
 #ifdef USE_GUI_WINDOW
+	if (p_imGuiWindow == nullptr) return; // headless, no debug window.
 
 	show_demo_window = false;
 	show_another_window = false;
@@ -75,7 +80,16 @@ void GuiManager::imGuiSetup() {
 }
 
 GuiManager::~GuiManager() {
+	if (p_window != nullptr) glfwMakeContextCurrent(p_window); // otherwise headless, and the one context is current.
+	sceneGpuTimer.destroy();
+	if (stepHistogramBufferIDs[0] != 0) {
+		for (GLuint id : stepHistogramBufferIDs) GlobalGlBufferMemory.remove(id);
+		glDeleteBuffers(2, stepHistogramBufferIDs);
+	}
 #ifdef USE_GUI_WINDOW
+	if (p_imGuiWindow == nullptr) return;
+	glfwMakeContextCurrent(p_imGuiWindow);
+	imGuiGpuTimer.destroy();
 	ImGui_ImplOpenGL3_Shutdown();
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
@@ -83,6 +97,8 @@ GuiManager::~GuiManager() {
 }
 
 void GuiManager::renderImGuiDebugWindows() {
+	imGuiGpuTimer.beginFrame();
+
 	// Start the Dear ImGui frame
 	ImGui_ImplOpenGL3_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
@@ -161,6 +177,123 @@ void GuiManager::renderImGuiDebugWindows() {
 		}
 
 		ImGui::Text("Application average %.3f ms/frame (%.1f FPS)", FrameTime, FPS);
+		ImGui::Text("Render target reallocations: %d", p_framebuffer->numReallocations);
+		ImGui::Text("Shaders: %d loaded from cache, %d compiled", Program::numLoadedFromCache, Program::numCompiled);
+		StreamBuffer& stream = p_framebuffer->streamBuffer;
+		ImGui::Text("Stream buffer: %d uploads, %.1f KB this frame (%s)", stream.numAllocationsThisFrame,
+					stream.bytesThisFrame / 1024.0f, stream.persistentlyMapped ? "persistent" : "subdata");
+		ImGui::Text("Stream buffer: %.1f MB, %d stalls, %d grows", stream.capacity() / (1024.0f * 1024.0f),
+					stream.numStalls, stream.numGrows);
+		ImGui::Text("3D view: %d / %d tiles drawn (%d bvh nodes)",
+					(int)visibleTiles3D.size(), bvh3D.numTiles(), bvh3D.size());
+		ImGui::Text("Simulation: tick %d, world version %d (%s)", snapshot().tick, snapshot().worldVersion,
+					p_simulation->isRunning() ? "own thread" : "stepped every frame");
+		bool printEdits = p_simulation->printEdits;
+		if (ImGui::Checkbox("print network after edits", &printEdits)) p_simulation->printEdits = printEdits;
+
+		if (ImGui::CollapsingHeader("Ray march steps")) {
+			ImGui::RadioButton("normal", &debugRenderMode2D, DEBUG_RENDER_MODE_NONE); ImGui::SameLine();
+			ImGui::RadioButton("step heatmap", &debugRenderMode2D, DEBUG_RENDER_MODE_STEP_HEATMAP);
+			ImGui::Checkbox("collect 2D view histogram", &collectStepHistogram);
+
+			auto plotSteps = [](const char* label, const StepHistogram& h) {
+				float buckets[NUM_STEP_HISTOGRAM_BUCKETS + 1];
+				for (int i = 0; i <= NUM_STEP_HISTOGRAM_BUCKETS; i++) buckets[i] = (float)h.buckets[i];
+				ImGui::Text("%s: %llu rays, %.1f steps avg, %u gave up at %d", label, (unsigned long long)h.numRays(),
+							h.averageSteps(), h.numMaxedOut(), h.maxSteps);
+				ImGui::PlotHistogram(label, buckets, NUM_STEP_HISTOGRAM_BUCKETS + 1, 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 80));
+			};
+			plotSteps("2D view (gpu, per frame)", gpuRaySteps);
+			plotSteps("cursor (cpu)", p_currentSelection->cursorRaySteps);
+			if (ImGui::Button("Reset cursor histogram")) p_currentSelection->cursorRaySteps.clear();
+		}
+
+		ImGui::Checkbox("Instanced entities", &instancedEntities);
+		if (instancedEntities) {
+			ImGui::SameLine();
+			if (drawingEntityInstances)
+				ImGui::Text("%d drawn, %d cells unfolded", (int)entityInstances.size(), surfaceUnfolding.numCells());
+			else ImGui::Text("too zoomed out, drawn per pixel");
+		}
+
+		if (ImGui::CollapsingHeader("CPU profiler")) {
+			ImGui::Text("over the last %d frames (ms):", GlobalProfiler.numHistoryFrames);
+			ImGui::Columns(6, "cpuProfiler");
+			ImGui::Text("phase"); ImGui::NextColumn();
+			ImGui::Text("avg"); ImGui::NextColumn();
+			ImGui::Text("p50"); ImGui::NextColumn();
+			ImGui::Text("p95"); ImGui::NextColumn();
+			ImGui::Text("p99"); ImGui::NextColumn();
+			ImGui::Text("max"); ImGui::NextColumn();
+			ImGui::Separator();
+			for (int p = 0; p < NUM_PROFILE_PHASES; p++) {
+				Profiler::PhaseStats& st = GlobalProfiler.stats[p];
+				ImGui::Text("%s", PROFILE_PHASE_NAMES[p]); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.average); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.p50); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.p95); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.p99); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.max); ImGui::NextColumn();
+			}
+			ImGui::Separator();
+			for (int p = 0; p < NUM_GPU_PASSES; p++) {
+				Profiler::PhaseStats& st = GlobalProfiler.gpuStats[p];
+				ImGui::Text("gpu: %s", GPU_PASS_NAMES[p]); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.average); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.p50); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.p95); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.p99); ImGui::NextColumn();
+				ImGui::Text("%.3f", st.max); ImGui::NextColumn();
+			}
+			ImGui::Columns(1);
+			ImGui::Text("gpu results dropped (not ready two frames later): %d",
+						sceneGpuTimer.numDroppedResults + imGuiGpuTimer.numDroppedResults);
+			if (ImGui::Button("Dump Chrome trace")) {
+				GlobalProfiler.dumpChromeTrace("profile_trace.json");
+			}
+		}
+
+		if (ImGui::CollapsingHeader("Memory")) {
+			const MemoryTracker& memory = snapshot().memory;
+			const float KB = 1024.0f;
+			ImGui::Columns(3, "memory");
+			ImGui::Text("world (KB)"); ImGui::NextColumn();
+			ImGui::Text("now"); ImGui::NextColumn();
+			ImGui::Text("peak"); ImGui::NextColumn();
+			ImGui::Separator();
+			for (int c = 0; c < NUM_MEMORY_CATEGORIES; c++) {
+				ImGui::Text("%s", MEMORY_CATEGORY_NAMES[c]); ImGui::NextColumn();
+				ImGui::Text("%.1f", memory.current.bytes[c] / KB); ImGui::NextColumn();
+				ImGui::Text("%.1f", memory.peakBytes[c] / KB); ImGui::NextColumn();
+			}
+			ImGui::Separator();
+			ImGui::Text("total"); ImGui::NextColumn();
+			ImGui::Text("%.1f", memory.current.total() / KB); ImGui::NextColumn();
+			ImGui::Text("%.1f", memory.peakTotal / KB); ImGui::NextColumn();
+			ImGui::Text("gl buffers"); ImGui::NextColumn();
+			ImGui::Text("%.1f", GlobalGlBufferMemory.total / KB); ImGui::NextColumn();
+			ImGui::Text("%.1f", GlobalGlBufferMemory.peak / KB); ImGui::NextColumn();
+			HeapUsage heap = currentHeapUsage();
+			ImGui::Text("whole heap"); ImGui::NextColumn();
+			ImGui::Text("%.1f", heap.liveBytes / KB); ImGui::NextColumn();
+			ImGui::Text("%.1f", heap.peakBytes / KB); ImGui::NextColumn();
+			ImGui::Columns(1);
+			ImGui::Text("%d tile pairs, %.0f bytes per tile pair", memory.current.numTilePairs, memory.current.bytesPerTilePair());
+		}
+
+		if (ImGui::CollapsingHeader("Job system")) {
+			const std::vector<JobSystem::WorkerStats>& workers = GlobalJobSystem.stats();
+			ImGui::Text("%d workers (plus whoever's waiting on them)", (int)workers.size());
+			for (int w = 0; w < (int)workers.size(); w++) {
+				const JobSystem::WorkerStats& st = workers[w];
+				char label[64];
+				snprintf(label, sizeof(label), "%.0f%%", 100.0f * st.utilization);
+				ImGui::ProgressBar(st.utilization, ImVec2(120, 0), label);
+				ImGui::SameLine();
+				ImGui::Text("worker %d: %llu jobs, %llu stolen", w, (unsigned long long)st.jobsRun,
+							(unsigned long long)st.jobsStolen);
+			}
+		}
 		ImGui::End();
 	}
 
@@ -174,6 +307,7 @@ void GuiManager::renderImGuiDebugWindows() {
 	}
 
 	ImGui::Render();
+	GPU_PROFILE_SCOPE(imGuiGpuTimer, GPU_PASS_IMGUI);
 	ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
@@ -195,11 +329,6 @@ void GuiManager::drawColoredRect(glm::vec2 corners[4], glm::vec3 color) {
 	glDisable(GL_STENCIL_TEST);
 	glDisable(GL_BLEND);
 
-	glBindVertexArray(p_framebuffer->VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, p_framebuffer->VBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p_framebuffer->EBO);
-
-	setVertAttribVec2PosVec2TexCoordVec3Color();
 	p_shaderManager->justVertsAndColors.use();
 
 	std::vector<GLfloat> verts;
@@ -219,9 +348,7 @@ void GuiManager::drawColoredRect(glm::vec2 corners[4], glm::vec3 color) {
 	std::vector<GLuint> indices = {
 		0, 1, 3, 1, 2, 3,
 	};
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * verts.size(), verts.data(), GL_DYNAMIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
+	drawStreamed(verts, indices, 7, setVertAttribVec2PosVec2TexCoordVec3Color);
 }
 
 void GuiManager::drawColoredTriFromPixelSpace(glm::ivec2 A, glm::ivec2 B, glm::ivec2 C, glm::vec3 color) {
@@ -233,11 +360,10 @@ void GuiManager::drawColoredTriFromPixelSpace(glm::ivec2 A, glm::ivec2 B, glm::i
 	drawColoredTri(corners, color);
 }
 
-void GuiManager::setupFramebufferForButtonRender(int buttonIndex, GLuint textureID) {
-	p_framebuffer->bind_framebuffer();
+void GuiManager::setupFramebufferForButtonRender(int buttonIndex, RenderTargetID renderTarget) {
 	Button *button = &p_buttonManager->buttons[buttonIndex];
 	glm::ivec2 buttonSizePixels = button->size * PixelsPerGuiGridUnit;
-	p_framebuffer->rescale_framebuffer((GLsizei)buttonSizePixels.x, (GLsizei)buttonSizePixels.y, textureID);
+	p_framebuffer->bindRenderTarget(renderTarget, (GLsizei)buttonSizePixels.x, (GLsizei)buttonSizePixels.y);
 	glViewport(0, 0, button->pixelWidth(), button->pixelHeight());
 	glClearColor(0, 0, 0, 1);
 	glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -251,11 +377,6 @@ void GuiManager::drawColoredTri(glm::vec2 corners[3], glm::vec3 color) {
 	glDisable(GL_STENCIL_TEST);
 	glDisable(GL_BLEND);
 
-	glBindVertexArray(p_framebuffer->VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, p_framebuffer->VBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p_framebuffer->EBO);
-
-	setVertAttribVec2PosVec2TexCoordVec3Color();
 	p_shaderManager->justVertsAndColors.use();
 
 	std::vector<GLfloat> verts;
@@ -274,9 +395,7 @@ void GuiManager::drawColoredTri(glm::vec2 corners[3], glm::vec3 color) {
 	std::vector<GLuint> indices = {
 		0, 1, 2,
 	};
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * verts.size(), verts.data(), GL_DYNAMIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
+	drawStreamed(verts, indices, 7, setVertAttribVec2PosVec2TexCoordVec3Color);
 }
 
 void GuiManager::renderTargetButtonMovementElements() {
@@ -340,17 +459,29 @@ void unbindShaderStorageBuffer()
 
 void GuiManager::bindSSBOs2d3rdPersonViaNodeNetwork()
 {
-	// Tile Buffer:
-	glBindBuffer(GL_UNIFORM_BUFFER, p_nodeNetwork->tilesBufferID);
-	glBufferData(GL_UNIFORM_BUFFER,
-				 p_nodeNetwork->gpuTiles.size() * sizeof(GPU_Tile),
-				 p_nodeNetwork->gpuTiles.data(),
-				 GL_DYNAMIC_DRAW);
-	GLuint tilesBlockID = glGetUniformBlockIndex(p_shaderManager->POV2D3rdPersonViaNodeNetwork.ID, "tileBuffer");
+	// Tile Buffer (static unless the world was edited, see uploadSnapshot()):
 	GLuint tilesBindingPoint = 1;
-	glUniformBlockBinding(p_shaderManager->POV2D3rdPersonViaNodeNetwork.ID, tilesBlockID, tilesBindingPoint);
 	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, tilesBindingPoint, p_nodeNetwork->tilesBufferID);
 
+	// Entity quads (streamed every frame, 16 bytes a quad and only tiles with something on them have any):
+	StreamBuffer& stream = p_framebuffer->streamBuffer;
+	GPU_EntityQuad noQuad(glm::vec2(0), glm::vec2(0)); // can't bind an empty range.
+	const std::vector<GPU_EntityQuad>& quads = snapshot().entities->quads;
+	StreamAllocation quadsAlloc = stream.uploadStorage(
+		!quads.empty() ? quads.data() : &noQuad,
+		(!quads.empty() ? quads.size() : 1) * sizeof(GPU_EntityQuad));
+	GLuint entityQuadsBindingPoint = 2;
+	glBindBufferRange(GL_SHADER_STORAGE_BUFFER, entityQuadsBindingPoint, stream.ID, quadsAlloc.offset, quadsAlloc.size);
+
+	// Which quads each tile has:
+	GLuint tileEntityQuadRangesBindingPoint = 3;
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, tileEntityQuadRangesBindingPoint, p_entityManager->tileEntityQuadRangesBufferID);
+
+	GLuint tileLodsBindingPoint = 5;
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, tileLodsBindingPoint, p_nodeNetwork->tileLodsBufferID);
+
+	bindStepHistogramBuffer();
+
 	// Entity Buffer:
 	//glBindBuffer(GL_UNIFORM_BUFFER, p_nodeNetwork->positionNodeInfosBufferID);
 	//glBufferData(GL_UNIFORM_BUFFER,
@@ -365,16 +496,56 @@ void GuiManager::bindSSBOs2d3rdPersonViaNodeNetwork()
 	unbindShaderStorageBuffer();
 }
 
+// Reads back the counts from the last time this buffer was used, then zeroes and binds it for this frame.
+void GuiManager::bindStepHistogramBuffer()
+{
+	// buckets, rays that hit MAX_STEPS, total steps:
+	const GLsizeiptr size = (NUM_STEP_HISTOGRAM_BUCKETS + 2) * sizeof(GLuint);
+	if (stepHistogramBufferIDs[0] == 0) {
+		glGenBuffers(2, stepHistogramBufferIDs);
+		for (GLuint id : stepHistogramBufferIDs) {
+			glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+			glBufferData(GL_SHADER_STORAGE_BUFFER, size, nullptr, GL_DYNAMIC_READ);
+			GlobalGlBufferMemory.set(id, size);
+		}
+	}
+
+	currentStepHistogramBuffer = (currentStepHistogramBuffer + 1) % 2;
+	GLuint id = stepHistogramBufferIDs[currentStepHistogramBuffer];
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, id);
+
+	GLuint counts[NUM_STEP_HISTOGRAM_BUCKETS + 2] = {};
+	if (stepHistogramWritten[currentStepHistogramBuffer]) {
+		glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, counts);
+		std::copy(counts, counts + NUM_STEP_HISTOGRAM_BUCKETS + 1, gpuRaySteps.buckets);
+		gpuRaySteps.totalSteps = counts[NUM_STEP_HISTOGRAM_BUCKETS + 1];
+		std::fill(std::begin(counts), std::end(counts), 0);
+	}
+	else if (!stepHistogramEnabled()) {
+		gpuRaySteps.clear();
+	}
+
+	if (stepHistogramEnabled()) glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, size, counts);
+	stepHistogramWritten[currentStepHistogramBuffer] = stepHistogramEnabled();
+
+	GLuint stepHistogramBindingPoint = 4;
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, stepHistogramBindingPoint, id);
+}
+
 void GuiManager::bindUniforms2d3rdPersonViaNodeNetwork(Button* sceneView)
 {
 	//updateTimeSinceProgramStart();
-	float updateProgress = float(TimeSinceProgramStart - LastUpdateTime) / UpdateTime;
-	GLuint programID = p_shaderManager->POV2D3rdPersonViaNodeNetwork.ID;
-
-	glUniform1f(glGetUniformLocation(programID, "deltaTime"), TimeSinceProgramStart);
-	glUniform1f(glGetUniformLocation(programID, "updateProgress"), updateProgress);
-	glUniform1i(glGetUniformLocation(programID, "initialTileIndex"), p_pov->getNode()->getTileIndex());
-	glUniform1i(glGetUniformLocation(programID, "initialMapIndex"), p_pov->mapType);
+	float updateProgress = float(TimeSinceProgramStart - snapshot().lastTickTime) / UpdateTime;
+	auto& uniforms = p_shaderManager->POV2D3rdPersonViaNodeNetworkUniforms;
+	PovView pov = povView();
+
+	uniforms.deltaTime.set(TimeSinceProgramStart);
+	uniforms.updateProgress.set(updateProgress);
+	uniforms.initialTileIndex.set(pov.tileIndex);
+	uniforms.initialMapIndex.set(pov.mapType);
+	uniforms.debugRenderMode.set(debugRenderMode2D);
+	uniforms.collectStepHistogram.set(stepHistogramEnabled() ? 1 : 0);
+	uniforms.drawEntities.set(drawingEntityInstances ? 0 : 1);
 	
 	//glm::vec2 relativePos[5]; // player position in current tile and neighbors:
 	//int relativePosTileIndices[5];
@@ -391,8 +562,10 @@ void GuiManager::bindUniforms2d3rdPersonViaNodeNetwork(Button* sceneView)
 
 	glm::mat4 screenSpaceToWorldSpace = glm::inverse(
 		p_camera->getProjectionMatrix((float)sceneView->pixelWidth(), (float)sceneView->pixelHeight()));
-	GLuint windowToWorldID = glGetUniformLocation(programID, "inWindowToWorldSpace");
-	glUniformMatrix4fv(windowToWorldID, 1, GL_FALSE, glm::value_ptr(screenSpaceToWorldSpace));
+	uniforms.inWindowToWorldSpace.set(screenSpaceToWorldSpace);
+	// One pixel across in ndc, taken to world space:
+	glm::vec4 pixelAcross = screenSpaceToWorldSpace * glm::vec4(2.0f / sceneView->pixelWidth(), 0, 0, 0);
+	uniforms.pixelWorldSize.set(glm::length(glm::vec2(pixelAcross)));
 }
 
 void GuiManager::draw2d3rdPersonViaNodeNetwork()
@@ -404,12 +577,8 @@ void GuiManager::draw2d3rdPersonViaNodeNetwork()
 	glDisable(GL_STENCIL_TEST);
 	glDisable(GL_BLEND);
 
-	glBindVertexArray(p_framebuffer->VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, p_framebuffer->VBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p_framebuffer->EBO);
 	Button* sceneView = &p_buttonManager->buttons[ButtonManager::pov2d3rdPersonViewButtonIndex];
 
-	setVertAttribVec2Pos();
 	p_shaderManager->POV2D3rdPersonViaNodeNetwork.use();
 
 	bindSSBOs2d3rdPersonViaNodeNetwork();
@@ -422,10 +591,110 @@ void GuiManager::draw2d3rdPersonViaNodeNetwork()
 
 	// full screen quad:
 	std::vector<GLfloat> verts = { -1, 1, 1, 1, 1, -1, -1, -1, };
-	std::vector<GLsizei> indices = { 0, 1, 3, 1, 2, 3, };
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * verts.size(), verts.data(), GL_DYNAMIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
+	std::vector<GLuint> indices = { 0, 1, 3, 1, 2, 3, };
+	drawStreamed(verts, indices, 2, setVertAttribVec2Pos);
+	if (stepHistogramEnabled()) glMemoryBarrier(GL_BUFFER_UPDATE_BARRIER_BIT); // atomics -> glGetBufferSubData.
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+// Places every entity quad on the tiles the 2D view can see.  Each cell of the unfolding says which tile shows
+// there and which way round, so the quads (in that tile's texture coords, see getPixelPos() in the node network
+// shader) just need taking back to the cell's coords.
+bool GuiManager::buildEntityInstances(glm::mat4 windowToWorldSpace)
+{
+	entityInstances.clear();
+	const EntitySnapshot& entities = *snapshot().entities;
+	if (entities.quads.empty()) return true;
+
+	// World space box the view covers, the projection can be rotated so check every corner:
+	glm::vec2 worldMin(FLT_MAX), worldMax(-FLT_MAX);
+	for (glm::vec2 c : { glm::vec2(-1, -1), glm::vec2(1, -1), glm::vec2(1, 1), glm::vec2(-1, 1) }) {
+		glm::vec2 w = glm::vec2(windowToWorldSpace * glm::vec4(c, 0, 1));
+		worldMin = glm::min(worldMin, w);
+		worldMax = glm::max(worldMax, w);
+	}
+	glm::vec2 povPos = glm::vec2(windowToWorldSpace * glm::vec4(0, 0, 0, 1));
+	const std::vector<GPU_Tile>& tiles = snapshot().tiles->gpuTiles;
+	PovView pov = povView();
+	if (!surfaceUnfolding.build(tiles, pov.tileIndex, pov.mapType, povPos, worldMin, worldMax)) {
+		if (!warnedUnfoldingTooBig) {
+			std::cout << "ERROR::GUI_MANAGER:: 2D view is too big to unfold (over " << SurfaceUnfolding::MAX_CELLS
+				<< " cells), drawing entities per pixel until it isn't" << std::endl;
+			warnedUnfoldingTooBig = true;
+		}
+		return false;
+	}
+
+	const std::vector<int>& ranges = entities.tileQuadRanges;
+	SurfaceUnfolding& u = surfaceUnfolding;
+	for (int y = u.minCell.y; y <= u.maxCell.y; y++) {
+		for (int x = u.minCell.x; x <= u.maxCell.x; x++) {
+			int tile = u.cellTiles[u.cellIndex(x, y)];
+			if (tile == -1 || 2 * tile >= (int)ranges.size() || ranges[2 * tile + 1] == 0) continue;
+
+			// Same corners as getPixelPos() in the shader, mirrored maps need the +1:
+			MapType m = u.cellMaps[u.cellIndex(x, y)];
+			int s = tnav::map(m, LOCAL_ALIGNMENT_1), w = tnav::map(m, LOCAL_ALIGNMENT_2), n = tnav::map(m, LOCAL_ALIGNMENT_3);
+			if (m > 3) { s = (s + 1) % 4; w = (w + 1) % 4; n = (n + 1) % 4; }
+			glm::vec2 southWest = tiles[tile].getTexCoord(w);
+			glm::vec2 xDir = tiles[tile].getTexCoord(s) - southWest;
+			glm::vec2 yDir = tiles[tile].getTexCoord(n) - southWest;
+
+			glm::vec2 cell((float)x, (float)y);
+			int first = ranges[2 * tile], last = first + ranges[2 * tile + 1];
+			for (int i = first; i < last; i++) {
+				const GPU_EntityQuad& q = entities.quads[i];
+				glm::vec2 p(q.x, q.y), o(q.dx, q.dy);
+
+				GPU_EntityInstance instance;
+				instance.pos = cell + glm::vec2(glm::dot(p - southWest, xDir), glm::dot(p - southWest, yDir));
+				instance.offset = glm::vec2(glm::dot(o, xDir), glm::dot(o, yDir));
+				instance.cell = cell;
+				instance.color = entities.quadColors[i];
+				entityInstances.push_back(instance);
+			}
+		}
+	}
+	return true;
+}
+
+// Needs buildEntityInstances() first, see draw2d3rdPerson():
+void GuiManager::drawEntityInstances(Button* sceneView)
+{
+	glm::mat4 worldToWindowSpace = p_camera->getProjectionMatrix((float)sceneView->pixelWidth(), (float)sceneView->pixelHeight());
+	if (entityInstances.empty()) return;
+
+	// Corners, then instances, then indices, all in one allocation:
+	const GLfloat corners[8] = { -0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f };
+	const GLuint quadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+	GLsizeiptr instanceBytes = entityInstances.size() * sizeof(GPU_EntityInstance);
+	StreamBuffer& stream = p_framebuffer->streamBuffer;
+	StreamAllocation a = stream.allocate(sizeof(corners) + instanceBytes + sizeof(quadIndices), sizeof(GLfloat));
+	memcpy(a.ptr, corners, sizeof(corners));
+	memcpy(a.ptr + sizeof(corners), entityInstances.data(), instanceBytes);
+	memcpy(a.ptr + sizeof(corners) + instanceBytes, quadIndices, sizeof(quadIndices));
+	stream.commit(a);
+
+	p_shaderManager->entityInstances.use();
+	auto& uniforms = p_shaderManager->entityInstancesUniforms;
+	uniforms.inWorldToWindowSpace.set(worldToWindowSpace);
+	uniforms.updateProgress.set(float(TimeSinceProgramStart - snapshot().lastTickTime) / UpdateTime);
+
+	stream.bind();
+	defineVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*)a.offset);
+	GLintptr instances = a.offset + sizeof(corners);
+	GLsizei stride = sizeof(GPU_EntityInstance);
+	defineVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, stride, (void*)(instances + offsetof(GPU_EntityInstance, pos)));
+	defineVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, stride, (void*)(instances + offsetof(GPU_EntityInstance, offset)));
+	defineVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, stride, (void*)(instances + offsetof(GPU_EntityInstance, cell)));
+	defineVertexAttribPointer(4, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(instances + offsetof(GPU_EntityInstance, color)));
+	for (GLuint i = 1; i <= 4; i++) glVertexAttribDivisor(i, 1);
+
+	glDrawElementsInstanced(GL_TRIANGLES, 6, GL_UNSIGNED_INT, (void*)(instances + instanceBytes),
+							(GLsizei)entityInstances.size());
 
 	glBindVertexArray(0);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -434,12 +703,24 @@ void GuiManager::draw2d3rdPersonViaNodeNetwork()
 
 void GuiManager::draw2d3rdPerson() {
 	setupFramebufferForButtonRender(ButtonManager::pov2d3rdPersonViewButtonIndex, 
-									p_framebuffer->pov2D3rdPersonTextureID);
+									RENDER_TARGET_POV_2D_3RD_PERSON);
 
-	switch (renderType2d3rdPerson) {
-	//case cpuCropping: draw2d3rdPersonCpuCropping(); break;
-	//case gpu2dRayCasting: draw2d3rdPersonGpuRaycasting(); break;
-	case gpuViaNodeNetwork: draw2d3rdPersonViaNodeNetwork(); break;
+	// Before the ray cast, which draws the entities itself when the instances can't:
+	Button* sceneView = &p_buttonManager->buttons[ButtonManager::pov2d3rdPersonViewButtonIndex];
+	drawingEntityInstances = instancedEntities && buildEntityInstances(glm::inverse(
+		p_camera->getProjectionMatrix((float)sceneView->pixelWidth(), (float)sceneView->pixelHeight())));
+
+	{
+		GPU_PROFILE_SCOPE(sceneGpuTimer, GPU_PASS_2D_RAYCAST);
+		switch (renderType2d3rdPerson) {
+		//case cpuCropping: draw2d3rdPersonCpuCropping(); break;
+		//case gpu2dRayCasting: draw2d3rdPersonGpuRaycasting(); break;
+		case gpuViaNodeNetwork: draw2d3rdPersonViaNodeNetwork(); break;
+		}
+	}
+	if (drawingEntityInstances) {
+		GPU_PROFILE_SCOPE(sceneGpuTimer, GPU_PASS_2D_ENTITIES);
+		drawEntityInstances(sceneView);
 	}
 
 	if (p_currentSelection->canEditTiles) {
@@ -450,21 +731,26 @@ void GuiManager::draw2d3rdPerson() {
 	p_framebuffer->unbind_framebuffer();
 
 	// Render off-screen buffer to window:
+	GPU_PROFILE_SCOPE(sceneGpuTimer, GPU_PASS_BUTTON_COMPOSITE);
 	p_buttonManager->renderButton(p_buttonManager->buttons[p_buttonManager->pov2d3rdPersonViewButtonIndex], 
-								  p_framebuffer->pov2D3rdPersonTextureID);
+								  p_framebuffer->getTextureID(RENDER_TARGET_POV_2D_3RD_PERSON));
 }
 
 void GuiManager::draw3d3rdPerson() {
 	setupFramebufferForButtonRender(ButtonManager::pov3d3rdPersonViewButtonIndex, 
-									p_framebuffer->pov3D3rdPersonTextureID);
+									RENDER_TARGET_POV_3D_3RD_PERSON);
 	
-	draw3Dview();
+	{
+		GPU_PROFILE_SCOPE(sceneGpuTimer, GPU_PASS_3D_TILES);
+		draw3Dview();
+	}
 	//p_tileManager->drawPlayerPos();
 
 	p_framebuffer->unbind_framebuffer();
 
+	GPU_PROFILE_SCOPE(sceneGpuTimer, GPU_PASS_BUTTON_COMPOSITE);
 	p_buttonManager->renderButton(p_buttonManager->buttons[p_buttonManager->pov3d3rdPersonViewButtonIndex],
-								  p_framebuffer->pov3D3rdPersonTextureID);
+								  p_framebuffer->getTextureID(RENDER_TARGET_POV_3D_3RD_PERSON));
 }
 
 void GuiManager::drawTilesSetup()
@@ -475,11 +761,6 @@ void GuiManager::drawTilesSetup()
 	glDisable(GL_STENCIL_TEST);
 	glDisable(GL_BLEND);
 
-	glBindVertexArray(p_framebuffer->VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, p_framebuffer->VBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, p_framebuffer->EBO);
-
-	setVertAttribVec3PosVec3NormVec3ColorVec2TextCoord1Index();
 	p_shaderManager->POV3D3rdPerson.use();
 }
 
@@ -493,8 +774,7 @@ void GuiManager::draw3Dview()
 
 	Button* button = &p_buttonManager->buttons[ButtonManager::pov3d3rdPersonViewButtonIndex];
 	float aspectRatio = (float)button->pixelWidth() / (float)button->pixelHeight();
-	GLuint transfMatrixID = glGetUniformLocation(p_shaderManager->POV3D3rdPerson.ID, "inTransfMatrix");
-	glUniformMatrix4fv(transfMatrixID, 1, GL_FALSE, glm::value_ptr(p_pov->finalRotation));
+	p_shaderManager->POV3D3rdPersonUniforms.inTransfMatrix.set(p_pov->finalRotation);
 
 	//GLuint playerPosInfoID = glGetUniformLocation(p_shaderManager->POV3D3rdPerson.ID, "inPlayerPosInfo");
 	//glUniformMatrix4fv(playerPosInfoID, 1, GL_FALSE, glm::value_ptr(packedPlayerPosInfo()));
@@ -509,74 +789,77 @@ void GuiManager::draw3Dview()
 
 	glDrawBuffer(GL_COLOR_ATTACHMENT0);
 
-	for (int i = 0; i < p_nodeNetwork->numTileInfos(); i++) {
-		Tile* tile = p_nodeNetwork->getTile(i);
-		if (tile->index == -1) continue;
-		else draw3DTile(tile);
-	}
+	p_shaderManager->POV3D3rdPersonUniforms.inAlpha.set(1.0f);
+	p_shaderManager->POV3D3rdPersonUniforms.inColorAlpha.set(0.5f);
+
+	// only send the tiles that can actually be seen, all in one go since they share every uniform:
+	bvh3D.cullFrustum(p_pov->finalRotation, visibleTiles3D);
+	const std::vector<TileSnapshot::Tile3D>& tiles = snapshot().tiles->tiles3D;
+	visibleTiles3D.erase(std::remove_if(visibleTiles3D.begin(), visibleTiles3D.end(),
+										[&](int i) { return i >= (int)tiles.size() || !tiles[i].live; }),
+						 visibleTiles3D.end());
+	// Every tile gets a slot of the same size in the batch, so they can be filled in on any core:
+	int numTiles = (int)visibleTiles3D.size();
+	verts.resize((size_t)numTiles * 4 * TileSnapshot::FLOATS_PER_VERT);
+	indices.resize((size_t)numTiles * 6);
+	GlobalJobSystem.parallelFor(numTiles, 1024, [&](int begin, int end) {
+		for (int slot = begin; slot < end; slot++) draw3DTile(tiles[visibleTiles3D[slot]], slot);
+	});
+	if (!indices.empty()) drawStreamed(verts, indices, 12, setVertAttribVec3PosVec3NormVec3ColorVec2TextCoord1Index);
 
 	drawTilesCleanup();
 }
 
-void GuiManager::draw3DTile(Tile* info)
+void GuiManager::draw3DTile(const TileSnapshot::Tile3D& tile, int slot)
 {
-	const glm::vec3* offsets = tnav::getNodePositionOffsets(info->type);
-	glm::vec3 center = p_nodeNetwork->getNode(info->centerNodeIndex)->getPosition();
-	glm::vec3 normal = tnav::getNormal(info->type);
-	//vechelp::println(normal);
-
-	// prepare the tile:
-	verts.clear();
-	indices.clear();
-	for (int i = 0; i < 4; i++) {
-		// pos:
-		glm::vec3 pos = center + offsets[i + 4];
-		verts.push_back((GLfloat)pos.x);
-		verts.push_back((GLfloat)pos.y);
-		verts.push_back((GLfloat)pos.z);
-		// normal:
-		verts.push_back(normal.x);
-		verts.push_back(normal.y);
-		verts.push_back(normal.z);
-		// color:
-		verts.push_back((GLfloat)info->color.r);
-		verts.push_back((GLfloat)info->color.g);
-		verts.push_back((GLfloat)info->color.b);
-		// texture coord:
-		verts.push_back(info->textureCoordinates[i].x);
-		verts.push_back(info->textureCoordinates[i].y);
-		// tile index:
-		verts.push_back((GLfloat)info->index);
-	}
+	// copy the tile into its slot of the batch (the snapshot already laid out the verts):
+	static const GLuint frontOrder[6] = { 0, 1, 3, 1, 2, 3 };
+	static const GLuint backOrder[6] = { 3, 1, 0, 3, 2, 1 };
+	GLuint first = (GLuint)slot * 4;
+	std::copy(std::begin(tile.verts), std::end(tile.verts), verts.begin() + (size_t)first * TileSnapshot::FLOATS_PER_VERT);
+
+	const GLuint* order = tile.front ? frontOrder : backOrder;
+	GLuint* out = &indices[(size_t)slot * 6];
+	for (int i = 0; i < 6; i++) out[i] = first + order[i];
+}
+
+void GuiManager::drawStreamed(const std::vector<GLfloat>& verts, const std::vector<GLuint>& indices,
+							  GLsizei floatsPerVert, void (*setVertAttribs)())
+{
+	StreamBuffer& stream = p_framebuffer->streamBuffer;
+	StreamAllocation alloc = stream.uploadIndexed(verts.data(), sizeof(GLfloat) * verts.size(),
+												  floatsPerVert * sizeof(GLfloat),
+												  indices.data(), sizeof(GLuint) * indices.size());
+	stream.bind();
+	setVertAttribs();
+	glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT,
+							 alloc.indexOffset(), alloc.baseVertex());
+}
 
-	if (tnav::isFront(info->type)) {
-		indices.push_back(0);
-		indices.push_back(1);
-		indices.push_back(3);
-		indices.push_back(1);
-		indices.push_back(2);
-		indices.push_back(3);
+// Sends whatever changed in the newest snapshot over.  The tiles and quad ranges have their own buffers since they
+// hardly ever change, the quads get streamed every frame anyway.
+void GuiManager::uploadSnapshot()
+{
+	const WorldSnapshot& s = snapshot();
+	if (s.tiles != nullptr && s.tiles->version != uploadedTilesVersion) {
+		const TileSnapshot& t = *s.tiles;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, p_nodeNetwork->tilesBufferID);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, t.gpuTiles.size() * sizeof(GPU_Tile), t.gpuTiles.data(), GL_STATIC_DRAW);
+		GlobalGlBufferMemory.set(p_nodeNetwork->tilesBufferID, t.gpuTiles.size() * sizeof(GPU_Tile));
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, p_nodeNetwork->tileLodsBufferID);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, t.gpuTileLods.size() * sizeof(GPU_TileLod), t.gpuTileLods.data(), GL_STATIC_DRAW);
+		GlobalGlBufferMemory.set(p_nodeNetwork->tileLodsBufferID, t.gpuTileLods.size() * sizeof(GPU_TileLod));
+		bvh3D = t.bvh;
+		uploadedTilesVersion = t.version;
 	}
-	else {
-		indices.push_back(3);
-		indices.push_back(1);
-		indices.push_back(0);
-		indices.push_back(3);
-		indices.push_back(2);
-		indices.push_back(1);
+	if (s.entities != nullptr && s.entities->rangesVersion != uploadedRangesVersion) {
+		const std::vector<int>& ranges = s.entities->tileQuadRanges;
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, p_entityManager->tileEntityQuadRangesBufferID);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, ranges.size() * sizeof(int), ranges.data(), GL_DYNAMIC_DRAW);
+		GlobalGlBufferMemory.set(p_entityManager->tileEntityQuadRangesBufferID, ranges.size() * sizeof(int));
+		uploadedRangesVersion = s.entities->rangesVersion;
 	}
-
-	GLuint alphaID = glGetUniformLocation(p_shaderManager->POV3D3rdPerson.ID, "inAlpha");
-	glUniform1f(alphaID, 1.0f);
-
-	GLuint colorAlphaID = glGetUniformLocation(p_shaderManager->POV3D3rdPerson.ID, "inColorAlpha");
-	glUniform1f(colorAlphaID, 0.5f);
-
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_2D, p_nodeNetwork->texID);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(GLfloat) * verts.size(), verts.data(), GL_DYNAMIC_DRAW);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
 }
 
 void GuiManager::render() {
@@ -584,10 +867,26 @@ void GuiManager::render() {
 		renderButton(b);
 	}*/
 
-	draw2d3rdPerson();
-	draw3d3rdPerson();
+	if (p_simulation->snapshots.update()) uploadSnapshot();
+	if (snapshot().tiles == nullptr) return; // nothing published yet.
+
+	p_framebuffer->beginFrame();
+	p_framebuffer->streamBuffer.beginFrame();
+	sceneGpuTimer.beginFrame();
+
+	{
+		PROFILE_SCOPE(PROFILE_PHASE_DRAW_2D);
+		draw2d3rdPerson();
+	}
+	{
+		PROFILE_SCOPE(PROFILE_PHASE_DRAW_3D);
+		draw3d3rdPerson();
+	}
 
 	if (p_buttonManager->p_targetButton != nullptr) {
+		GPU_PROFILE_SCOPE(sceneGpuTimer, GPU_PASS_BUTTON_COMPOSITE);
 		renderTargetButtonMovementElements(); // outlines for buttons and stuff
 	}
+
+	p_framebuffer->streamBuffer.endFrame();
 }
\ No newline at end of file
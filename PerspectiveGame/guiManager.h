@@ -10,8 +10,10 @@
 #define GUI_MANAGER_DEFINED
 #define USE_GUI_WINDOW
 
+#ifdef _WIN32
 #define NOMINMAX
 #include<Windows.h>
+#endif
 
 #include"globalVariables.h"
 #include "imgui.h"
@@ -35,6 +37,11 @@
 #include "tileNodeNetwork.h"
 #include "entityManager.h"
 #include "pov.h"
+#include "profiler.h"
+#include "gpuTimer.h"
+#include "stepHistogram.h"
+#include "surfaceUnfolding.h"
+#include "simulation.h"
 
 // [Win32] Our example includes a copy of glfw3.lib pre-compiled with VS2010 to maximize ease of testing and compatibility with old VS compilers.
 // To link with VS2010-era libraries, VS2015+ requires linking with legacy_stdio_definitions.lib, which we do using this pragma.
@@ -54,6 +61,12 @@ enum RenderType2d3rdPerson {
 	gpuViaNodeNetwork,
 };
 
+// Matches DEBUG_RENDER_MODE_* in 2d3rdPersonPovViaNodeNetwork.frag:
+enum DebugRenderMode2D {
+	DEBUG_RENDER_MODE_NONE,
+	DEBUG_RENDER_MODE_STEP_HEATMAP,
+};
+
 struct GuiManager {
 public:
 	int GUI_WINDOW_BORDER_EDGE_SIZE = 4;
@@ -73,6 +86,13 @@ public:
 
 	TileNodeNetwork* p_nodeNetwork;
 	POV* p_pov;
+	// Everything drawn from the world comes out of the simulation's latest snapshot, never the live world
+	// (the simulation thread may be changing it).  Only the gl handles and p_pov->finalRotation get used directly.
+	Simulation* p_simulation;
+	PovView livePov; // set by the input thread whenever it gets to move the pov.
+	TileBVH bvh3D; // the snapshot's, copied since culling refits it.
+	int uploadedTilesVersion = -1;
+	int uploadedRangesVersion = -1;
 
 	bool show_demo_window;
 	bool show_another_window;
@@ -82,8 +102,30 @@ public:
 
 	float frameTime;
 
+	std::vector<int> visibleTiles3D; // filled by frustum culling every frame
+
+	// One per context, queries don't get shared between them:
+	GpuTimer sceneGpuTimer;
+	GpuTimer imGuiGpuTimer;
+
+	int debugRenderMode2D = DEBUG_RENDER_MODE_NONE;
+	bool collectStepHistogram = false; // always on in the heatmap mode.
+	// Two buffers so the one being read back is a couple frames old and (almost always) done:
+	GLuint stepHistogramBufferIDs[2] = {};
+	bool stepHistogramWritten[2] = {};
+	int currentStepHistogramBuffer = 0;
+	StepHistogram gpuRaySteps{ MAX_NODE_NETWORK_RAY_STEPS }; // per frame.
+
 	const RenderType2d3rdPerson renderType2d3rdPerson = gpuViaNodeNetwork;
 
+	// Entities drawn as instanced quads over the 2D view instead of tested for in every pixel of it:
+	bool instancedEntities = true;
+	// This frame's choice: instanced unless the view is too zoomed out to unfold, then the shader draws them:
+	bool drawingEntityInstances = false;
+	bool warnedUnfoldingTooBig = false;
+	SurfaceUnfolding surfaceUnfolding; // rebuilt every frame for the visible part of the 2D view.
+	std::vector<GPU_EntityInstance> entityInstances;
+
 public:
 	void imGuiSetup();
 	GuiManager(GLFWwindow* w,
@@ -96,7 +138,8 @@ public:
 			   CurrentSelection* cs,
 			   EntityManager* em,
 			   TileNodeNetwork* nn,
-			   POV* pov)
+			   POV* pov,
+			   Simulation* sim)
 		: p_window(w)
 		, p_imGuiWindow(imgw)
 		, p_shaderManager(sm)
@@ -108,6 +151,7 @@ public:
 		, p_entityManager(em)
 		, p_nodeNetwork(nn)
 		, p_pov(pov)
+		, p_simulation(sim)
 	{
 
 		imGuiSetup();
@@ -117,18 +161,28 @@ public:
 	
 	~GuiManager();
 
-	void setupFramebufferForButtonRender(int buttonIndex, GLuint textureID);
+	void setupFramebufferForButtonRender(int buttonIndex, RenderTargetID renderTarget);
 
 	void renderImGuiDebugWindows();
 
 	void renderTargetButtonMovementElements();
 	void draw2d3rdPersonViaNodeNetwork();
+	bool stepHistogramEnabled() { return collectStepHistogram || debugRenderMode2D == DEBUG_RENDER_MODE_STEP_HEATMAP; }
+	void bindStepHistogramBuffer();
 	void draw2d3rdPerson();
 	void draw3d3rdPerson();
 	void render();
 
+	const WorldSnapshot& snapshot() const { return p_simulation->snapshots.read(); }
+	void uploadSnapshot();
+	// The live pov is a frame or so ahead of the snapshot, but can be on a tile the snapshot doesn't have yet:
+	PovView povView() const { return livePov.worldVersion == snapshot().worldVersion ? livePov : snapshot().pov; }
+
 	void bindSSBOs2d3rdPersonViaNodeNetwork();
 	void bindUniforms2d3rdPersonViaNodeNetwork(Button* sceneView);
+	// False if the view needs more cells than SurfaceUnfolding does, the instances would miss some entities then:
+	bool buildEntityInstances(glm::mat4 windowToWorldSpace);
+	void drawEntityInstances(Button* sceneView);
 
 	void drawColoredRectFromPixelSpace(glm::ivec2 pos, glm::ivec2 size, glm::vec3 color);
 	// Assumes screen space:
@@ -145,7 +199,12 @@ public:
 
 	void draw3Dview();
 
-	void draw3DTile(Tile* info);
+	// Writes the tile's verts/indices into slot of the global batch (sized by draw3Dview(), which draws them all at once).
+	void draw3DTile(const TileSnapshot::Tile3D& tile, int slot);
+
+	// Uploads through the framebuffer's stream buffer and draws as triangles:
+	void drawStreamed(const std::vector<GLfloat>& verts, const std::vector<GLuint>& indices,
+					  GLsizei floatsPerVert, void (*setVertAttribs)());
 
 	void drawTilesCleanup()
 	{
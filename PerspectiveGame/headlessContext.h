@@ -0,0 +1,144 @@
+#pragma once
+#include <iostream>
+#include <string>
+
+#include"dependancyHeaders.h"
+
+// The surfaceless EGL backend needs no display or window system at all, so it's what CI runs on (Mesa's llvmpipe
+// with no gpu).  The CMake build (CMakeLists.txt, for Linux) defines HEADLESS_EGL and links libEGL; the Visual
+// Studio one doesn't, so on Windows there are only the two glfw backends and they need a desktop session.
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// How to get a gl context with nothing on screen, for benchmarks and CI:
+enum HeadlessBackend {
+	HEADLESS_BACKEND_HIDDEN_WINDOW, // normal driver, invisible glfw window.  Still needs a desktop session.
+	HEADLESS_BACKEND_OSMESA,        // invisible glfw window with a Mesa (llvmpipe) software context.  Same.
+	HEADLESS_BACKEND_EGL,           // EGL_MESA_platform_surfaceless, no glfw at all.  Needs HEADLESS_EGL (the CMake build).
+};
+
+inline bool parseHeadlessBackend(const std::string& name, HeadlessBackend& out)
+{
+	if (name == "hidden") out = HEADLESS_BACKEND_HIDDEN_WINDOW;
+	else if (name == "osmesa") out = HEADLESS_BACKEND_OSMESA;
+	else if (name == "egl") out = HEADLESS_BACKEND_EGL;
+	else return false;
+	return true;
+}
+
+// A current gl context (4.3 core, the node network shader needs ssbos) with glad loaded and no visible window.
+// Everything renders into the Framebuffer's render targets as usual.  With EGL there is no default framebuffer
+// so the final button composite just draws into nothing; with the glfw backends it goes to the hidden window.
+struct HeadlessContext {
+	HeadlessBackend backend = HEADLESS_BACKEND_HIDDEN_WINDOW;
+	GLFWwindow* window = nullptr; // null with EGL.  App::window takes it over and destroys it like any other window.
+
+#ifdef HEADLESS_EGL
+private:
+	EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+	EGLContext eglContext = EGL_NO_CONTEXT;
+public:
+#endif
+
+	~HeadlessContext() { destroy(); }
+
+	bool init(HeadlessBackend b, glm::ivec2 size)
+	{
+		backend = b;
+		switch (backend) {
+		case HEADLESS_BACKEND_HIDDEN_WINDOW: return initGlfw(size, false);
+		case HEADLESS_BACKEND_OSMESA: return initGlfw(size, true);
+		case HEADLESS_BACKEND_EGL: return initEgl();
+		}
+		return false;
+	}
+
+	void destroy()
+	{
+#ifdef HEADLESS_EGL
+		if (eglDisplay != EGL_NO_DISPLAY) {
+			eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+			if (eglContext != EGL_NO_CONTEXT) eglDestroyContext(eglDisplay, eglContext);
+			eglTerminate(eglDisplay);
+			eglDisplay = EGL_NO_DISPLAY;
+			eglContext = EGL_NO_CONTEXT;
+		}
+#endif
+	}
+
+private:
+	bool initGlfw(glm::ivec2 size, bool osMesa)
+	{
+		if (!glfwInit()) {
+			std::cout << "ERROR::HEADLESS_CONTEXT:: GLFW initialisation failed!" << std::endl;
+			return false;
+		}
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+		glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+		if (osMesa) glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+
+		window = glfwCreateWindow(size.x, size.y, "Tiles In 3D (headless)", NULL, NULL);
+		glfwDefaultWindowHints();
+		if (window == nullptr) {
+			std::cout << "ERROR::HEADLESS_CONTEXT:: could not create a hidden window"
+				<< (osMesa ? " (is OSMesa installed?)" : "") << std::endl;
+			return false;
+		}
+		glfwMakeContextCurrent(window);
+		glfwSwapInterval(0);
+
+		if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+			std::cout << "ERROR::HEADLESS_CONTEXT:: failed to initialize GLAD!" << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	bool initEgl()
+	{
+#ifdef HEADLESS_EGL
+		auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+		if (getPlatformDisplay == nullptr) {
+			std::cout << "ERROR::HEADLESS_CONTEXT:: no eglGetPlatformDisplayEXT" << std::endl;
+			return false;
+		}
+		eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+		EGLint major, minor;
+		if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+			std::cout << "ERROR::HEADLESS_CONTEXT:: could not open a surfaceless EGL display" << std::endl;
+			eglDisplay = EGL_NO_DISPLAY;
+			return false;
+		}
+		if (!eglBindAPI(EGL_OPENGL_API)) {
+			std::cout << "ERROR::HEADLESS_CONTEXT:: EGL has no desktop gl" << std::endl;
+			return false;
+		}
+
+		const EGLint contextAttribs[] = {
+			EGL_CONTEXT_MAJOR_VERSION, 4,
+			EGL_CONTEXT_MINOR_VERSION, 3,
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+			EGL_NONE,
+		};
+		// Surfaceless, so no config needed (EGL_KHR_no_config_context):
+		eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+		if (eglContext == EGL_NO_CONTEXT || !eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+			std::cout << "ERROR::HEADLESS_CONTEXT:: could not make a surfaceless 4.3 core context" << std::endl;
+			return false;
+		}
+
+		if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+			std::cout << "ERROR::HEADLESS_CONTEXT:: failed to initialize GLAD!" << std::endl;
+			return false;
+		}
+		return true;
+#else
+		std::cout << "ERROR::HEADLESS_CONTEXT:: built without HEADLESS_EGL" << std::endl;
+		return false;
+#endif
+	}
+};
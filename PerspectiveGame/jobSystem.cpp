@@ -0,0 +1,211 @@
+#include "jobSystem.h"
+
+JobSystem GlobalJobSystem;
+
+namespace {
+	// Which worker of which system this thread is, if it's one at all:
+	thread_local const JobSystem* workerOf = nullptr;
+	thread_local int workerIndex = -1;
+}
+
+void JobSystem::start(int numWorkers)
+{
+	if (running) return;
+	if (numWorkers < 0) numWorkers = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+	running = true;
+	for (int i = 0; i < numWorkers; i++) workers.push_back(std::make_unique<Worker>());
+	// Only once they're all there, since they steal from each other straight away:
+	for (int i = 0; i < numWorkers; i++) workers[i]->thread = std::thread(&JobSystem::workerMain, this, i);
+	workerStats.assign(numWorkers, WorkerStats());
+	lastSample = std::chrono::steady_clock::now();
+}
+
+void JobSystem::stop()
+{
+	if (!running) return;
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex);
+		running = false;
+	}
+	wakeUp.notify_all();
+	for (auto& w : workers) w->thread.join();
+	workers.clear();
+	sharedJobs.clear();
+	numQueued = 0;
+}
+
+JobHandle JobSystem::create(std::function<void()> work, const JobHandle& parent)
+{
+	JobHandle job = std::make_shared<Job>();
+	job->work = std::move(work);
+	job->parent = parent;
+	if (parent != nullptr) parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+	return job;
+}
+
+void JobSystem::addDependency(const JobHandle& job, const JobHandle& dependency)
+{
+	job->blockers.fetch_add(1, std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> lock(dependency->continuationsMutex);
+		if (!dependency->finished) {
+			dependency->continuations.push_back(job);
+			return;
+		}
+	}
+	// Already done.  Can't be the last blocker, the job isn't submitted yet:
+	job->blockers.fetch_sub(1, std::memory_order_relaxed);
+}
+
+void JobSystem::submit(const JobHandle& job) { unblock(job); }
+
+JobHandle JobSystem::run(std::function<void()> work)
+{
+	JobHandle job = create(std::move(work));
+	submit(job);
+	return job;
+}
+
+JobHandle JobSystem::then(const JobHandle& job, std::function<void()> work)
+{
+	JobHandle next = create(std::move(work));
+	addDependency(next, job);
+	submit(next);
+	return next;
+}
+
+void JobSystem::wait(const JobHandle& job)
+{
+	int self = currentWorker();
+	while (!job->done.load(std::memory_order_acquire)) {
+		if (!runOne(self)) std::this_thread::yield();
+	}
+}
+
+const std::vector<JobSystem::WorkerStats>& JobSystem::stats()
+{
+	auto now = std::chrono::steady_clock::now();
+	uint64_t elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - lastSample).count();
+	if (elapsedNs < 250000000) return workerStats;
+	lastSample = now;
+	for (int i = 0; i < (int)workers.size(); i++) {
+		Worker& w = *workers[i];
+		uint64_t busyNs = w.busyNs.load(std::memory_order_relaxed);
+		// A long job lands all at once when it ends, so this can go over 1 for a sample:
+		workerStats[i].utilization = std::min(1.0f, float(busyNs - w.sampledBusyNs) / float(elapsedNs));
+		workerStats[i].jobsRun = w.jobsRun.load(std::memory_order_relaxed);
+		workerStats[i].jobsStolen = w.jobsStolen.load(std::memory_order_relaxed);
+		w.sampledBusyNs = busyNs;
+	}
+	return workerStats;
+}
+
+void JobSystem::push(const JobHandle& job)
+{
+	int self = currentWorker();
+	if (self >= 0) {
+		std::lock_guard<std::mutex> lock(workers[self]->mutex);
+		workers[self]->jobs.push_back(job);
+	}
+	else {
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		sharedJobs.push_back(job);
+	}
+	numQueued.fetch_add(1, std::memory_order_release);
+	// Through the mutex so a worker between checking numQueued and going to sleep doesn't miss it:
+	{ std::lock_guard<std::mutex> lock(sleepMutex); }
+	wakeUp.notify_one();
+}
+
+// Own newest first (still warm in cache), then the shared queue, then the oldest of someone else's:
+JobHandle JobSystem::pop(int self)
+{
+	JobHandle job;
+	if (numQueued.load(std::memory_order_acquire) == 0) return job;
+	if (self >= 0) {
+		Worker& w = *workers[self];
+		std::lock_guard<std::mutex> lock(w.mutex);
+		if (!w.jobs.empty()) {
+			job = std::move(w.jobs.back());
+			w.jobs.pop_back();
+		}
+	}
+	if (job == nullptr) {
+		std::lock_guard<std::mutex> lock(sharedMutex);
+		if (!sharedJobs.empty()) {
+			job = std::move(sharedJobs.front());
+			sharedJobs.pop_front();
+		}
+	}
+	int n = (int)workers.size();
+	for (int i = 1; job == nullptr && i <= n; i++) {
+		int victim = (std::max(self, 0) + i) % n;
+		if (victim == self) continue;
+		Worker& w = *workers[victim];
+		std::lock_guard<std::mutex> lock(w.mutex);
+		if (!w.jobs.empty()) {
+			job = std::move(w.jobs.front());
+			w.jobs.pop_front();
+			if (self >= 0) workers[self]->jobsStolen.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+	if (job != nullptr) numQueued.fetch_sub(1, std::memory_order_relaxed);
+	return job;
+}
+
+bool JobSystem::runOne(int self)
+{
+	JobHandle job = pop(self);
+	if (job == nullptr) return false;
+	execute(job);
+	return true;
+}
+
+void JobSystem::execute(const JobHandle& job)
+{
+	if (job->work) job->work();
+	finish(job.get());
+}
+
+void JobSystem::unblock(const JobHandle& job)
+{
+	if (job->blockers.fetch_sub(1, std::memory_order_acq_rel) == 1) push(job);
+}
+
+void JobSystem::finish(Job* job)
+{
+	if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) return;
+	std::vector<JobHandle> next;
+	{
+		std::lock_guard<std::mutex> lock(job->continuationsMutex);
+		job->finished = true;
+		next.swap(job->continuations);
+	}
+	// Hang on to the parent, the last thing holding it may be this job's handle:
+	JobHandle parent = std::move(job->parent);
+	job->done.store(true, std::memory_order_release);
+	for (const JobHandle& n : next) unblock(n);
+	if (parent != nullptr) finish(parent.get());
+}
+
+void JobSystem::workerMain(int index)
+{
+	workerOf = this;
+	workerIndex = index;
+	Worker& self = *workers[index];
+	while (running) {
+		JobHandle job = pop(index);
+		if (job == nullptr) {
+			std::unique_lock<std::mutex> lock(sleepMutex);
+			wakeUp.wait(lock, [this] { return !running || numQueued.load(std::memory_order_acquire) > 0; });
+			continue;
+		}
+		auto start = std::chrono::steady_clock::now();
+		execute(job);
+		self.busyNs.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count(),
+							  std::memory_order_relaxed);
+		self.jobsRun.fetch_add(1, std::memory_order_relaxed);
+	}
+}
+
+int JobSystem::currentWorker() const { return workerOf == this ? workerIndex : -1; }
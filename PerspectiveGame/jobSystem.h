@@ -0,0 +1,124 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <memory>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <cstdint>
+#include <algorithm>
+
+// A work stealing thread pool for the world's big loops.  Each worker has its own deque: it pushes and pops its
+// own jobs at the back and, when it runs out, steals from the front of everyone else's.  Threads that aren't
+// workers (main, simulation) push into a shared queue and help out with whatever's queued while they wait(),
+// so a parallelFor() from any thread uses every core including the caller's.
+//
+// Jobs form a graph: a child has to finish before its parent counts as finished, a dependency has to finish
+// before the job depending on it starts, and then() is a dependency made and submitted in one go.
+// Jobs shouldn't take locks somebody could be wait()ing on while holding, the waiter may be the one running them.
+struct Job;
+using JobHandle = std::shared_ptr<Job>;
+
+struct Job {
+	std::function<void()> work; // may be empty, for a job that only groups children.
+	JobHandle parent;
+	std::atomic<int> unfinished{ 1 }; // itself plus its unfinished children.
+	std::atomic<int> blockers{ 1 };   // unfinished dependencies, plus one until it's submitted.
+	std::atomic<bool> done{ false };
+
+	std::mutex continuationsMutex;
+	bool finished = false;                // same as done, but behind the mutex so nobody adds to a finished job.
+	std::vector<JobHandle> continuations; // submitted as this finishes.
+};
+
+struct JobSystem {
+	struct WorkerStats {
+		float utilization = 0; // share of the last sample spent running jobs.
+		uint64_t jobsRun = 0;   // since start().
+		uint64_t jobsStolen = 0;
+	};
+
+	~JobSystem() { stop(); }
+
+	// numWorkers -1 is one less than the cores (the thread that calls parallelFor() is the last one).  0 runs
+	// everything on whoever wait()s for it, handy for comparing against.
+	void start(int numWorkers = -1);
+	// Jobs still queued are dropped.
+	void stop();
+	int numWorkers() const { return (int)workers.size(); }
+
+	// Made but not queued yet, so dependencies can still be added.  With a parent, the parent isn't done until
+	// this is, and has to be submitted after this is created.
+	JobHandle create(std::function<void()> work, const JobHandle& parent = nullptr);
+	// job won't start until dependency is done.  Only before job is submitted.
+	void addDependency(const JobHandle& job, const JobHandle& dependency);
+	void submit(const JobHandle& job);
+	JobHandle run(std::function<void()> work);
+	// Runs work once job is done.
+	JobHandle then(const JobHandle& job, std::function<void()> work);
+	// Runs other jobs until this one's done.
+	void wait(const JobHandle& job);
+
+	// body(begin, end) over [0, count) in chunks of at least grainSize, returns when they're all done.  Small
+	// loops (or no workers) just run on the caller.
+	template<typename F>
+	void parallelFor(int count, int grainSize, const F& body)
+	{
+		if (count <= 0) return;
+		// No point in many more chunks than threads to steal them, each one costs an allocation or two:
+		int maxChunks = 4 * (numWorkers() + 1);
+		grainSize = std::max({ grainSize, 1, (count + maxChunks - 1) / maxChunks });
+		if (workers.empty() || count <= grainSize) {
+			body(0, count);
+			return;
+		}
+		JobHandle group = create(nullptr);
+		for (int begin = 0; begin < count; begin += grainSize) {
+			int end = std::min(begin + grainSize, count);
+			submit(create([&body, begin, end] { body(begin, end); }, group));
+		}
+		submit(group);
+		wait(group);
+	}
+
+	// Per worker, refreshed at most a few times a second so the numbers hold still long enough to read.  Only
+	// from one thread (the debug window's).
+	const std::vector<WorkerStats>& stats();
+
+private:
+	struct Worker {
+		std::mutex mutex;
+		std::deque<JobHandle> jobs; // behind mutex.
+		std::thread thread;
+		std::atomic<uint64_t> busyNs{ 0 };
+		std::atomic<uint64_t> jobsRun{ 0 };
+		std::atomic<uint64_t> jobsStolen{ 0 };
+		uint64_t sampledBusyNs = 0;
+	};
+
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::mutex sharedMutex;
+	std::deque<JobHandle> sharedJobs; // pushed by threads that aren't workers, behind sharedMutex.
+
+	std::atomic<bool> running{ false };
+	std::atomic<int> numQueued{ 0 };
+	std::mutex sleepMutex;
+	std::condition_variable wakeUp;
+
+	std::vector<WorkerStats> workerStats;
+	std::chrono::steady_clock::time_point lastSample;
+
+	void push(const JobHandle& job);
+	JobHandle pop(int self);
+	bool runOne(int self);
+	void execute(const JobHandle& job);
+	void unblock(const JobHandle& job);
+	void finish(Job* job);
+	void workerMain(int index);
+	int currentWorker() const;
+};
+
+extern JobSystem GlobalJobSystem;
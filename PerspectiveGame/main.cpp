@@ -1,9 +1,96 @@
 #pragma once
 #include "app.h"
+#include "microBenchmark.h"
+#include "soakTest.h"
+#include "streamBufferCheck.h"
+#include "jobSystem.h"
 
-int main() {
+// No arguments runs the game.  For automated benchmarks:
+//   PerspectiveGame --benchmark <camera path> [--scenario <world file>] [--frames n] [--out results.csv] [--headless hidden|osmesa|egl] [--no-hash]
+//   PerspectiveGame --clip-benchmark (no gl needed, see vechelp::runClipBenchmark())
+//   PerspectiveGame --map-benchmark (no gl needed, see tnav::runMapBenchmark())
+//   PerspectiveGame --lod-check [--scenarios <directory>] (no gl needed, see tileLod::runLodCheck())
+//   PerspectiveGame --micro-benchmark [--out results.json] (no gl needed, see microBenchmark.h)
+//   PerspectiveGame --scenarios <directory> [--headless hidden|osmesa|egl [--scenario-out timings.csv]] (see scenarioSetup.h)
+//   PerspectiveGame --soak [--edits n] [--seed s] (no gl needed, see soakTest.h)
+//   PerspectiveGame --stream-buffer-check [--headless hidden|osmesa|egl] (see streamBufferCheck.h)
+// --headless hidden|osmesa only hides the window, glfw still needs a desktop session.  egl needs nothing but Mesa,
+// it's only in the CMake build (see headlessContext.h).
+// Any of them take --workers n, the job system's threads (see jobSystem.h).  0 runs everything on the thread that
+// asked for it, the default is one less than the cores.
+int main(int argc, char** argv) {
+
+	BenchmarkSettings benchmark;
+	HeadlessBackend backend = HEADLESS_BACKEND_HIDDEN_WINDOW;
+	bool headless = false;
+	std::string scenarioDirectory;
+	std::string scenarioTimingsFile = "scenarios.csv";
+	MicroBenchmarkSettings microBenchmark;
+	bool runMicroBenchmark = false;
+	SoakTestSettings soak;
+	bool runSoak = false;
+	bool runLodCheck = false;
+	bool checkStreamBuffer = false;
+	int numWorkers = -1;
+	for (int i = 1; i < argc; i++) {
+		std::string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--clip-benchmark") return vechelp::runClipBenchmark(1000, 1000) ? 0 : 1;
+		else if (arg == "--map-benchmark") return tnav::runMapBenchmark(100000, 1000) ? 0 : 1;
+		else if (arg == "--lod-check") runLodCheck = true;
+		else if (arg == "--micro-benchmark") runMicroBenchmark = true;
+		else if (arg == "--soak") runSoak = true;
+		else if (arg == "--stream-buffer-check") checkStreamBuffer = true;
+		else if (arg == "--edits" && hasValue) soak.numEdits = atoll(argv[++i]);
+		else if (arg == "--seed" && hasValue) soak.seed = (uint32_t)strtoul(argv[++i], nullptr, 10);
+		else if (arg == "--benchmark" && hasValue) benchmark.cameraPathFile = argv[++i];
+		else if (arg == "--scenario" && hasValue) benchmark.scenarioFile = argv[++i];
+		else if (arg == "--frames" && hasValue) benchmark.numFrames = atoi(argv[++i]);
+		else if (arg == "--scenarios" && hasValue) scenarioDirectory = argv[++i];
+		else if (arg == "--out" && hasValue) benchmark.outputFile = microBenchmark.outputFile = argv[++i];
+		else if (arg == "--scenario-out" && hasValue) scenarioTimingsFile = argv[++i];
+		else if (arg == "--no-hash") benchmark.hashImages = false;
+		else if (arg == "--workers" && hasValue) numWorkers = std::max(0, atoi(argv[++i]));
+		else if (arg == "--headless" && hasValue) {
+			headless = true;
+			if (!parseHeadlessBackend(argv[++i], backend)) {
+				std::cout << "ERROR::MAIN:: unknown headless backend " << argv[i] << std::endl;
+				return 1;
+			}
+		}
+		else {
+			std::cout << "ERROR::MAIN:: unknown argument " << arg << std::endl;
+			return 1;
+		}
+	}
+
+	GlobalJobSystem.start(numWorkers);
+
+	if (runSoak) return runSoakTest(soak) ? 0 : 1;
+	if (checkStreamBuffer) return runStreamBufferCheck(backend) ? 0 : 1;
+	if (runLodCheck) return tileLod::runLodCheck(scenarioDirectory.empty() ? "scenarios" : scenarioDirectory) ? 0 : 1;
+	if (runMicroBenchmark) return runMicroBenchmarks(microBenchmark) ? 0 : 1;
+
+	std::vector<std::string> scenarioFiles;
+	if (!scenarioDirectory.empty()) {
+		scenarioFiles = listScenarioFiles(scenarioDirectory);
+		if (scenarioFiles.empty()) {
+			std::cout << "ERROR::MAIN:: no .scenario files in " << scenarioDirectory << std::endl;
+			return 1;
+		}
+	}
 
 	App application;
+	if (!benchmark.cameraPathFile.empty()) {
+		if (!application.initHeadless(backend)) return 1;
+		return application.runBenchmark(benchmark) ? 0 : 1;
+	}
+	if (!scenarioFiles.empty() && headless) {
+		if (!application.initHeadless(backend)) return 1;
+		return application.runScenarios(scenarioFiles, scenarioTimingsFile) ? 0 : 1;
+	}
+	application.scenarioFiles = scenarioFiles;
+
 	application.init();
 	application.run();
 
@@ -0,0 +1,159 @@
+#include "mapBatch.h"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <random>
+
+#ifdef TNAV_MAP_SSSE3
+#include <tmmintrin.h>
+#endif
+
+namespace {
+	// One 16 byte row per map, so a row is one register.  MAP_ALIGNMENT fills 10 of each row, COMBINE_MAPS 8:
+	struct ShuffleRows { alignas(16) uint8_t v[tnav::d4::NUM_MAPS][16]; };
+
+	constexpr ShuffleRows buildMapRows()
+	{
+		ShuffleRows t{};
+		for (int m = 0; m < tnav::d4::NUM_MAPS; m++)
+			for (int a = 0; a < tnav::d4::NUM_ALIGNMENTS; a++) t.v[m][a] = (uint8_t)tnav::MAP_ALIGNMENT.v[m][a];
+		return t;
+	}
+
+	constexpr ShuffleRows buildCombineRows()
+	{
+		ShuffleRows t{};
+		for (int m1 = 0; m1 < tnav::d4::NUM_MAPS; m1++)
+			for (int m2 = 0; m2 < tnav::d4::NUM_MAPS; m2++) t.v[m1][m2] = (uint8_t)tnav::COMBINE_MAPS.v[m1][m2];
+		return t;
+	}
+
+	constexpr ShuffleRows MAP_ROWS = buildMapRows();
+	constexpr ShuffleRows COMBINE_ROWS = buildCombineRows();
+
+	// out[i] = rows[row[i]][column[i]], 16 at a time:
+	void lookup(const ShuffleRows& rows, const uint8_t* row, const uint8_t* column, uint8_t* out, int count)
+	{
+		int i = 0;
+#ifdef TNAV_MAP_SSSE3
+		const __m128i* r = (const __m128i*)rows.v;
+		for (; i + 16 <= count; i += 16) {
+			__m128i rowIndex = _mm_loadu_si128((const __m128i*)(row + i));
+			__m128i columnIndex = _mm_loadu_si128((const __m128i*)(column + i));
+			// Every row looked up, keeping the bytes whose row it was.  Written out so it all stays in registers:
+			auto pick = [&](int m) {
+				__m128i isRow = _mm_cmpeq_epi8(rowIndex, _mm_set1_epi8((char)m));
+				return _mm_and_si128(isRow, _mm_shuffle_epi8(_mm_load_si128(r + m), columnIndex));
+			};
+			__m128i result = _mm_or_si128(_mm_or_si128(_mm_or_si128(pick(0), pick(1)), _mm_or_si128(pick(2), pick(3))),
+										  _mm_or_si128(_mm_or_si128(pick(4), pick(5)), _mm_or_si128(pick(6), pick(7))));
+			_mm_storeu_si128((__m128i*)(out + i), result);
+		}
+#endif
+		for (; i < count; i++) out[i] = rows.v[row[i]][column[i]];
+	}
+}
+
+void tnav::mapBatch(const uint8_t* maps, const uint8_t* alignments, uint8_t* out, int count)
+{
+	lookup(MAP_ROWS, maps, alignments, out, count);
+}
+
+void tnav::combineBatch(const uint8_t* first, const uint8_t* second, uint8_t* out, int count)
+{
+	lookup(COMBINE_ROWS, first, second, out, count);
+}
+
+void tnav::combineChains(const uint8_t* steps, int chainLength, int count, uint8_t* out)
+{
+	if (chainLength <= 0) {
+		for (int i = 0; i < count; i++) out[i] = MAP_TYPE_IDENTITY;
+		return;
+	}
+	for (int i = 0; i < count; i++) out[i] = steps[i];
+	for (int k = 1; k < chainLength; k++) combineBatch(out, steps + k * count, out, count);
+}
+
+bool tnav::runMapBenchmark(int count, int iterations)
+{
+	using clock = std::chrono::steady_clock;
+	const int CHAIN_LENGTH = 8;
+	std::mt19937 rng(1234);
+	std::uniform_int_distribution<int> mapDist(0, d4::NUM_MAPS - 1), alignmentDist(0, d4::NUM_ALIGNMENTS - 1);
+
+	std::vector<uint8_t> maps(count), alignments(count), steps(CHAIN_LENGTH * count);
+	for (int i = 0; i < count; i++) {
+		maps[i] = (uint8_t)mapDist(rng);
+		alignments[i] = (uint8_t)alignmentDist(rng);
+	}
+	for (uint8_t& s : steps) s = (uint8_t)mapDist(rng);
+
+	std::vector<uint8_t> formulaOut(count), scalarOut(count), batchOut(count);
+	std::vector<uint8_t> scalarChains(count), batchChains(count);
+	// Something from every iteration goes in here, so none of the loops can be thrown away:
+	volatile unsigned int sink = 0;
+
+	auto start = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		for (int i = 0; i < count; i++) formulaOut[i] = (uint8_t)d4::mapAlignment(maps[i], alignments[i]);
+		sink += formulaOut[it % count];
+	}
+	auto formulaEnd = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		for (int i = 0; i < count; i++) scalarOut[i] = (uint8_t)map((MapType)maps[i], (LocalAlignment)alignments[i]);
+		sink += scalarOut[it % count];
+	}
+	auto scalarEnd = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		mapBatch(maps.data(), alignments.data(), batchOut.data(), count);
+		sink += batchOut[it % count];
+	}
+	auto batchEnd = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		for (int i = 0; i < count; i++) {
+			MapType m = (MapType)steps[i];
+			for (int k = 1; k < CHAIN_LENGTH; k++) m = combine(m, (MapType)steps[k * count + i]);
+			scalarChains[i] = (uint8_t)m;
+		}
+		sink += scalarChains[it % count];
+	}
+	auto scalarChainsEnd = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		combineChains(steps.data(), CHAIN_LENGTH, count, batchChains.data());
+		sink += batchChains[it % count];
+	}
+	auto batchChainsEnd = clock::now();
+
+	int mismatches = 0;
+	for (int i = 0; i < count; i++) {
+		if (scalarOut[i] != formulaOut[i] || batchOut[i] != formulaOut[i]) mismatches++;
+		if (batchChains[i] != scalarChains[i]) mismatches++;
+	}
+
+	auto nsPer = [&](clock::time_point a, clock::time_point b) {
+		return std::chrono::duration<double, std::nano>(b - a).count() / (double(count) * iterations);
+	};
+	double formulaNs = nsPer(start, formulaEnd);
+	double scalarNs = nsPer(formulaEnd, scalarEnd);
+	double batchNs = nsPer(scalarEnd, batchEnd);
+	double scalarChainsNs = nsPer(batchEnd, scalarChainsEnd);
+	double batchChainsNs = nsPer(scalarChainsEnd, batchChainsEnd);
+	std::cout << "Map benchmark: " << count << " random (map, alignment) pairs and " << CHAIN_LENGTH << " map chains, "
+		<< iterations << " times\n";
+	std::cout << "  d4::mapAlignment: " << formulaNs << " ns/map\n";
+	std::cout << "  tnav::map: " << scalarNs << " ns/map (" << formulaNs / scalarNs << "x)\n";
+#ifdef TNAV_MAP_SSSE3
+	std::cout << "  mapBatch (ssse3): ";
+#else
+	std::cout << "  mapBatch (no ssse3): ";
+#endif
+	std::cout << batchNs << " ns/map (" << formulaNs / batchNs << "x)\n";
+	std::cout << "  tnav::combine chains: " << scalarChainsNs << " ns/chain\n";
+	std::cout << "  combineChains: " << batchChainsNs << " ns/chain (" << scalarChainsNs / batchChainsNs << "x)" << std::endl;
+	if (mismatches > 0) {
+		std::cout << "ERROR::MAP_BENCHMARK:: " << mismatches << " results differ from the scalar versions" << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+#include "tileNavigation.h"
+
+// pshufb is SSSE3.  GCC/Clang say so when it's turned on, MSVC doesn't say but lets us use it on x64 (every x64 cpu
+// from the last 15 years has it).  Otherwise everything here is plain table lookups, one at a time.
+#if defined(__SSSE3__) || (defined(_MSC_VER) && defined(_M_X64))
+#define TNAV_MAP_SSSE3
+#endif
+
+// tnav::map() and tnav::combine() over whole arrays at once, for when something walks every entity (moveEntities()).
+// Maps and alignments are bytes here (same numbers as the enums) so 16 of them fit in an sse register: each map's
+// row of MAP_ALIGNMENT is 16 bytes, so looking up 16 alignments in it is one shuffle, and the 8 rows are picked
+// between with compares.  Maps have to be real maps (0-7), alignments anything up to LOCAL_ALIGNMENT_ERROR.
+namespace tnav {
+	// out[i] = map(maps[i], alignments[i]).  out can be either of them.
+	void mapBatch(const uint8_t* maps, const uint8_t* alignments, uint8_t* out, int count);
+
+	// out[i] = combine(first[i], second[i]).  out can be either of them.
+	void combineBatch(const uint8_t* first, const uint8_t* second, uint8_t* out, int count);
+
+	// count chains of chainLength maps each, step k of chain i at steps[k * count + i].  out[i] is the whole of
+	// chain i combined in order (identity for chainLength 0), so mapping with it is mapping with each step in turn.
+	void combineChains(const uint8_t* steps, int chainLength, int count, uint8_t* out);
+
+	// Times the batches against the scalar versions (d4's branchy formula and the inline table lookups) on random maps
+	// and checks they all agree.  Prints the results, returns false if they didn't agree.
+	bool runMapBenchmark(int count, int iterations);
+}
@@ -0,0 +1,3 @@
+#include "memoryAccounting.h"
+
+GlBufferMemory GlobalGlBufferMemory;
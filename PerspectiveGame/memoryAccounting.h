@@ -0,0 +1,99 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+// Where the world's memory goes.  Add new ones above NUM_MEMORY_CATEGORIES and give them a name in MEMORY_CATEGORY_NAMES.
+enum MemoryCategory : uint8_t {
+	MEMORY_NODES,             // the TileNodes themselves (one heap allocation each) and the node list.
+	MEMORY_DEGENERATE_PAIRS,  // every DegenerateCornerNode's componentPairIndices.
+	MEMORY_TILES,
+	MEMORY_GPU_TILE_MIRRORS,  // gpuTiles and gpuTileLods, cpu side.
+	MEMORY_GPU_NODE_INFOS,    // gpuPositionNodeInfos, cpu side.
+	MEMORY_TILE_BVH,
+	MEMORY_FORCES,            // ForceManager's bitset, nodes' and entities' forces both.
+	MEMORY_ENTITIES,
+	MEMORY_ENTITY_GPU_LISTS,  // per tile entity lists and quads, and their scratch.
+	MEMORY_COLLISION_SOLVERS,
+	MEMORY_SNAPSHOTS,         // the simulation's latest tile and entity snapshots.
+	NUM_MEMORY_CATEGORIES,
+};
+
+const char* const MEMORY_CATEGORY_NAMES[NUM_MEMORY_CATEGORIES] = {
+	"nodes",
+	"degenerate corner pairs",
+	"tiles",
+	"gpu tile mirrors",
+	"gpu node info mirror",
+	"tile bvh",
+	"forces",
+	"entities",
+	"entity gpu lists",
+	"collision solvers",
+	"snapshots",
+};
+
+// Bytes a vector is holding on to, used or not:
+template<typename T>
+size_t vectorBytes(const std::vector<T>& v) { return v.capacity() * sizeof(T); }
+inline size_t vectorBytes(const std::vector<bool>& v) { return (v.capacity() + 7) / 8; }
+
+// One count of everything, filled in by each subsystem's accountMemory().  Counted from object sizes and container
+// capacities, so it's what was asked for, not what the allocator used (allocationCounter.h has the whole heap).
+struct MemoryReport {
+	size_t bytes[NUM_MEMORY_CATEGORIES] = {};
+	int numTilePairs = 0;
+
+	size_t total() const
+	{
+		size_t sum = 0;
+		for (size_t b : bytes) sum += b;
+		return sum;
+	}
+
+	double bytesPerTilePair() const { return numTilePairs > 0 ? double(total()) / numTilePairs : 0.0; }
+};
+
+// The latest report and the most each category (and the total) has been since the last reset().
+struct MemoryTracker {
+	MemoryReport current;
+	size_t peakBytes[NUM_MEMORY_CATEGORIES] = {};
+	size_t peakTotal = 0;
+
+	void record(const MemoryReport& report)
+	{
+		current = report;
+		for (int c = 0; c < NUM_MEMORY_CATEGORIES; c++) peakBytes[c] = std::max(peakBytes[c], report.bytes[c]);
+		peakTotal = std::max(peakTotal, report.total());
+	}
+
+	void reset() { *this = MemoryTracker(); }
+};
+
+// Sizes of the gl buffers the renderer made, by id.  Only touched from the thread with the gl context, like the
+// buffers themselves.  Call set() after every glBufferData/glBufferStorage and remove() before glDeleteBuffers.
+struct GlBufferMemory {
+	std::unordered_map<unsigned int, size_t> sizes;
+	size_t total = 0;
+	size_t peak = 0;
+
+	void set(unsigned int id, size_t size)
+	{
+		size_t& s = sizes[id];
+		total = total - s + size;
+		s = size;
+		peak = std::max(peak, total);
+	}
+
+	void remove(unsigned int id)
+	{
+		auto found = sizes.find(id);
+		if (found == sizes.end()) return;
+		total -= found->second;
+		sizes.erase(found);
+	}
+};
+
+extern GlBufferMemory GlobalGlBufferMemory;
@@ -0,0 +1,352 @@
+#include "microBenchmark.h"
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "allocationCounter.h"
+#include "worldEdit.h"
+#include "forceManager.h"
+#include "tileNodeNetwork.h"
+#include "entityManager.h"
+#include "pov.h"
+#include "mapBatch.h"
+
+namespace {
+	struct MicroBenchmarkResult {
+		std::string name;
+		int size; // tiles, entities, ... whatever the benchmark scales with.
+		int64_t ops;
+		double nsPerOp;    // the median run's.
+		double minNsPerOp; // fastest and slowest timed runs, for how much to trust the median.
+		double maxNsPerOp;
+		double allocationsPerOp; // the median run's too.
+		double bytesPerOp;
+	};
+
+	// Every benchmark runs this many times untimed first (caches, the allocator, the first gl buffers) then this
+	// many times timed:
+	const int WARMUP_RUNS = 1;
+	const int TIMED_RUNS = 5;
+
+	// Runs setup() then f() for every run, only timing f(), which should do 'ops' of whatever's being timed:
+	template<typename Setup, typename F>
+	MicroBenchmarkResult measure(const std::string& name, int size, int64_t ops, Setup&& setup, F&& f)
+	{
+		using clock = std::chrono::steady_clock;
+		struct Run {
+			double ns;
+			AllocationCounts allocated;
+		};
+		std::vector<Run> runs;
+		for (int r = 0; r < WARMUP_RUNS + TIMED_RUNS; r++) {
+			setup();
+			AllocationCounts before = currentAllocationCounts();
+			auto start = clock::now();
+			f();
+			auto end = clock::now();
+			if (r < WARMUP_RUNS) continue;
+			runs.push_back({ std::chrono::duration<double, std::nano>(end - start).count(), currentAllocationCounts() - before });
+		}
+		std::sort(runs.begin(), runs.end(), [](const Run& a, const Run& b) { return a.ns < b.ns; });
+		const Run& median = runs[runs.size() / 2];
+
+		MicroBenchmarkResult r;
+		r.name = name;
+		r.size = size;
+		r.ops = std::max<int64_t>(ops, 1);
+		r.nsPerOp = median.ns / r.ops;
+		r.minNsPerOp = runs.front().ns / r.ops;
+		r.maxNsPerOp = runs.back().ns / r.ops;
+		r.allocationsPerOp = double(median.allocated.allocations) / r.ops;
+		r.bytesPerOp = double(median.allocated.bytes) / r.ops;
+		return r;
+	}
+
+	// For the ones that can just run again on what the last run left behind:
+	template<typename F>
+	MicroBenchmarkResult measure(const std::string& name, int size, int64_t ops, F&& f)
+	{
+		return measure(name, size, ops, [] {}, std::forward<F>(f));
+	}
+
+	// Everything the node network needs to run, without the app around it.  Starts with the one tile at the origin.
+	struct BenchmarkWorld {
+		Camera camera;
+		ForceManager forceManager;
+		TileNodeNetwork nodeNetwork;
+		EntityManager entityManager;
+		POV pov;
+
+		BenchmarkWorld()
+			: nodeNetwork(&camera, &forceManager)
+			, entityManager(&nodeNetwork, &forceManager)
+			, pov(&nodeNetwork, &camera, nullptr)
+		{}
+
+		// Front tile index of every pair that actually got made:
+		std::vector<int> create(const std::vector<WorldEdit>& tiles)
+		{
+			std::vector<int> created;
+			for (const WorldEdit& e : tiles) {
+				Tile* t = nodeNetwork.createTilePair(e.pos, e.superTileType);
+				if (t != nullptr) created.push_back(t->index);
+			}
+			return created;
+		}
+
+		std::vector<CenterNode*> centerNodes()
+		{
+			std::vector<CenterNode*> out;
+			for (int t = 0; t < nodeNetwork.numTiles(); t++) {
+				Tile* tile = nodeNetwork.getTile(t);
+				if (tile->index != -1) out.push_back(static_cast<CenterNode*>(nodeNetwork.getNode(tile->centerNodeIndex)));
+			}
+			return out;
+		}
+	};
+
+	WorldEdit xyTile(int i, int j, int k) { return WorldEdit::createTilePair(latticeTilePos(TILE_TYPE_XY, i, j, k), TILE_TYPE_XY); }
+	WorldEdit xzTile(int i, int j, int k) { return WorldEdit::createTilePair(latticeTilePos(TILE_TYPE_XZ, i, j, k), TILE_TYPE_XZ); }
+	WorldEdit yzTile(int i, int j, int k) { return WorldEdit::createTilePair(latticeTilePos(TILE_TYPE_YZ, i, j, k), TILE_TYPE_YZ); }
+
+	std::vector<WorldEdit> planeTiles(int n)
+	{
+		std::vector<WorldEdit> tiles;
+		for (int x = 0; x < n; x++)
+			for (int y = 0; y < n; y++) tiles.push_back(xyTile(x, y, 0));
+		return tiles;
+	}
+
+	// The outside of an n x n x n cube:
+	std::vector<WorldEdit> cubeTiles(int n)
+	{
+		std::vector<WorldEdit> tiles;
+		for (int a = 0; a < n; a++) {
+			for (int b = 0; b < n; b++) {
+				tiles.push_back(xyTile(a, b, 0));
+				tiles.push_back(xyTile(a, b, n));
+				tiles.push_back(xzTile(a, 0, b));
+				tiles.push_back(xzTile(a, n, b));
+				tiles.push_back(yzTile(0, a, b));
+				tiles.push_back(yzTile(n, a, b));
+			}
+		}
+		return tiles;
+	}
+
+	// Anywhere in a side^3 box, any way round.  Mostly floating tiles with the odd edge or corner shared:
+	std::vector<WorldEdit> scatterTiles(int count, int side, std::mt19937& rng)
+	{
+		std::uniform_int_distribution<int> cell(0, side - 1), type(0, 2);
+		std::vector<WorldEdit> tiles;
+		for (int t = 0; t < count; t++) {
+			int i = cell(rng), j = cell(rng), k = cell(rng);
+			switch (type(rng)) {
+			case TILE_TYPE_XY: tiles.push_back(xyTile(i, j, k)); break;
+			case TILE_TYPE_XZ: tiles.push_back(xzTile(i, j, k)); break;
+			default: tiles.push_back(yzTile(i, j, k)); break;
+			}
+		}
+		return tiles;
+	}
+
+	// A plane with a wall standing on every other row, so three tiles meet on every one of those edges and every
+	// wall end makes degenerate corners:
+	std::vector<WorldEdit> finTiles(int n)
+	{
+		std::vector<WorldEdit> tiles = planeTiles(n);
+		for (int y = 1; y < n; y += 2)
+			for (int x = 0; x < n; x++) tiles.push_back(xzTile(x, y, 0));
+		return tiles;
+	}
+
+	// Creating all of 'tiles' from just the origin tile, then removing them again in a random order:
+	void benchmarkCreateRemove(std::vector<MicroBenchmarkResult>& results, const std::string& shape,
+							   const std::vector<WorldEdit>& tiles, std::mt19937& rng)
+	{
+		// Each run starts from a fresh world, and removing needs one with all the pairs made first:
+		std::unique_ptr<BenchmarkWorld> world;
+		std::vector<int> created;
+		results.push_back(measure("create_tile_pair/" + shape, (int)tiles.size(), (int64_t)tiles.size(),
+								  [&] { world = std::make_unique<BenchmarkWorld>(); },
+								  [&] { created = world->create(tiles); }));
+
+		// Every run makes the same pairs, so the last one's count is everyone's:
+		int64_t numCreated = (int64_t)created.size();
+		results.push_back(measure("remove_tile_pair/" + shape, (int)tiles.size(), numCreated, [&] {
+			world = std::make_unique<BenchmarkWorld>();
+			created = world->create(tiles);
+			std::shuffle(created.begin(), created.end(), rng);
+		}, [&] {
+			for (int t : created) world->nodeNetwork.removeTilePair(t);
+		}));
+	}
+
+	std::vector<LocalDirection> randomDirections(int count, std::mt19937& rng)
+	{
+		std::uniform_int_distribution<int> dir(0, 3);
+		std::vector<LocalDirection> dirs(count);
+		for (LocalDirection& d : dirs) d = (LocalDirection)dir(rng);
+		return dirs;
+	}
+
+	void benchmarkWalks(std::vector<MicroBenchmarkResult>& results, std::mt19937& rng)
+	{
+		const int CUBE_SIZE = 8;
+		const int WALK_STEPS = 1000000, POV_STEPS = 100000;
+		auto world = std::make_unique<BenchmarkWorld>();
+		world->create(cubeTiles(CUBE_SIZE));
+		int numTiles = world->nodeNetwork.numTiles();
+		std::vector<LocalDirection> dirs = randomDirections(4096, rng);
+
+		CenterNode* node = world->centerNodes().front();
+		results.push_back(measure("get_second_neighbor_walk/cube", numTiles, WALK_STEPS, [&] {
+			if (node == nullptr) return;
+			for (int s = 0; s < WALK_STEPS; s++) node = world->nodeNetwork.getSecondNeighbor(*node, dirs[s & 4095]);
+		}));
+		if (node == nullptr) std::cout << "ERROR::MICRO_BENCHMARK:: the walk fell off the cube" << std::endl;
+
+		POV& pov = world->pov;
+		results.push_back(measure("pov_shift_tile/cube", numTiles, POV_STEPS, [&] {
+			for (int s = 0; s < POV_STEPS; s++) {
+				switch (dirs[s & 4095]) {
+				case LOCAL_DIRECTION_0: pov.shiftPovEast(); break;
+				case LOCAL_DIRECTION_1: pov.shiftPovSouth(); break;
+				case LOCAL_DIRECTION_2: pov.shiftPovWest(); break;
+				default: pov.shiftPovNorth(); break;
+				}
+			}
+		}));
+	}
+
+	void benchmarkMaps(std::vector<MicroBenchmarkResult>& results, std::mt19937& rng)
+	{
+		const int COUNT = 100000, PASSES = 20;
+		std::uniform_int_distribution<int> mapDist(0, tnav::d4::NUM_MAPS - 1), alignmentDist(0, tnav::d4::NUM_ALIGNMENTS - 1);
+		std::vector<uint8_t> maps(COUNT), alignments(COUNT), maps2(COUNT), out(COUNT);
+		for (int i = 0; i < COUNT; i++) {
+			maps[i] = (uint8_t)mapDist(rng);
+			maps2[i] = (uint8_t)mapDist(rng);
+			alignments[i] = (uint8_t)alignmentDist(rng);
+		}
+
+		results.push_back(measure("tnav_map", COUNT, (int64_t)COUNT * PASSES, [&] {
+			for (int p = 0; p < PASSES; p++)
+				for (int i = 0; i < COUNT; i++) out[i] = (uint8_t)tnav::map((MapType)maps[i], (LocalAlignment)alignments[i]);
+		}));
+		results.push_back(measure("tnav_map_batch", COUNT, (int64_t)COUNT * PASSES, [&] {
+			for (int p = 0; p < PASSES; p++) tnav::mapBatch(maps.data(), alignments.data(), out.data(), COUNT);
+		}));
+		results.push_back(measure("tnav_combine", COUNT, (int64_t)COUNT * PASSES, [&] {
+			for (int p = 0; p < PASSES; p++)
+				for (int i = 0; i < COUNT; i++) out[i] = (uint8_t)tnav::combine((MapType)maps[i], (MapType)maps2[i]);
+		}));
+		results.push_back(measure("tnav_combine_batch", COUNT, (int64_t)COUNT * PASSES, [&] {
+			for (int p = 0; p < PASSES; p++) tnav::combineBatch(maps.data(), maps2.data(), out.data(), COUNT);
+		}));
+	}
+
+	void benchmarkForces(std::vector<MicroBenchmarkResult>& results, std::mt19937& rng)
+	{
+		const int COUNT = 100000, PASSES = 20;
+		ForceManager forces;
+		std::vector<int> indices;
+		std::vector<LocalDirection> dirs = randomDirections(COUNT, rng);
+		for (int i = 0; i < COUNT; i++) indices.push_back(forces.addForce(dirs[i], i));
+
+		volatile int64_t sink = 0; // so the gets can't be thrown away.
+		results.push_back(measure("force_manager_get", COUNT, (int64_t)COUNT * PASSES, [&] {
+			int64_t sum = 0;
+			for (int p = 0; p < PASSES; p++)
+				for (int i : indices) sum += forces.getForce(i);
+			sink = sum;
+		}));
+		results.push_back(measure("force_manager_set", COUNT, (int64_t)COUNT * PASSES, [&] {
+			for (int p = 0; p < PASSES; p++)
+				for (int i = 0; i < COUNT; i++) forces.setForce(indices[i], dirs[(i + p) % COUNT]);
+		}));
+	}
+
+	void benchmarkMoveEntities(std::vector<MicroBenchmarkResult>& results, int numEntities, std::mt19937& rng)
+	{
+		const int PLANE_SIZE = 32;
+		const int64_t MOVES = 1000000;
+		auto world = std::make_unique<BenchmarkWorld>();
+		world->create(planeTiles(PLANE_SIZE));
+		std::vector<CenterNode*> nodes = world->centerNodes();
+
+		// Only orthogonal, so nobody heads into a corner:
+		std::uniform_int_distribution<int> nodeDist(0, (int)nodes.size() - 1);
+		std::vector<LocalDirection> dirs = randomDirections(numEntities, rng);
+		for (int e = 0; e < numEntities; e++) world->entityManager.createEntity(nodes[nodeDist(rng)], dirs[e]);
+
+		int ticks = (int)std::max<int64_t>(MOVES / numEntities, 1);
+		results.push_back(measure("move_entities", numEntities, (int64_t)ticks * numEntities, [&] {
+			for (int t = 0; t < ticks; t++) world->entityManager.moveEntities();
+		}));
+	}
+
+	std::string spread(const MicroBenchmarkResult& r)
+	{
+		std::stringstream s;
+		s << "(" << r.minNsPerOp << " - " << r.maxNsPerOp << ")";
+		return s.str();
+	}
+
+	void printResults(const std::vector<MicroBenchmarkResult>& results)
+	{
+		std::cout << std::left << std::setw(36) << "benchmark" << std::right << std::setw(8) << "size"
+			<< std::setw(14) << "ns/op" << std::setw(24) << "(min - max)" << std::setw(14) << "allocs/op" << std::setw(14) << "bytes/op" << "\n";
+		for (const MicroBenchmarkResult& r : results) {
+			std::cout << std::left << std::setw(36) << r.name << std::right << std::setw(8) << r.size
+				<< std::setw(14) << r.nsPerOp << std::setw(24) << spread(r) << std::setw(14) << r.allocationsPerOp << std::setw(14) << r.bytesPerOp << "\n";
+		}
+		std::cout << std::flush;
+	}
+
+	bool writeResults(const std::string& path, const std::vector<MicroBenchmarkResult>& results)
+	{
+		std::ofstream file(path);
+		if (!file.is_open()) {
+			std::cout << "ERROR::MICRO_BENCHMARK:: could not open " << path << std::endl;
+			return false;
+		}
+		file << "{\n  \"warmup_runs\": " << WARMUP_RUNS << ",\n  \"timed_runs\": " << TIMED_RUNS << ",\n  \"benchmarks\": [\n";
+		for (int i = 0; i < (int)results.size(); i++) {
+			const MicroBenchmarkResult& r = results[i];
+			file << "    { \"name\": \"" << r.name << "\", \"size\": " << r.size << ", \"ops\": " << r.ops
+				<< ", \"ns_per_op\": " << r.nsPerOp << ", \"min_ns_per_op\": " << r.minNsPerOp
+				<< ", \"max_ns_per_op\": " << r.maxNsPerOp << ", \"allocations_per_op\": " << r.allocationsPerOp
+				<< ", \"bytes_per_op\": " << r.bytesPerOp << " }" << (i + 1 < (int)results.size() ? "," : "") << "\n";
+		}
+		file << "  ]\n}\n";
+		return true;
+	}
+}
+
+bool runMicroBenchmarks(const MicroBenchmarkSettings& settings)
+{
+	std::mt19937 rng(1234);
+	std::vector<MicroBenchmarkResult> results;
+
+	benchmarkCreateRemove(results, "plane", planeTiles(32), rng);
+	benchmarkCreateRemove(results, "cube", cubeTiles(8), rng);
+	benchmarkCreateRemove(results, "scatter", scatterTiles(512, 12, rng), rng);
+	benchmarkCreateRemove(results, "fins", finTiles(24), rng);
+	benchmarkWalks(results, rng);
+	benchmarkMaps(results, rng);
+	benchmarkForces(results, rng);
+	for (int numEntities : { 1000, 10000, 100000 }) benchmarkMoveEntities(results, numEntities, rng);
+
+	printResults(results);
+	bool written = writeResults(settings.outputFile, results);
+	if (written) std::cout << "Micro benchmark results written to " << settings.outputFile << std::endl;
+	return written;
+}
@@ -0,0 +1,15 @@
+#pragma once
+#include <string>
+
+// Times the node network's building blocks on their own, no rendering: tile pair creation and removal on a few
+// kinds of world (plane, cube, random scatter, and a plane full of fins for lots of degenerate corners), neighbor
+// walks, pov tile shifts, tnav maps, force gets/sets and moveEntities() at 1k, 10k and 100k entities.
+// Each one runs once to warm up and then a few times timed.  Every result gets the median run's ns and heap
+// allocations per op (see allocationCounter.h) plus the fastest and slowest run's ns, written out as json so runs
+// can be diffed commit to commit.  Needs no gl context, so it runs anywhere, display or not.
+struct MicroBenchmarkSettings {
+	std::string outputFile = "micro_benchmark.json";
+};
+
+// Returns false if it couldn't write the results.
+bool runMicroBenchmarks(const MicroBenchmarkSettings& settings);
@@ -0,0 +1,288 @@
+#include"polygonClip.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+
+#ifdef VECHELP_CLIP_SSE
+#include <emmintrin.h>
+#endif
+
+void vechelp::PolyBatch::load(const InlinePoly* polys, int count)
+{
+	int maxSize = 0;
+	for (int l = 0; l < LANES; l++) {
+		size[l] = (l < count) ? polys[l].size : 0;
+		maxSize = std::max(maxSize, size[l]);
+	}
+	for (int i = 0; i <= maxSize && i <= InlinePoly::MAX_POINTS; i++) {
+		for (int l = 0; l < LANES; l++) {
+			bool has = i < size[l];
+			x[i][l] = has ? polys[l].points[i].x : 0.0f;
+			y[i][l] = has ? polys[l].points[i].y : 0.0f;
+		}
+	}
+}
+
+void vechelp::PolyBatch::store(InlinePoly* polys, int count) const
+{
+	for (int l = 0; l < count; l++) {
+		polys[l].size = size[l];
+		for (int i = 0; i < size[l]; i++) {
+			polys[l].points[i] = glm::vec2(x[i][l], y[i][l]);
+		}
+	}
+}
+
+void vechelp::clipPoly(InlinePoly& subject, const InlinePoly& clipTo)
+{
+	if (clipTo.size < 2) {
+		subject.clear();
+		return;
+	}
+
+	InlinePoly cropped;
+	InlinePoly* inputPoly = &subject, * outputPoly = &cropped;
+	for (int c = 0; c < clipTo.size; c++) {
+		glm::vec2 cropToP1 = clipTo[c];
+		glm::vec2 cropToP2 = clipTo[(c + 1) % clipTo.size];
+
+		outputPoly->clear();
+		for (int i = 0; i < inputPoly->size; i++) {
+			glm::vec2 inputP1 = (*inputPoly)[i];
+			glm::vec2 inputP2 = (*inputPoly)[(i + 1) % inputPoly->size];
+			SideOfLine inputP1Side = isLeftSpecific(inputP1, cropToP1, cropToP2);
+			SideOfLine inputP2Side = isLeftSpecific(inputP2, cropToP1, cropToP2);
+
+			if (inputP1Side != OUTSIDE) {
+				outputPoly->push(inputP1);
+			}
+			if (inputP1Side != inputP2Side && inputP2Side != ON_LINE_SEG) {
+				outputPoly->push(intersection(cropToP1, cropToP2, inputP1, inputP2));
+			}
+		}
+		std::swap(inputPoly, outputPoly);
+	}
+	if (inputPoly != &subject) {
+		subject = *inputPoly;
+	}
+}
+
+// One clip edge for every lane at once.  The side tests and intersections are done for point i of all the lanes
+// together, then each lane appends what it kept to its own end of out (they all grow at different rates).
+// Most stencils are well inside most of their parent's edges, so first it just checks whether anything is even
+// touching this one, and returns false (without filling out) if not.
+static bool clipBatchToEdge(const vechelp::PolyBatch& in, vechelp::PolyBatch& out, glm::vec2 c1, glm::vec2 c2)
+{
+	using namespace vechelp;
+	const int LANES = PolyBatch::LANES;
+
+	int maxSize = 0;
+	for (int l = 0; l < LANES; l++) maxSize = std::max(maxSize, in.size[l]);
+
+#ifdef VECHELP_CLIP_SSE
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 c1x = _mm_set1_ps(c1.x), c1y = _mm_set1_ps(c1.y);
+	// Same sums as isLeftSpecific() and intersection(), so the results match clipPoly() exactly:
+	const __m128 ex = _mm_set1_ps(c1.x - c2.x), ey = _mm_set1_ps(c1.y - c2.y);
+	const __m128 bx = _mm_set1_ps(c2.x - c1.x), by = _mm_set1_ps(c2.y - c1.y);
+	const __m128 sizes = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)in.size));
+	const __m128 firstX = _mm_load_ps(in.x[0]), firstY = _mm_load_ps(in.y[0]);
+
+	int notInside = 0;
+	for (int i = 0; i < maxSize; i++) {
+		__m128 v = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(in.x[i]), c1x), ey), _mm_mul_ps(_mm_sub_ps(_mm_load_ps(in.y[i]), c1y), ex));
+		__m128 active = _mm_cmplt_ps(_mm_set1_ps((float)i), sizes);
+		notInside |= _mm_movemask_ps(_mm_and_ps(active, _mm_cmple_ps(v, zero)));
+	}
+	if (notInside == 0) return false;
+#else
+	bool allInside = true;
+	for (int l = 0; l < LANES; l++) {
+		for (int i = 0; i < in.size[l]; i++) {
+			allInside = allInside && isLeftSpecific(glm::vec2(in.x[i][l], in.y[i][l]), c1, c2) == INSIDE;
+		}
+	}
+	if (allInside) return false;
+#endif
+
+	for (int l = 0; l < LANES; l++) out.size[l] = 0;
+	for (int i = 0; i < maxSize; i++) {
+		int keepMask = 0, crossMask = 0;
+		alignas(16) float interX[LANES] = {}, interY[LANES] = {};
+
+#ifdef VECHELP_CLIP_SSE
+		__m128 p1x = _mm_load_ps(in.x[i]), p1y = _mm_load_ps(in.y[i]);
+		// The last point of each lane pairs up with its first:
+		__m128 wrap = _mm_cmpeq_ps(sizes, _mm_set1_ps((float)(i + 1)));
+		__m128 p2x = _mm_or_ps(_mm_and_ps(wrap, firstX), _mm_andnot_ps(wrap, _mm_load_ps(in.x[i + 1])));
+		__m128 p2y = _mm_or_ps(_mm_and_ps(wrap, firstY), _mm_andnot_ps(wrap, _mm_load_ps(in.y[i + 1])));
+
+		__m128 v1 = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(p1x, c1x), ey), _mm_mul_ps(_mm_sub_ps(p1y, c1y), ex));
+		__m128 v2 = _mm_sub_ps(_mm_mul_ps(_mm_sub_ps(p2x, c1x), ey), _mm_mul_ps(_mm_sub_ps(p2y, c1y), ex));
+
+		// Keep p1 unless it's outside, add the intersection if p2 is strictly on the other side from p1:
+		__m128 active = _mm_cmplt_ps(_mm_set1_ps((float)i), sizes);
+		__m128 keep = _mm_and_ps(active, _mm_cmpge_ps(v1, zero));
+		__m128 cross = _mm_and_ps(active, _mm_or_ps(
+			_mm_and_ps(_mm_cmpgt_ps(v2, zero), _mm_cmple_ps(v1, zero)),
+			_mm_and_ps(_mm_cmplt_ps(v2, zero), _mm_cmpge_ps(v1, zero))));
+		keepMask = _mm_movemask_ps(keep);
+		crossMask = _mm_movemask_ps(cross);
+
+		// Lanes that don't cross may divide by zero here, but they never get used:
+		__m128 dx = _mm_sub_ps(p2x, p1x), dy = _mm_sub_ps(p2y, p1y);
+		__m128 d = _mm_sub_ps(_mm_mul_ps(dx, by), _mm_mul_ps(dy, bx));
+		__m128 alpha = _mm_div_ps(_mm_sub_ps(_mm_mul_ps(dx, _mm_sub_ps(p1y, c1y)), _mm_mul_ps(dy, _mm_sub_ps(p1x, c1x))), d);
+		_mm_store_ps(interX, _mm_add_ps(c1x, _mm_mul_ps(alpha, bx)));
+		_mm_store_ps(interY, _mm_add_ps(c1y, _mm_mul_ps(alpha, by)));
+#else
+		for (int l = 0; l < LANES; l++) {
+			if (i >= in.size[l]) continue;
+			int next = (i + 1 == in.size[l]) ? 0 : i + 1;
+			glm::vec2 p1(in.x[i][l], in.y[i][l]), p2(in.x[next][l], in.y[next][l]);
+			SideOfLine p1Side = isLeftSpecific(p1, c1, c2);
+			SideOfLine p2Side = isLeftSpecific(p2, c1, c2);
+			if (p1Side != OUTSIDE) keepMask |= 1 << l;
+			if (p1Side != p2Side && p2Side != ON_LINE_SEG) {
+				crossMask |= 1 << l;
+				glm::vec2 inter = intersection(c1, c2, p1, p2);
+				interX[l] = inter.x;
+				interY[l] = inter.y;
+			}
+		}
+#endif
+
+		if ((keepMask | crossMask) == 0) continue;
+		// Both get written every time and the count only moves past the ones that are wanted, so there are no
+		// branches for the lanes to mispredict.  The spare rows at the end take the writes when a lane is full.
+		for (int l = 0; l < LANES; l++) {
+			int& n = out.size[l];
+			int keep = (keepMask >> l) & 1, cross = (crossMask >> l) & 1;
+			out.x[n][l] = in.x[i][l];
+			out.y[n][l] = in.y[i][l];
+			n = std::min(n + keep, (int)InlinePoly::MAX_POINTS);
+			out.x[n][l] = interX[l];
+			out.y[n][l] = interY[l];
+			n = std::min(n + cross, (int)InlinePoly::MAX_POINTS);
+		}
+	}
+	return true;
+}
+
+void vechelp::clipPolys(InlinePoly* polys, int count, const InlinePoly& clipTo)
+{
+	if (clipTo.size < 2) {
+		for (int i = 0; i < count; i++) polys[i].clear();
+		return;
+	}
+
+	// Too big for the stack of a deep call, and zeroed the first time so no lane ever reads garbage:
+	static thread_local PolyBatch batchA, batchB;
+	for (int first = 0; first < count; first += PolyBatch::LANES) {
+		int n = std::min(PolyBatch::LANES, count - first);
+		PolyBatch* in = &batchA, * out = &batchB;
+		in->load(polys + first, n);
+		for (int c = 0; c < clipTo.size; c++) {
+			if (clipBatchToEdge(*in, *out, clipTo[c], clipTo[(c + 1) % clipTo.size])) {
+				std::swap(in, out);
+			}
+		}
+		in->store(polys + first, n);
+	}
+}
+
+void vechelp::removeDuplicatePoints(InlinePoly& poly)
+{
+	for (int i = 0; i < poly.size; i++) {
+		for (int j = i + 1; j < poly.size; j++) {
+			if (glm::distance(poly[i], poly[j]) < 0.001f) {
+				std::copy(poly.points + i + 1, poly.points + poly.size, poly.points + i);
+				poly.size--;
+				i--;
+				break;
+			}
+		}
+	}
+}
+
+// Convex, wound the same way as Scene::WINDOW_STENCIL:
+static std::vector<glm::vec2> randomConvexPoly(std::mt19937& rng, int numPoints, glm::vec2 center, float radius)
+{
+	std::uniform_real_distribution<float> angleDist(0.0f, 2.0f * (float)M_PI);
+	std::vector<float> angles(numPoints);
+	for (float& a : angles) a = angleDist(rng);
+	std::sort(angles.begin(), angles.end());
+
+	std::vector<glm::vec2> poly;
+	for (float a : angles) poly.push_back(center + radius * glm::vec2(cos(a), sin(a)));
+	return poly;
+}
+
+bool vechelp::runClipBenchmark(int numPolys, int iterations)
+{
+	using clock = std::chrono::steady_clock;
+	std::mt19937 rng(1234);
+	std::uniform_real_distribution<float> posDist(-1.0f, 1.0f), radiusDist(0.2f, 1.0f);
+
+	// Like a portal stencil being cropped to its parent's:
+	std::vector<glm::vec2> clipToVec = randomConvexPoly(rng, 8, glm::vec2(0), 1.2f);
+	InlinePoly clipTo(clipToVec);
+	std::vector<std::vector<glm::vec2>> subjects(numPolys);
+	for (auto& s : subjects) s = randomConvexPoly(rng, 6, glm::vec2(posDist(rng), posDist(rng)), radiusDist(rng));
+
+	std::vector<std::vector<glm::vec2>> vecResults(numPolys);
+	std::vector<InlinePoly> scalarResults(numPolys), batchResults(numPolys);
+
+	auto start = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		for (int i = 0; i < numPolys; i++) {
+			vecResults[i] = subjects[i];
+			sutherlandHodgemanPolyCrop(vecResults[i], clipToVec, false);
+		}
+	}
+	auto vecEnd = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		for (int i = 0; i < numPolys; i++) {
+			scalarResults[i].assign(subjects[i]);
+			clipPoly(scalarResults[i], clipTo);
+		}
+	}
+	auto scalarEnd = clock::now();
+	for (int it = 0; it < iterations; it++) {
+		for (int i = 0; i < numPolys; i++) batchResults[i].assign(subjects[i]);
+		clipPolys(batchResults.data(), numPolys, clipTo);
+	}
+	auto batchEnd = clock::now();
+
+	int mismatches = 0;
+	for (int i = 0; i < numPolys; i++) {
+		const std::vector<glm::vec2>& expected = vecResults[i];
+		for (const InlinePoly* p : { &scalarResults[i], &batchResults[i] }) {
+			bool same = p->size == (int)expected.size();
+			for (int j = 0; same && j < p->size; j++) same = glm::distance((*p)[j], expected[j]) < 0.0001f;
+			if (!same) mismatches++;
+		}
+	}
+
+	auto nsPerPoly = [&](clock::time_point a, clock::time_point b) {
+		return std::chrono::duration<double, std::nano>(b - a).count() / (double(numPolys) * iterations);
+	};
+	double vecNs = nsPerPoly(start, vecEnd);
+	double scalarNs = nsPerPoly(vecEnd, scalarEnd);
+	double batchNs = nsPerPoly(scalarEnd, batchEnd);
+	std::cout << "Clip benchmark: " << numPolys << " 6 point polygons cropped to an 8 point one, " << iterations << " times\n";
+	std::cout << "  sutherlandHodgemanPolyCrop: " << vecNs << " ns/poly\n";
+	std::cout << "  clipPoly: " << scalarNs << " ns/poly (" << vecNs / scalarNs << "x)\n";
+#ifdef VECHELP_CLIP_SSE
+	std::cout << "  clipPolys (sse, " << PolyBatch::LANES << " lanes): ";
+#else
+	std::cout << "  clipPolys (no sse, " << PolyBatch::LANES << " lanes): ";
+#endif
+	std::cout << batchNs << " ns/poly (" << vecNs / batchNs << "x)" << std::endl;
+	if (mismatches > 0) {
+		std::cout << "ERROR::CLIP_BENCHMARK:: " << mismatches << " results differ from sutherlandHodgemanPolyCrop" << std::endl;
+		return false;
+	}
+	return true;
+}
@@ -0,0 +1,66 @@
+#pragma once
+#include <vector>
+
+#include"dependancyHeaders.h"
+
+#include"vectorHelperFunctions.h"
+
+// SSE2 is always there on x64 (and MSVC says so with _M_X64), otherwise the batch kernel falls back to plain loops:
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VECHELP_CLIP_SSE
+#endif
+
+namespace vechelp {
+
+	// A polygon that lives on the stack (or inline in whatever holds it), so clipping never touches the heap.
+	// Clipping a convex n-gon to a convex m-gon gives at most n + m points, so this is plenty for portal stencils
+	// (6 points each, nested MAX_SEEN_PORTALS deep inside the 4 point window).  Points past MAX_POINTS are dropped.
+	struct InlinePoly {
+		static const int MAX_POINTS = 48;
+		glm::vec2 points[MAX_POINTS];
+		int size = 0;
+
+		InlinePoly() {}
+		InlinePoly(const std::vector<glm::vec2>& v) { assign(v); }
+
+		void clear() { size = 0; }
+		void push(glm::vec2 p) { if (size < MAX_POINTS) points[size++] = p; }
+		glm::vec2& operator[](int i) { return points[i]; }
+		const glm::vec2& operator[](int i) const { return points[i]; }
+
+		void assign(const std::vector<glm::vec2>& v)
+		{
+			size = 0;
+			for (const glm::vec2& p : v) push(p);
+		}
+		// Reuses out's capacity, so this only allocates the first time out grows this big:
+		void copyTo(std::vector<glm::vec2>& out) const { out.assign(points, points + size); }
+	};
+
+	// The same polygons, but structure of arrays: x[i][lane] is point i of the polygon in that lane, so one sse
+	// register holds point i of LANES polygons.  Only the clip kernels below need to see this.
+	struct PolyBatch {
+		static const int LANES = 4;
+		// One spare row so the kernel can always load point i + 1, and write past a full lane:
+		alignas(16) float x[InlinePoly::MAX_POINTS + 1][LANES];
+		alignas(16) float y[InlinePoly::MAX_POINTS + 1][LANES];
+		int size[LANES];
+
+		void load(const InlinePoly* polys, int count);
+		void store(InlinePoly* polys, int count) const;
+	};
+
+	// Same result as sutherlandHodgemanPolyCrop(subject, clipTo, false), without any allocations.  clipTo needs
+	// at least 2 points (otherwise subject is emptied) and both need to be wound clockwise!
+	void clipPoly(InlinePoly& subject, const InlinePoly& clipTo);
+
+	// clipPoly() on every one of polys (all against the same clipTo), LANES at a time with sse.
+	void clipPolys(InlinePoly* polys, int count, const InlinePoly& clipTo);
+
+	// What sutherlandHodgemanPolyCrop does with removeDuplicatePoints.
+	void removeDuplicatePoints(InlinePoly& poly);
+
+	// Times the vector crop against clipPoly() and clipPolys() on random portal-stencil-like polygons and checks
+	// they all agree.  Prints the results, returns false if they didn't agree.
+	bool runClipBenchmark(int numPolys, int iterations);
+}
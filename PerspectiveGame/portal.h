@@ -7,10 +7,12 @@
 #include"makeShapes.h"
 #include"cameraManager.h"
 #include"shaderManager.h"
+#include"streamBuffer.h"
 
 struct Portal {
 	Camera* p_camera;
 	ShaderManager* p_shaderManager;
+	StreamBuffer* p_streamBuffer;
 	glm::vec2 postA, postB;
 	glm::vec4 boundingBox;
 	bool onSide;
@@ -22,13 +24,15 @@ public:
 	Portal() {
 		p_camera = nullptr;
 		p_shaderManager = nullptr;
+		p_streamBuffer = nullptr;
 		onSide = true;
 
 		siblingScaleDif = 0.0f;
 	}
-	Portal(Camera* c, ShaderManager* sm, glm::vec2 p1, glm::vec2 p2) {
+	Portal(Camera* c, ShaderManager* sm, StreamBuffer* sb, glm::vec2 p1, glm::vec2 p2) {
 		p_camera = c;
 		p_shaderManager = sm;
+		p_streamBuffer = sb;
 
 		postA = p1, postB = p2;
 		onSide = vechelp::isLeft(glm::vec2(p_camera->viewPlanePos.x, -p_camera->viewPlanePos.y),
@@ -164,61 +168,34 @@ public:
 			stencilVerts.push_back(vec.x);
 			stencilVerts.push_back(vec.y);
 		}
-		std::vector<GLsizei> indices;
+		std::vector<GLuint> indices;
 		for (int i = 0; i < currentFrustum.size() - 2; i++) {
 			indices.push_back(0);
 			indices.push_back(i + 1);
 			indices.push_back(i + 2);
 		}
 
-		// Create reference containers for the Vertex Array Object and the Vertex Buffer Object
-		GLuint VAO, VBO, EBO;
-
-		// Generate the VAO and VBO with only 1 object each
-		glGenVertexArrays(1, &VAO);
-		glGenBuffers(1, &VBO);
-		glGenBuffers(1, &EBO);
-
-		// Make the VAO the current Vertex Array Object by binding it
-		glBindVertexArray(VAO);
-
-		// Bind the VBO specifying it's a GL_ARRAY_BUFFER
-		glBindBuffer(GL_ARRAY_BUFFER, VBO);
-		// Introduce the vertices into the VBO
-		glBufferData(GL_ARRAY_BUFFER, stencilVerts.size() * sizeof(GLfloat), stencilVerts.data(), GL_STATIC_DRAW);
-
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
-
-		// Configure the Vertex Attribute so that OpenGL knows how to read the VBO
+		// Stencil shapes change every frame, so they go through the stream buffer rather than their own VAO/VBO:
+		StreamAllocation alloc = p_streamBuffer->uploadIndexed(stencilVerts.data(), stencilVerts.size() * sizeof(GLfloat),
+															   2 * sizeof(GLfloat),
+															   indices.data(), indices.size() * sizeof(GLuint));
+		p_streamBuffer->bind();
 		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
-		// Enable the Vertex Attribute so that OpenGL knows to use it
 		glEnableVertexAttribArray(0);
 
-		// Bind both the VBO and VAO to 0 so that we don't accidentally modify the VAO and VBO we created
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-
 		// Tell OpenGL which Shader Program we want to use
 		p_shaderManager->stencilShader.use();
 
 		//sceneAngleAdj = glm::rotate(glm::mat4(1), float(M_PI / 4), glm::vec3(0, 0, 1));
 
 		glm::vec3 testColor(1, 1, 1);
-		GLuint inColorID = glGetUniformLocation(p_shaderManager->stencilShader.ID, "inColor");
-		glUniform3f(inColorID, testColor.r, testColor.g, testColor.b);
+		p_shaderManager->stencilUniforms.inColor.set(testColor);
 
 		//scenePosAdj = glm::vec3((postA + postB), 0) / 2.0f;
 
-		// Bind the VAO so OpenGL knows to use it
-		glBindVertexArray(VAO);
-		// Draw the triangle using the GL_TRIANGLES primitive
-		//glDrawArrays(GL_TRIANGLES, 0, 24);
-		glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
-
-		glDeleteVertexArrays(1, &VAO);
-		glDeleteBuffers(1, &VBO);
-		glDeleteBuffers(1, &EBO);
+		glDrawElementsBaseVertex(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT,
+								 alloc.indexOffset(), alloc.baseVertex());
+		glBindVertexArray(0);
 	}
 };
 
@@ -258,6 +235,7 @@ struct PortalPair {
 struct PortalManager {
 	ShaderManager* p_shaderManager;
 	Camera* p_camera;
+	StreamBuffer* p_streamBuffer;
 
 	glm::vec2 PortalAStake1;
 	glm::vec2 PortalAStake2;
@@ -270,17 +248,20 @@ struct PortalManager {
 	std::vector<GLuint> indices;
 
 	float scaleChange = 1.0f; // <- used by sceneManager to scale player if they go through a portal.
+	int portalsVersion = 0; // bumped whenever a post moves, Scene rebuilds its PortalVisibilityGraph then.
+	std::vector<glm::vec2> lastPosts;
 
-	PortalManager(ShaderManager* sm, Camera* c) {
+	PortalManager(ShaderManager* sm, Camera* c, StreamBuffer* sb) {
 		p_shaderManager = sm;
 		p_camera = c;
+		p_streamBuffer = sb;
 		PortalPair pp;
 
-		Portal portalA(p_camera, p_shaderManager,
+		Portal portalA(p_camera, p_shaderManager, p_streamBuffer,
 			glm::vec2(+0.6f, -0.5f),
 			glm::vec2(+0.6f, +0.5f));
 
-		Portal portalB(p_camera, p_shaderManager,
+		Portal portalB(p_camera, p_shaderManager, p_streamBuffer,
 			glm::vec2(-0.6f, -0.5f),
 			glm::vec2(-0.6f, +0.5f));
 
@@ -289,11 +270,11 @@ struct PortalManager {
 		pp.update();
 		portalPairs.push_back(pp);
 
-		Portal portalC(p_camera, p_shaderManager,
+		Portal portalC(p_camera, p_shaderManager, p_streamBuffer,
 			glm::vec2(+0.5f, +0.6f),
 			glm::vec2(-0.5f, +0.6f));
 
-		Portal portalD(p_camera, p_shaderManager,
+		Portal portalD(p_camera, p_shaderManager, p_streamBuffer,
 			glm::vec2(+0.5f, -.6f),
 			glm::vec2(-0.5f, -.6f));
 
@@ -347,6 +328,20 @@ struct PortalManager {
 		for (PortalPair& portalPair : portalPairs) {
 			portalPair.update();
 		}
+		if (postsMoved()) portalsVersion++;
+	}
+
+	bool postsMoved() {
+		bool moved = lastPosts.size() != portalPairs.size() * 4;
+		lastPosts.resize(portalPairs.size() * 4);
+		for (int i = 0; i < portalPairs.size(); i++) {
+			glm::vec2 posts[4] = { portalPairs[i].A.postA, portalPairs[i].A.postB, portalPairs[i].B.postA, portalPairs[i].B.postB };
+			for (int j = 0; j < 4; j++) {
+				moved |= lastPosts[4 * i + j] != posts[j];
+				lastPosts[4 * i + j] = posts[j];
+			}
+		}
+		return moved;
 	}
 
 	void updatePosIfPassThroughSpecificPortal(float angle, glm::vec3 postAtoOrigin, glm::vec3 postBtoOrigin,
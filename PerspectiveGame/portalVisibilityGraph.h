@@ -0,0 +1,112 @@
+#pragma once
+#include <vector>
+
+#include"dependancyHeaders.h"
+
+#include"vectorHelperFunctions.h"
+#include"portal.h"
+
+// Which chains of portals (looking through A, then through B seen through A, ...) can possibly be seen from the
+// camera's cell, where a cell is everywhere that's on the same side of every portal line in the graph (including
+// the portals seen through other portals).  Anything seen through a portal has to be at least partly past its line,
+// so that's all the walk checks, plus skipping the portal you just came out of.
+// None of that depends on where in the cell the camera is or which way it's looking, so the graph (with every
+// chain's transforms) is kept until the camera changes cells (crossing a portal always does) or a portal moves.
+// Scene then only re-clips the stencils along it each frame.
+struct PortalVisibilityGraph {
+	static const int MAX_NODES = 4096; // past this the deepest chains get left out.
+
+	struct Node {
+		Portal* portal, * sibling;
+		int parent; // -1 if the portal is in the camera's own cell.
+		int depth;
+		glm::mat4 transf, transfNoScale; // from the world seen through this chain back to the camera's.
+		glm::vec2 lineA, lineB; // the portal's posts in the camera's world.
+		bool camOnLeft;
+		std::vector<int> children;
+	};
+
+	std::vector<Node> nodes;
+	std::vector<int> roots;
+	int builtPortalsVersion = -1;
+	int numRebuilds = 0; // for the debug window.
+
+	// Where the sibling's side of the portal ends up when seen through it, on top of the parent chain's transforms:
+	static void chainTransfs(Portal* portal, Portal* sibling, const glm::mat4& parentTransf, const glm::mat4& parentTransfNoScale,
+							 glm::mat4& transf, glm::mat4& transfNoScale)
+	{
+		glm::mat4 goToOriginTransf = glm::translate(glm::mat4(1), -glm::vec3(sibling->averagePostPos(), 0));
+		glm::mat4 rotateTransf = glm::rotate(glm::mat4(1), portal->angleToConnectedPortal, glm::vec3(0, 0, 1));
+		// Going through portals of different sizes will scale the object going through:
+		glm::mat4 zoomTransf = glm::scale(glm::mat4(1), glm::vec3(portal->siblingScaleDif, portal->siblingScaleDif, portal->siblingScaleDif));
+		glm::mat4 goToSiblingTransf = glm::translate(glm::mat4(1), glm::vec3(portal->averagePostPos(), 0));
+		transf = parentTransf * goToSiblingTransf * zoomTransf * rotateTransf * goToOriginTransf;
+		transfNoScale = parentTransfNoScale * goToSiblingTransf * rotateTransf * goToOriginTransf;
+	}
+
+	bool isStale(glm::vec2 camPos, int portalsVersion)
+	{
+		if (portalsVersion != builtPortalsVersion) return true;
+		for (Node& n : nodes) {
+			if (vechelp::isLeft(camPos, n.lineA, n.lineB) != n.camOnLeft) return true;
+		}
+		return false;
+	}
+
+	void build(std::vector<PortalPair>& portalPairs, glm::vec2 camPos, int maxDepth, int portalsVersion)
+	{
+		nodes.clear();
+		roots.clear();
+		builtPortalsVersion = portalsVersion;
+		numRebuilds++;
+		if (maxDepth <= 0) return;
+
+		for (PortalPair& pp : portalPairs) {
+			roots.push_back(addNode(&pp.A, &pp.B, -1, camPos));
+			roots.push_back(addNode(&pp.B, &pp.A, -1, camPos));
+		}
+
+		// Breadth first, so hitting MAX_NODES loses the deepest chains:
+		for (int n = 0; n < (int)nodes.size(); n++) {
+			if (nodes[n].depth + 1 >= maxDepth) continue;
+			for (PortalPair& pp : portalPairs) {
+				tryAddChild(n, &pp.A, &pp.B, camPos);
+				tryAddChild(n, &pp.B, &pp.A, camPos);
+			}
+		}
+	}
+
+private:
+	int addNode(Portal* portal, Portal* sibling, int parent, glm::vec2 camPos)
+	{
+		Node node;
+		node.portal = portal;
+		node.sibling = sibling;
+		node.parent = parent;
+		node.depth = (parent == -1) ? 0 : nodes[parent].depth + 1;
+		glm::mat4 parentTransf = (parent == -1) ? glm::mat4(1) : nodes[parent].transf;
+		glm::mat4 parentTransfNoScale = (parent == -1) ? glm::mat4(1) : nodes[parent].transfNoScale;
+		chainTransfs(portal, sibling, parentTransf, parentTransfNoScale, node.transf, node.transfNoScale);
+		node.lineA = glm::vec2(parentTransf * glm::vec4(portal->postA, 0, 1));
+		node.lineB = glm::vec2(parentTransf * glm::vec4(portal->postB, 0, 1));
+		node.camOnLeft = vechelp::isLeft(camPos, node.lineA, node.lineB);
+		nodes.push_back(node);
+		return (int)nodes.size() - 1;
+	}
+
+	void tryAddChild(int parent, Portal* portal, Portal* sibling, glm::vec2 camPos)
+	{
+		if ((int)nodes.size() >= MAX_NODES) return;
+		// Coming out of the parent's sibling, which would lie right on top of the parent:
+		if (portal == nodes[parent].sibling) return;
+
+		// Has to be past the parent's line (as seen from the camera) to be seen through it:
+		const Node& p = nodes[parent];
+		glm::vec2 a = glm::vec2(p.transf * glm::vec4(portal->postA, 0, 1));
+		glm::vec2 b = glm::vec2(p.transf * glm::vec4(portal->postB, 0, 1));
+		if (vechelp::isLeft(a, p.lineA, p.lineB) == p.camOnLeft && vechelp::isLeft(b, p.lineA, p.lineB) == p.camOnLeft) return;
+
+		int child = addNode(portal, sibling, parent, camPos);
+		nodes[parent].children.push_back(child);
+	}
+};
@@ -61,6 +61,15 @@ public:
 		rotationMatrix2D = glm::mat4(1);
 	}
 
+	// Starts over in another tile, for when the whole world got swapped out from under it (see Scenario::apply()):
+	void reset(int newCenterNodeIndex)
+	{
+		centerNodeIndex = newCenterNodeIndex;
+		mapType = MAP_TYPE_IDENTITY;
+		lastRotationMatrixWeight = 0.0f;
+		rotationMatrix2D = glm::mat4(1);
+	}
+
 	CenterNode* getNode() { return static_cast<CenterNode*>(p_nodeNetwork->getNode(centerNodeIndex)); }
 	Tile* getTile() { return p_nodeNetwork->getTile(getNode()->getTileIndex()); }
 
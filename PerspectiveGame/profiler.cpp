@@ -0,0 +1,90 @@
+#include "profiler.h"
+#include <fstream>
+#include <algorithm>
+#include <iomanip>
+
+Profiler GlobalProfiler;
+
+void Profiler::endFrame()
+{
+	// Sum up what every thread recorded since the last frame.  The simulation thread ticks on its own time, so its
+	// phases land in whichever frame was running when they finished (none some frames, two others):
+	float frameTotals[NUM_PROFILE_PHASES] = {};
+	{
+		std::lock_guard<std::mutex> lock(threadBuffersMutex);
+		for (ProfileThreadBuffer* buffer : threadBuffers) {
+			uint64_t writeIndex = buffer->writeIndex.load(std::memory_order_acquire);
+			if (writeIndex - buffer->readIndex > ProfileThreadBuffer::CAPACITY) {
+				buffer->readIndex = writeIndex - ProfileThreadBuffer::CAPACITY;
+			}
+			for (; buffer->readIndex < writeIndex; buffer->readIndex++) {
+				const ProfileEvent& e = buffer->events[buffer->readIndex & (ProfileThreadBuffer::CAPACITY - 1)];
+				frameTotals[e.phase] += (e.end - e.start) / 1000000.0f;
+			}
+		}
+	}
+
+	int slot = currentFrame % HISTORY_FRAMES;
+	for (int p = 0; p < NUM_PROFILE_PHASES; p++) {
+		history[p][slot] = frameTotals[p];
+	}
+	numHistoryFrames = std::min(numHistoryFrames + 1, HISTORY_FRAMES);
+	currentFrame++;
+
+	for (int p = 0; p < NUM_PROFILE_PHASES; p++) {
+		computeStats(history[p], numHistoryFrames, stats[p]);
+	}
+	for (int p = 0; p < NUM_GPU_PASSES; p++) {
+		computeStats(gpuHistory[p], std::min(gpuNumSamples[p], HISTORY_FRAMES), gpuStats[p]);
+	}
+}
+
+// Percentiles over the history, a few hundred floats a phase so just sort them:
+void Profiler::computeStats(const float* samples, int numSamples, PhaseStats& out)
+{
+	if (numSamples == 0) {
+		out = {};
+		return;
+	}
+	sortScratch.assign(samples, samples + numSamples);
+	std::sort(sortScratch.begin(), sortScratch.end());
+
+	float sum = 0;
+	for (float t : sortScratch) sum += t;
+	auto percentile = [&](float q) { return sortScratch[std::min((int)(q * numSamples), numSamples - 1)]; };
+
+	out.average = sum / numSamples;
+	out.p50 = percentile(0.50f);
+	out.p95 = percentile(0.95f);
+	out.p99 = percentile(0.99f);
+	out.max = sortScratch.back();
+}
+
+bool Profiler::dumpChromeTrace(const char* path)
+{
+	std::ofstream file(path);
+	if (!file.is_open()) {
+		std::cout << "ERROR::PROFILER:: could not open " << path << std::endl;
+		return false;
+	}
+
+	file << std::fixed << std::setprecision(3);
+	file << "{\"traceEvents\":[\n";
+	bool first = true;
+	std::lock_guard<std::mutex> lock(threadBuffersMutex);
+	for (ProfileThreadBuffer* b : threadBuffers) {
+		uint64_t end = b->writeIndex.load(std::memory_order_acquire);
+		uint64_t begin = end > ProfileThreadBuffer::CAPACITY ? end - ProfileThreadBuffer::CAPACITY : 0;
+		for (uint64_t i = begin; i < end; i++) {
+			const ProfileEvent& e = b->events[i & (ProfileThreadBuffer::CAPACITY - 1)];
+			if (!first) file << ",\n";
+			first = false;
+			// Complete events, times in microseconds:
+			file << "{\"name\":\"" << PROFILE_PHASE_NAMES[e.phase] << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << b->threadIndex
+				<< ",\"ts\":" << e.start / 1000.0 << ",\"dur\":" << (e.end - e.start) / 1000.0
+				<< ",\"args\":{\"frame\":" << e.frame << "}}";
+		}
+	}
+	file << "\n]}\n";
+	return true;
+}
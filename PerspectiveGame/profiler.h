@@ -0,0 +1,184 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstdint>
+
+// Comment out to compile every PROFILE_SCOPE away:
+#define PROFILER_ENABLED
+
+// Everything that gets its own timer.  Add new ones above NUM_PROFILE_PHASES and give them a name in PROFILE_PHASE_NAMES.
+enum ProfilePhase : uint8_t {
+	PROFILE_PHASE_FRAME,
+	PROFILE_PHASE_CAMERA_UPDATE,
+	PROFILE_PHASE_SELECTION_UPDATE,
+	PROFILE_PHASE_NODE_NETWORK_UPDATE,
+	PROFILE_PHASE_EDIT_WORLD,
+	PROFILE_PHASE_MOVE_ENTITIES,
+	PROFILE_PHASE_UPDATE_GPU_ENTITIES,
+	PROFILE_PHASE_DRAW_2D,
+	PROFILE_PHASE_DRAW_3D,
+	PROFILE_PHASE_SWAP_BUFFERS,
+	PROFILE_PHASE_IMGUI,
+	PROFILE_PHASE_SIMULATION_STEP,
+	PROFILE_PHASE_BUILD_SNAPSHOT,
+	NUM_PROFILE_PHASES,
+};
+
+const char* const PROFILE_PHASE_NAMES[NUM_PROFILE_PHASES] = {
+	"frame",
+	"camera.update",
+	"CurrentSelection::update",
+	"TileNodeNetwork::update",
+	"CurrentSelection::tryEditWorld",
+	"EntityManager::moveEntities",
+	"EntityManager::updateGpuEntities",
+	"draw2d3rdPerson",
+	"draw3d3rdPerson",
+	"glfwSwapBuffers",
+	"ImGui debug windows",
+	"Simulation::step",
+	"Simulation snapshot",
+};
+
+// Gpu side passes, timed with GL_TIME_ELAPSED queries (see gpuTimer.h):
+enum GpuPass : uint8_t {
+	GPU_PASS_2D_RAYCAST,
+	GPU_PASS_2D_ENTITIES,
+	GPU_PASS_3D_TILES,
+	GPU_PASS_BUTTON_COMPOSITE,
+	GPU_PASS_IMGUI,
+	NUM_GPU_PASSES,
+};
+
+const char* const GPU_PASS_NAMES[NUM_GPU_PASSES] = {
+	"draw2d3rdPersonViaNodeNetwork",
+	"drawEntityInstances",
+	"draw3Dview",
+	"button composites",
+	"ImGui",
+};
+
+struct ProfileEvent {
+	int64_t start; // ns since the profiler started.
+	int64_t end;
+	uint32_t frame;
+	ProfilePhase phase;
+};
+
+// One per thread, only ever written by its own thread so no locking on the hot path.  Readers look at
+// everything below writeIndex; if they fall a whole ring behind they can see an event being overwritten.
+struct ProfileThreadBuffer {
+	static const int CAPACITY = 1 << 14; // power of 2.
+
+	std::array<ProfileEvent, CAPACITY> events;
+	std::atomic<uint64_t> writeIndex{ 0 };
+	uint64_t readIndex = 0; // how far Profiler::endFrame() has summed, only touched by it.
+	int threadIndex = 0;
+
+	void push(const ProfileEvent& e)
+	{
+		uint64_t i = writeIndex.load(std::memory_order_relaxed);
+		events[i & (CAPACITY - 1)] = e;
+		writeIndex.store(i + 1, std::memory_order_release);
+	}
+};
+
+struct Profiler {
+	static const int HISTORY_FRAMES = 256;
+
+	std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+	std::atomic<uint32_t> currentFrame{ 0 }; // read by the simulation thread when it records.
+
+	// Per phase time spent in each of the last HISTORY_FRAMES frames (ms), main thread only:
+	float history[NUM_PROFILE_PHASES][HISTORY_FRAMES] = {};
+	int numHistoryFrames = 0;
+
+	// Rolling stats over history, refreshed every endFrame():
+	struct PhaseStats { float average, p50, p95, p99, max; };
+	PhaseStats stats[NUM_PROFILE_PHASES] = {};
+
+	// Same again for the gpu passes.  These arrive GpuTimer::NUM_QUERY_SETS frames late and can skip frames, so each
+	// pass keeps its own count, and the frame its last sample was issued in:
+	float gpuHistory[NUM_GPU_PASSES][HISTORY_FRAMES] = {};
+	int gpuNumSamples[NUM_GPU_PASSES] = {};
+	uint32_t gpuLastSampleFrame[NUM_GPU_PASSES] = {};
+	PhaseStats gpuStats[NUM_GPU_PASSES] = {};
+
+private:
+	std::mutex threadBuffersMutex; // taken when a thread records its first event, once a frame and when dumping.
+	std::vector<ProfileThreadBuffer*> threadBuffers;
+	std::vector<float> sortScratch;
+
+	void computeStats(const float* samples, int numSamples, PhaseStats& out);
+
+public:
+	~Profiler()
+	{
+		for (ProfileThreadBuffer* b : threadBuffers) delete b;
+	}
+
+	int64_t now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count();
+	}
+
+	ProfileThreadBuffer& getThreadBuffer()
+	{
+		thread_local ProfileThreadBuffer* buffer = nullptr;
+		if (buffer == nullptr) {
+			std::lock_guard<std::mutex> lock(threadBuffersMutex);
+			buffer = new ProfileThreadBuffer;
+			buffer->threadIndex = (int)threadBuffers.size();
+			threadBuffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+
+	void record(ProfilePhase phase, int64_t start, int64_t end)
+	{
+		getThreadBuffer().push({ start, end, currentFrame, phase });
+	}
+
+	// Main thread only, called by GpuTimer when a query result comes back:
+	void recordGpu(GpuPass pass, float ms, uint32_t issuedFrame)
+	{
+		gpuHistory[pass][gpuNumSamples[pass] % HISTORY_FRAMES] = ms;
+		gpuNumSamples[pass]++;
+		gpuLastSampleFrame[pass] = issuedFrame;
+	}
+
+	// The newest result for pass.  It's for the frame in gpuLastSampleFrame[pass], which is (at best) two frames
+	// before the one that's running, not the last one:
+	float lastGpuSample(GpuPass pass) const
+	{
+		return gpuNumSamples[pass] == 0 ? 0.0f : gpuHistory[pass][(gpuNumSamples[pass] - 1) % HISTORY_FRAMES];
+	}
+
+	// Call from the main thread once a frame, after the frame's timer has closed.
+	void endFrame();
+
+	// Writes every event still in the ring buffers as a chrome://tracing (or ui.perfetto.dev) json file.
+	bool dumpChromeTrace(const char* path);
+};
+
+extern Profiler GlobalProfiler;
+
+struct ScopedProfileTimer {
+	ProfilePhase phase;
+	int64_t start;
+
+	ScopedProfileTimer(ProfilePhase phase) : phase(phase), start(GlobalProfiler.now()) {}
+	~ScopedProfileTimer() { GlobalProfiler.record(phase, start, GlobalProfiler.now()); }
+};
+
+#ifdef PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(phase) ScopedProfileTimer PROFILE_CONCAT(profileTimer, __LINE__)(phase)
+#else
+#define PROFILE_SCOPE(phase)
+#endif
@@ -1,143 +1,236 @@
 #pragma once
 
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+#include <algorithm>
+#include <filesystem>
 
-#include"currentSelection.h"
-#include"tileManager.h"
-#include"entityManager.h"
-
-//void create4x4TileGrid(TileManager* tm)
-//{
-//	for (int w = 1; w < 5; w++) {
-//		for (int h = 1; h < 5; h++) {
-//			tm->createTilePair(TILE_TYPE_XY, glm::ivec3(w, h, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, 0.5));
-//		}
-//	}
-//	tm->povTile.node = tm->tiles[0];
-//}
-//
-//void clearWorld(TileManager* tm, EntityManager* em)
-//{
-//	int s = (int)em->entities.size();
-//	for (int i = 0; i < s; i++) {
-//		em->deleteEntity(&em->entities[0]);
-//	}
-//	s = (int)tm->tiles.size() / 2;
-//	for (int i = 0; i < s; i++) {
-//		tm->deleteTilePair(tm->tiles[0], true);
-//	}
-//	std::cout <<"num tiles after delete: " << tm->tiles.size() << std::endl;
-//}
-//
-//void fullContactDirectCollision(TileManager* tm, EntityManager* em, CurrentSelection* cs)
-//{
-//	clearWorld(tm, em);
-//	create4x4TileGrid(tm);
-//	em->createEntity(0, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_0, LOCAL_ORIENTATION_0);
-//	em->createEntity(24, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_2, LOCAL_ORIENTATION_0);
-//	std::cout << "Scenario setup: Direct orthogonal collision from center positions." << std::endl;
-//}
-//
-//void fullContactDirectCollisionOnStatic(TileManager* tm,EntityManager* em, CurrentSelection* cs)
-//{
-//	clearWorld(tm, em);
-//	create4x4TileGrid(tm);
-//	em->createEntity(0, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_0, LOCAL_ORIENTATION_0);
-//	em->createEntity(16, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_STATIC, LOCAL_ORIENTATION_0);
-//	std::cout << "Scenario setup: Direct orthogonal collision with static entity from center positions." << std::endl;
-//}
-//
-//void fullContactTCollision(TileManager* tm, EntityManager* em, CurrentSelection* cs)
-//{
-//	clearWorld(tm, em);
-//	create4x4TileGrid(tm);
-//	em->createEntity(0, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_0, LOCAL_ORIENTATION_0);
-//	em->createEntity(12, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_1, LOCAL_ORIENTATION_0);
-//	std::cout << "Scenario setup: Side orthogonal collision from center positions." << std::endl;
-//}
-//
-//void setupScenarioCornerCollisionFromCenter(TileManager* tm, EntityManager* em, CurrentSelection* cs)
-//{
-//	clearWorld(tm, em);
-//	create4x4TileGrid(tm);
-//	em->createEntity(0, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_0, LOCAL_ORIENTATION_0);
-//	em->createEntity(20, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_1, LOCAL_ORIENTATION_0);
-//	std::cout << "Scenario setup: Corner orthogonal collision from center positions." << std::endl;
-//}
-//
-//void setupScenarioDirectCollisionFromEdge(TileManager* tm, EntityManager* em, CurrentSelection* cs)
-//{
-//	clearWorld(tm, em);
-//	create4x4TileGrid(tm);
-//	em->createEntity(0, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_0, LOCAL_ORIENTATION_0);
-//	em->createEntity(16, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_2, LOCAL_ORIENTATION_0);
-//	std::cout << "Scenario setup: Direct orthogonal collision from edge positions." << std::endl;
-//}
-//
-//void setupCollisionScenario4(TileManager* tm, EntityManager* em, CurrentSelection* cs)
-//{
-//	clearWorld(tm, em);
-//	create4x4TileGrid(tm);
-//	em->createEntity(0, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_3_0, LOCAL_ORIENTATION_0);
-//	em->createEntity(24, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_2_3, LOCAL_ORIENTATION_0);
-//	std::cout << "Scenario setup: Direct orthogonal collision from edge positions." << std::endl;
-//}
-//
-//void setupCollisionScenario5(TileManager* tm, EntityManager* em, CurrentSelection* cs)
-//{
-//	clearWorld(tm, em);
-//	create4x4TileGrid(tm);
-//	em->createEntity(0, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_3_0, LOCAL_ORIENTATION_0);
-//	em->createEntity(16, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_2, LOCAL_ORIENTATION_0);
-//	std::cout << "Scenario setup: Direct orthogonal collision from edge positions." << std::endl;
-//}
-//
-//void setupCollisionScenario6(TileManager* tm, EntityManager* em, CurrentSelection* cs)
-//{
-//	clearWorld(tm, em);
-//	create4x4TileGrid(tm);
-//	//em->createEntity(0, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_3_0, LOCAL_ORIENTATION_0);
-//	em->createEntity(6, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_0_1, LOCAL_ORIENTATION_0);
-//	em->createEntity(24, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_2_3, LOCAL_ORIENTATION_0);
-//	em->createEntity(30, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_1_2, LOCAL_ORIENTATION_0);
-//	//em->createEntity(0, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_0, LOCAL_ORIENTATION_0);
-//	//em->createEntity(8, ENTITY_TYPE_OMNI, LOCAL_DIRECTION_0_1, LOCAL_ORIENTATION_0);
-//	std::cout << "Scenario setup: Direct orthogonal collision from edge positions." << std::endl;
-//}
-//
-//void setupTestScenario(int scenarioID, TileManager* tm, EntityManager* em, CurrentSelection* cs)
-//{
-//	switch (scenarioID) {
-//	case 0: 
-//		setupCollisionScenario4(tm, em, cs);
-//		break;
-//	case 1: 
-//		fullContactDirectCollisionOnStatic(tm, em, cs); 
-//		break;
-//	case 2: 
-//		fullContactTCollision(tm, em, cs); 
-//		break;
-//	case 3: 
-//		setupScenarioCornerCollisionFromCenter(tm, em, cs); 
-//		break;
-//	case 4: 
-//		fullContactDirectCollision(tm, em, cs);
-//		break;
-//	default: 
-//		clearWorld(tm, em); create4x4TileGrid(tm); 
-//		std::cout << "Default Scenario: Empty 4x4 world." << std::endl;
-//		break;
-//	}
-//}
-//
-//int ticksPerScenario(int scenarioID)
-//{
-//	switch (scenarioID) {
-//	case 0:	return 4;
-//	case 1:	return 4;
-//	case 2:	return 4;
-//	case 3:	return 4;
-//	case 4:	return 4;
-//	default: return 4;
-//	}
-//}
+#include "worldEdit.h"
+#include "forceManager.h"
+#include "tileNodeNetwork.h"
+#include "entityManager.h"
+#include "pov.h"
+#include "memoryAccounting.h"
+
+// A whole world to load in one go, for test scenarios and benchmark worlds, so a new one is a new file instead of a
+// recompile.  Text file, one thing per line (# starts a comment).  Tiles are given by lattice cell, see
+// latticeTilePos() in worldEdit.h:
+//   name <anything>                           shown in the logs, the file name if there's none
+//   ticks <n>                                 how many ticks it runs before the next scenario (default 100)
+//   tile <XY|XZ|YZ> <i> <j> <k>               one tile pair
+//   tiles <XY|XZ|YZ> <i0> <j0> <k0> <i1> <j1> <k1>   every tile pair of that type in the (inclusive) range
+//   box <i0> <j0> <k0> <i1> <j1> <k1>         a block of lattice cells.  The outside of all the boxes together gets tiled.
+//   entity <XY|XZ|YZ> <i> <j> <k> <front|back> <0|1|2|3|0_1|1_2|2_3|3_0|static>   an entity on that tile pair
+struct Scenario {
+	struct EntityPlacement {
+		glm::vec3 tilePos;
+		bool front;
+		LocalDirection direction;
+	};
+
+	std::string name;
+	int ticks = 100;
+	std::vector<WorldEdit> tiles; // all creates, in the order they get built.
+	std::vector<EntityPlacement> entities;
+
+	bool load(const std::string& path)
+	{
+		std::ifstream file(path);
+		if (!file.is_open()) {
+			std::cout << "ERROR::SCENARIO:: could not open " << path << std::endl;
+			return false;
+		}
+		name = std::filesystem::path(path).stem().string();
+		ticks = 100;
+		tiles.clear();
+		entities.clear();
+		std::set<std::tuple<int, int, int>> boxCells;
+
+		std::string line;
+		for (int lineNumber = 1; std::getline(file, line); lineNumber++) {
+			line = line.substr(0, line.find('#'));
+			if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+			std::istringstream in(line);
+			std::string what, typeName, side, directionName;
+			in >> what;
+			SuperTileType type;
+			glm::ivec3 a, b;
+			bool ok;
+			if (what == "name") {
+				std::getline(in >> std::ws, name);
+				ok = !name.empty();
+			}
+			else if (what == "ticks") {
+				ok = (in >> ticks) && ticks > 0;
+			}
+			else if (what == "tile") {
+				ok = (in >> typeName >> a.x >> a.y >> a.z) && parseType(typeName, type);
+				if (ok) tiles.push_back(WorldEdit::createTilePair(latticeTilePos(type, a.x, a.y, a.z), type));
+			}
+			else if (what == "tiles") {
+				ok = (in >> typeName >> a.x >> a.y >> a.z >> b.x >> b.y >> b.z) && parseType(typeName, type);
+				for (int i = a.x; ok && i <= b.x; i++)
+					for (int j = a.y; j <= b.y; j++)
+						for (int k = a.z; k <= b.z; k++) tiles.push_back(WorldEdit::createTilePair(latticeTilePos(type, i, j, k), type));
+			}
+			else if (what == "box") {
+				ok = (bool)(in >> a.x >> a.y >> a.z >> b.x >> b.y >> b.z);
+				for (int i = a.x; ok && i <= b.x; i++)
+					for (int j = a.y; j <= b.y; j++)
+						for (int k = a.z; k <= b.z; k++) boxCells.insert({ i, j, k });
+			}
+			else if (what == "entity") {
+				EntityPlacement e;
+				ok = (in >> typeName >> a.x >> a.y >> a.z >> side >> directionName) && parseType(typeName, type) &&
+					(side == "front" || side == "back") && parseDirection(directionName, e.direction);
+				e.tilePos = latticeTilePos(type, a.x, a.y, a.z);
+				e.front = side == "front";
+				if (ok) entities.push_back(e);
+			}
+			else {
+				std::cout << "ERROR::SCENARIO:: " << path << ":" << lineNumber << " unknown '" << what << "'" << std::endl;
+				return false;
+			}
+			if (!ok) {
+				std::cout << "ERROR::SCENARIO:: " << path << ":" << lineNumber << " can't read '" << line << "'" << std::endl;
+				return false;
+			}
+		}
+
+		// A face of a box cell is on the outside if the cell on the other side of it isn't in a box:
+		auto outside = [&](int i, int j, int k) { return boxCells.count({ i, j, k }) == 0; };
+		for (const auto& [i, j, k] : boxCells) {
+			if (outside(i, j, k - 1)) tiles.push_back(WorldEdit::createTilePair(latticeTilePos(TILE_TYPE_XY, i, j, k), TILE_TYPE_XY));
+			if (outside(i, j, k + 1)) tiles.push_back(WorldEdit::createTilePair(latticeTilePos(TILE_TYPE_XY, i, j, k + 1), TILE_TYPE_XY));
+			if (outside(i, j - 1, k)) tiles.push_back(WorldEdit::createTilePair(latticeTilePos(TILE_TYPE_XZ, i, j, k), TILE_TYPE_XZ));
+			if (outside(i, j + 1, k)) tiles.push_back(WorldEdit::createTilePair(latticeTilePos(TILE_TYPE_XZ, i, j + 1, k), TILE_TYPE_XZ));
+			if (outside(i - 1, j, k)) tiles.push_back(WorldEdit::createTilePair(latticeTilePos(TILE_TYPE_YZ, i, j, k), TILE_TYPE_YZ));
+			if (outside(i + 1, j, k)) tiles.push_back(WorldEdit::createTilePair(latticeTilePos(TILE_TYPE_YZ, i + 1, j, k), TILE_TYPE_YZ));
+		}
+		return true;
+	}
+
+	// Throws the old world away and builds this one through TileNodeNetwork::createTilePairs().  The pov starts
+	// on the first front XY tile (the 2D view assumes it starts in one), or the first tile if there's none.
+	// Needs the world to itself, see Simulation::loadScenario().  Returns how many tile pairs it made.
+	int apply(TileNodeNetwork& nodeNetwork, EntityManager& entityManager, POV& pov) const
+	{
+		entityManager.clear();
+		nodeNetwork.clear();
+		int numPairs = nodeNetwork.createTilePairs(tiles);
+		if (numPairs == 0) {
+			std::cout << "ERROR::SCENARIO:: " << name << " has no tiles, using one at the origin" << std::endl;
+			nodeNetwork.createTilePair(glm::vec3(0), TILE_TYPE_XY);
+			numPairs = 1;
+		}
+
+		// Front and back center nodes of every tile pair, by position:
+		std::unordered_map<uint64_t, int> frontNodes, backNodes;
+		int povNode = -1;
+		for (int t = 0; t < nodeNetwork.numTiles(); t++) {
+			Tile* tile = nodeNetwork.getTile(t);
+			if (tile->index == -1) continue;
+			uint64_t key = TileNodeNetwork::positionKey(nodeNetwork.getNode(tile->centerNodeIndex)->getPosition());
+			(tnav::isFront(tile->type) ? frontNodes : backNodes)[key] = tile->centerNodeIndex;
+			if (povNode == -1 || (tile->type == TILE_TYPE_XYF && nodeNetwork.getNode(povNode)->orientation != TILE_TYPE_XYF))
+				povNode = tile->centerNodeIndex;
+		}
+		pov.reset(povNode);
+
+		for (const EntityPlacement& e : entities) {
+			std::unordered_map<uint64_t, int>& sideNodes = e.front ? frontNodes : backNodes;
+			auto found = sideNodes.find(TileNodeNetwork::positionKey(e.tilePos));
+			if (found == sideNodes.end()) {
+				std::cout << "ERROR::SCENARIO:: " << name << " has an entity on a missing tile" << std::endl;
+				continue;
+			}
+			entityManager.createEntity(static_cast<CenterNode*>(nodeNetwork.getNode(found->second)), e.direction);
+		}
+		return numPairs;
+	}
+
+private:
+	static bool parseType(const std::string& s, SuperTileType& out)
+	{
+		if (s == "XY") out = TILE_TYPE_XY;
+		else if (s == "XZ") out = TILE_TYPE_XZ;
+		else if (s == "YZ") out = TILE_TYPE_YZ;
+		else return false;
+		return true;
+	}
+
+	static bool parseDirection(const std::string& s, LocalDirection& out)
+	{
+		static const std::pair<const char*, LocalDirection> names[] = {
+			{ "0", LOCAL_DIRECTION_0 }, { "1", LOCAL_DIRECTION_1 }, { "2", LOCAL_DIRECTION_2 }, { "3", LOCAL_DIRECTION_3 },
+			{ "0_1", LOCAL_DIRECTION_0_1 }, { "1_2", LOCAL_DIRECTION_1_2 }, { "2_3", LOCAL_DIRECTION_2_3 },
+			{ "3_0", LOCAL_DIRECTION_3_0 }, { "static", LOCAL_DIRECTION_STATIC },
+		};
+		for (const auto& n : names) {
+			if (s == n.first) {
+				out = n.second;
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+// Every .scenario file in a directory, sorted by name so they always come round in the same order:
+inline std::vector<std::string> listScenarioFiles(const std::string& directory)
+{
+	std::vector<std::string> files;
+	std::error_code error;
+	for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+		if (entry.is_regular_file() && entry.path().extension() == ".scenario") files.push_back(entry.path().string());
+	}
+	if (error) std::cout << "ERROR::SCENARIO:: could not read " << directory << ": " << error.message() << std::endl;
+	std::sort(files.begin(), files.end());
+	return files;
+}
+
+// How long one scenario took, for the logs and the headless runner's csv:
+struct ScenarioTiming {
+	std::string name;
+	int numTilePairs = 0;
+	int numEntities = 0;
+	float loadMs = 0;
+	int ticks = 0;
+	float tickMs = 0;  // average simulation step (all of them tick), -1 if the simulation thread ran them.
+	int frames = 0;
+	float frameMs = 0; // average.
+
+	// From the last snapshot, see memoryAccounting.h.  Peaks are since the scenario loaded:
+	size_t memoryBytes = 0;
+	size_t peakMemoryBytes = 0;
+	double bytesPerTilePair = 0;
+	size_t glBufferBytes = 0;
+	size_t peakHeapBytes = 0; // the whole process.
+
+	void recordMemory(const MemoryTracker& memory, size_t glBuffers, size_t peakHeap)
+	{
+		memoryBytes = memory.current.total();
+		peakMemoryBytes = memory.peakTotal;
+		bytesPerTilePair = memory.current.bytesPerTilePair();
+		glBufferBytes = glBuffers;
+		peakHeapBytes = peakHeap;
+	}
+};
+
+inline void printScenarioTiming(const ScenarioTiming& t)
+{
+	std::cout << "Scenario '" << t.name << "': " << t.numTilePairs << " tile pairs, " << t.numEntities << " entities, load "
+		<< t.loadMs << " ms, " << t.ticks << " ticks";
+	if (t.tickMs >= 0) std::cout << " at " << t.tickMs << " ms";
+	std::cout << ", " << t.frames << " frames at " << t.frameMs << " ms" << std::endl;
+	std::cout << "  memory " << t.memoryBytes / 1024 << " KB (peak " << t.peakMemoryBytes / 1024 << " KB, "
+		<< (int)t.bytesPerTilePair << " bytes per tile pair), gl buffers " << t.glBufferBytes / 1024 << " KB, heap peak "
+		<< t.peakHeapBytes / 1024 << " KB" << std::endl;
+}
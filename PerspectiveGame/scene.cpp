@@ -1,6 +1,6 @@
 #include"scene.h"
 
-bool comparePortalReferences(PortalReference A, PortalReference B) {
+bool comparePortalReferences(const PortalReference& A, const PortalReference& B) {
 	return (A.distToClosesetPole > B.distToClosesetPole);
 }
 
@@ -19,20 +19,17 @@ int pointIsSuperInsidePoly(glm::vec2 p, std::vector<glm::vec2>poly) {
 	return 1;
 }
 
-Scene::Scene(Camera* c, PortalManager* pm, ShaderManager* sm) {
+Scene::Scene(Camera* c, PortalManager* pm, ShaderManager* sm, StreamBuffer* sb) {
 	p_camera = c;
 	p_portalManager = pm;
 	p_shaderManager = sm;
+	p_streamBuffer = sb;
 	sceneSize = glm::ivec2(1000, 1000);
 
 	glGenVertexArrays(1, &VAO);
 	glGenBuffers(1, &VBO);
 	glGenBuffers(1, &EBO);
 
-	glGenVertexArrays(1, &stencilVAO);
-	glGenBuffers(1, &stencilVBO);
-	glGenBuffers(1, &stencilEBO);
-
 	glGenTextures(1, &sceneTexture);
 	glBindTexture(GL_TEXTURE_2D, sceneTexture);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -97,7 +94,7 @@ Scene::Scene(Camera* c, PortalManager* pm, ShaderManager* sm) {
 	si.clear();
 }
 
-std::vector<glm::vec2> createStencil(glm::vec2 p1, glm::vec2 p2, Camera* camera, bool onLeft) {
+void createStencil(glm::vec2 p1, glm::vec2 p2, Camera* camera, bool onLeft, vechelp::InlinePoly& currentFrustum) {
 	glm::vec2 camPos = glm::vec2(camera->viewPlanePos);
 	camPos.y *= -1;
 	glm::vec2 p1Vec = vechelp::rotate(2.0f * glm::normalize(p1 - camPos), -camera->yaw - (float)M_PI);
@@ -126,30 +123,28 @@ std::vector<glm::vec2> createStencil(glm::vec2 p1, glm::vec2 p2, Camera* camera,
 		std::swap(p1, p2);
 		std::swap(p1Vec, p2Vec);
 	}
-	std::vector<glm::vec2> currentFrustum;
-	currentFrustum.push_back(p2);
-	currentFrustum.push_back(p1);
-	currentFrustum.push_back(p1 + p1Vec);
-	currentFrustum.push_back(p1 + p1Vec + portalNorm);
-	currentFrustum.push_back(p2 + p2Vec + portalNorm);
-	currentFrustum.push_back(p2 + p2Vec);
-	return currentFrustum;
+	currentFrustum.clear();
+	currentFrustum.push(p2);
+	currentFrustum.push(p1);
+	currentFrustum.push(p1 + p1Vec);
+	currentFrustum.push(p1 + p1Vec + portalNorm);
+	currentFrustum.push(p2 + p2Vec + portalNorm);
+	currentFrustum.push(p2 + p2Vec);
 }
 
-bool Scene::createPortalReference(PortalReference* pr, PortalReference parentPr) 
+void Scene::preparePortalReference(PortalReference* pr, const PortalReference& parentPr,
+								   vechelp::InlinePoly& posts, vechelp::InlinePoly& stencil)
 {
 	using namespace vechelp;
 
 	// Quick/visually necessary cull to see if the portal even needs to be drawn.  If neither posts 
 	// are inside the parent stencil, then there is not need to do any more work as it cannot be seen.
+	// The posts get cropped as a 2 point 'polygon' along with the stencil, in createPortalReference().
 	glm::vec2 postAScreenSpace = glm::vec2(p_camera->transfMatrix * parentPr.transf * glm::vec4(pr->portal->postA, 0, 1));
 	glm::vec2 postBScreenSpace = glm::vec2(p_camera->transfMatrix * parentPr.transf * glm::vec4(pr->portal->postB, 0, 1));
-	// There has to be a more efficient way to check this but this works:
-	std::vector<glm::vec2> testStencilInsideParent = { postAScreenSpace, postBScreenSpace };
-	sutherlandHodgemanPolyCrop(testStencilInsideParent, parentPr.stencil, false);
-	if (testStencilInsideParent.size() < 2) {
-		return false;
-	}
+	posts.clear();
+	posts.push(postAScreenSpace);
+	posts.push(postBScreenSpace);
 
 	// Depending on what side of the portal we are facing, the create stencil algo
 	// will output differently-wound polygons.  Sutherland Hodgeman algo expects all inputs to be 
@@ -157,28 +152,35 @@ bool Scene::createPortalReference(PortalReference* pr, PortalReference parentPr)
 	glm::vec2 camPos(p_camera->viewPlanePos.x, -p_camera->viewPlanePos.y);
 	glm::vec2 camPosScreenSpace = glm::vec2(p_camera->transfMatrix * glm::vec4(camPos, 0, 1));
 	bool onleft = isLeft(camPosScreenSpace, postAScreenSpace, postBScreenSpace);
-	// Finally we crop the stencil to the parent so that no overdraw happens:
 	glm::vec2 p1 = glm::vec2(parentPr.transf * glm::vec4(pr->portal->postA, 0, 1));
 	glm::vec2 p2 = glm::vec2(parentPr.transf * glm::vec4(pr->portal->postB, 0, 1));
-	std::vector<glm::vec2> stencil = createStencil(p1, p2, p_camera, onleft);
-	sutherlandHodgemanPolyCrop(stencil, parentPr.stencil, true);
-	if (stencil.size() <= 2) {
+	createStencil(p1, p2, p_camera, onleft, stencil);
+}
+
+bool Scene::createPortalReference(PortalReference* pr, const PortalReference& parentPr,
+								  const vechelp::InlinePoly& posts, vechelp::InlinePoly& stencil)
+{
+	using namespace vechelp;
+
+	if (posts.size < 2) {
+		return false;
+	}
+	removeDuplicatePoints(stencil);
+	if (stencil.size <= 2) {
 		return false; // Not sure why bus some stencils slip past the initial check.
 	}
-	pr->stencil = stencil;
+	stencil.copyTo(pr->stencil);
 
-	// Create the transformation matrix for the future draw call:
-	glm::mat4 goToOriginTransf = glm::translate(glm::mat4(1), -glm::vec3(pr->sibling->averagePostPos(), 0));
-	glm::mat4 rotateTransf = glm::rotate(glm::mat4(1), pr->portal->angleToConnectedPortal, glm::vec3(0, 0, 1));
-	// Going through portals of different sizes will scale the object going through:
-	glm::mat4 zoomTransf = glm::scale(glm::mat4(1), glm::vec3(pr->portal->siblingScaleDif, pr->portal->siblingScaleDif, pr->portal->siblingScaleDif));
-	glm::mat4 goToSiblingTransf = glm::translate(glm::mat4(1), glm::vec3(pr->portal->averagePostPos(), 0));
-	pr->transf = parentPr.transf * goToSiblingTransf * zoomTransf * rotateTransf * goToOriginTransf;
-	pr->transfNoScale = parentPr.transfNoScale * goToSiblingTransf * rotateTransf * goToOriginTransf;
+	// The transformation matrix for the future draw call doesn't depend on the camera, so the graph has it:
+	const PortalVisibilityGraph::Node& node = portalGraph.nodes[pr->node];
+	pr->transf = node.transf;
+	pr->transfNoScale = node.transfNoScale;
 
 	// Distance is used to draw the furthest portals first so that overlapping portals are
 	// drawn visually correct.  Because some portals warp space, we need to use a non-warped transf matrix,
 	// made earlier by omitting the scale step of the regular transf matrix.
+	glm::vec2 camPos(p_camera->viewPlanePos.x, -p_camera->viewPlanePos.y);
+	glm::vec2 camPosScreenSpace = glm::vec2(p_camera->transfMatrix * glm::vec4(camPos, 0, 1));
 	glm::vec2 postAScreenSpaceNoScale = glm::vec2(p_camera->transfMatrix * parentPr.transfNoScale * glm::vec4(pr->portal->postA, 0, 1));
 	glm::vec2 postBScreenSpaceNoScale = glm::vec2(p_camera->transfMatrix * parentPr.transfNoScale * glm::vec4(pr->portal->postB, 0, 1));
 	pr->distToClosesetPole = distToLineSeg(camPosScreenSpace, postAScreenSpaceNoScale, postBScreenSpaceNoScale, nullptr);
@@ -191,7 +193,7 @@ bool Scene::createPortalReference(PortalReference* pr, PortalReference parentPr)
 	return true;
 }
 
-void Scene::fillPortalViewDrawInfos(Portal* unclePortal, PortalReference parentPr, int recursionDepth, float totalZoom) {
+void Scene::fillPortalViewDrawInfos(const PortalReference& parentPr, int recursionDepth, float totalZoom) {
 	// This is a recursive function that decriments the depth each layer of stencils.  eventually it
 	// will reach an arbitrarily defined max depth and teminate.
 	if (recursionDepth >= MAX_SEEN_PORTALS) {
@@ -199,42 +201,52 @@ void Scene::fillPortalViewDrawInfos(Portal* unclePortal, PortalReference parentP
 	}
 
 	// We gotta reorganize the portals by closeness to the initial camera so 
-	// they can be drawin in order, painter style.
-	std::vector<PortalReference>portalReferences;
-	PortalReference pr;
-	for (PortalPair& portalPair : p_portalManager->portalPairs) {
-		pr.portal = &portalPair.A;
-		pr.sibling = &portalPair.B;
-		if (createPortalReference(&pr, parentPr)) {
-			portalReferences.push_back(pr);
-		}
-		pr.portal = &portalPair.B;
-		pr.sibling = &portalPair.A;
-		if (createPortalReference(&pr, parentPr)) {
-			portalReferences.push_back(pr);
-		}
+	// they can be drawin in order, painter style.  Only the portals the graph says could be seen through
+	// the parent get tried (it already left out the parent's sibling, the "Uncle", which would lie on top of it).
+	const std::vector<int>& candidates = (parentPr.node == -1) ? portalGraph.roots : portalGraph.nodes[parentPr.node].children;
+	std::vector<PortalReference>& portalReferences = portalReferenceScratch[recursionDepth];
+	int numCandidates = (int)candidates.size();
+	if ((int)portalReferences.size() < numCandidates) portalReferences.resize(numCandidates);
+	if ((int)stencilClipScratch.size() < numCandidates) {
+		postsClipScratch.resize(numCandidates);
+		stencilClipScratch.resize(numCandidates);
+	}
+	for (int i = 0; i < numCandidates; i++) {
+		PortalReference& pr = portalReferences[i];
+		pr.node = candidates[i];
+		pr.portal = portalGraph.nodes[pr.node].portal;
+		pr.sibling = portalGraph.nodes[pr.node].sibling;
+		preparePortalReference(&pr, parentPr, postsClipScratch[i], stencilClipScratch[i]);
+	}
+
+	// They're all cropped to the same parent stencil, so they go through together:
+	vechelp::InlinePoly parentStencil(parentPr.stencil);
+	vechelp::clipPolys(postsClipScratch.data(), numCandidates, parentStencil);
+	vechelp::clipPolys(stencilClipScratch.data(), numCandidates, parentStencil);
+
+	int numReferences = 0;
+	for (int i = 0; i < numCandidates; i++) {
+		if (!createPortalReference(&portalReferences[i], parentPr, postsClipScratch[i], stencilClipScratch[i])) continue;
+		if (i != numReferences) std::swap(portalReferences[i], portalReferences[numReferences]);
+		numReferences++;
 	}
 	// For now we can make the portals draw in order by sorthing them based on how close they are to the player.
 	// A better sorting/culling algo would be great but I dont know how to do it yet!
-	std::sort(portalReferences.begin(), portalReferences.end(), comparePortalReferences);
+	std::sort(portalReferences.begin(), portalReferences.begin() + numReferences, comparePortalReferences);
 
-	for (PortalReference& pr : portalReferences) {
-		// Last time this function was called, the parent portal was translated to it's siblings position.
-		// Now that we are inside the parent, we dont want to try and draw it's sibling, or "Uncle," as
-		// it would lie on top of the parent portal, screwing up the visuals.
-		if (pr.portal != unclePortal) {
-			stencilDrawInfos.push_back(StencilDrawInfo(pr.stencil, frameStencilVal, vechelp::randColor()));
+	for (int i = 0; i < numReferences; i++) {
+		PortalReference& pr = portalReferences[i];
+		stencilDrawInfos.push_back(StencilDrawInfo(pr.stencil, frameStencilVal, vechelp::randColor()));
 
-			portalViewDrawInfos.push_back(PortalViewDrawInfo(pr.transf, frameStencilVal,
-				totalZoom * pr.portal->siblingScaleDif, std::min(pr.tintAmount, 1.0f)));
+		portalViewDrawInfos.push_back(PortalViewDrawInfo(pr.transf, frameStencilVal,
+			totalZoom * pr.portal->siblingScaleDif, std::min(pr.tintAmount, 1.0f)));
 
-			frameStencilVal++;
+		frameStencilVal++;
 
-			// no sense continuing deeper into the recursive call if the tint is already opaque:
-			if (pr.tintAmount < 1.0f) {
-				pr.stencilVal = frameStencilVal;
-				fillPortalViewDrawInfos(pr.sibling, pr, recursionDepth + 1, totalZoom * pr.portal->siblingScaleDif);
-			}
+		// no sense continuing deeper into the recursive call if the tint is already opaque:
+		if (pr.tintAmount < 1.0f) {
+			pr.stencilVal = frameStencilVal;
+			fillPortalViewDrawInfos(pr, recursionDepth + 1, totalZoom * pr.portal->siblingScaleDif);
 		}
 	}
 }
@@ -247,40 +259,49 @@ void Scene::drawPortalStencils() {
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
-	glBindVertexArray(stencilVAO);
-	glBindBuffer(GL_ARRAY_BUFFER, stencilVBO);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, stencilEBO);
+	// Every stencil's verts, then every stencil's fan indices (relative to its own first vert), in one allocation:
+	int numVerts = 0, numIndices = 0;
+	for (StencilDrawInfo& sdi : stencilDrawInfos) {
+		if (sdi.stencil.size() < 3) continue;
+		numVerts += (int)sdi.stencil.size();
+		numIndices += 3 * ((int)sdi.stencil.size() - 2);
+	}
+	if (numVerts == 0) return;
+
+	GLsizeiptr vertBytes = numVerts * sizeof(glm::vec2);
+	StreamAllocation a = p_streamBuffer->allocate(vertBytes + numIndices * sizeof(GLuint), sizeof(glm::vec2));
+	glm::vec2* verts = (glm::vec2*)a.ptr;
+	GLuint* indices = (GLuint*)(a.ptr + vertBytes);
+	for (StencilDrawInfo& sdi : stencilDrawInfos) {
+		if (sdi.stencil.size() < 3) continue;
+		for (glm::vec2& v : sdi.stencil) *verts++ = v;
+		for (GLuint i = 0; i < sdi.stencil.size() - 2; i++) {
+			*indices++ = 0;
+			*indices++ = i + 1;
+			*indices++ = i + 2;
+		}
+	}
+	p_streamBuffer->commit(a);
 
-	p_shaderManager->stencilShader.use();
+	p_streamBuffer->bind();
 	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
 	glEnableVertexAttribArray(0);
+	p_shaderManager->stencilShader.use();
 
-	for (int i = 0; i < stencilDrawInfos.size(); i++) {
-		drawStencil(stencilDrawInfos[i].stencil, stencilDrawInfos[i].stencilVal, stencilDrawInfos[i].stencilColor);
-	}
-}
-
-void Scene::drawStencil(std::vector<glm::vec2>& stencilFrustum, int stencilVal, glm::vec3 color) {
-	glStencilFunc(GL_ALWAYS, stencilVal, 0xFF);
-
-	GLuint inColorID = glGetUniformLocation(p_shaderManager->stencilShader.ID, "inColor");
-	glUniform3f(inColorID, color.r, color.g, color.b);
+	int firstVert = 0, firstIndex = 0;
+	for (StencilDrawInfo& sdi : stencilDrawInfos) {
+		if (sdi.stencil.size() < 3) continue;
+		int count = 3 * ((int)sdi.stencil.size() - 2);
 
-	std::vector<GLfloat> stencilVerts;
-	for (glm::vec2& vec : stencilFrustum) {
-		stencilVerts.push_back(vec.x);
-		stencilVerts.push_back(vec.y);
-	}
-	glBufferData(GL_ARRAY_BUFFER, stencilVerts.size() * sizeof(GLfloat), stencilVerts.data(), GL_DYNAMIC_DRAW);
+		glStencilFunc(GL_ALWAYS, sdi.stencilVal, 0xFF);
+		p_shaderManager->stencilUniforms.inColor.set(sdi.stencilColor);
+		glDrawElementsBaseVertex(GL_TRIANGLES, count, GL_UNSIGNED_INT,
+								 (void*)(a.offset + vertBytes + firstIndex * sizeof(GLuint)), a.baseVertex() + firstVert);
 
-	std::vector<GLsizei> indices;
-	for (int i = 0; i < stencilFrustum.size() - 2; i++) {
-		indices.push_back(0);
-		indices.push_back(i + 1);
-		indices.push_back(i + 2);
+		firstVert += (int)sdi.stencil.size();
+		firstIndex += count;
 	}
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * indices.size(), indices.data(), GL_DYNAMIC_DRAW);
-	glDrawElements(GL_TRIANGLES, (GLsizei)indices.size(), GL_UNSIGNED_INT, 0);
+	glBindVertexArray(0);
 }
 
 void Scene::drawPortalViews() {
@@ -1,6 +1,5 @@
 #pragma once
 #include<iostream>
-#include <Windows.h>
 #include <algorithm>
 
 #include"dependancyHeaders.h"
@@ -13,6 +12,8 @@
 #include"cameraManager.h"
 #include"makeShapes.h"
 #include"portal.h"
+#include"portalVisibilityGraph.h"
+#include"polygonClip.h"
 
 struct PortalPosts {
 	glm::vec2 postA, postB;
@@ -27,6 +28,7 @@ struct PortalReference {
 	int test;
 	int maxSeenPortals;
 	int stencilVal;
+	int node = -1; // in Scene::portalGraph, -1 for the camera's own view.
 
 	PortalReference(int identity = 1) {
 		transf = glm::mat4(1);
@@ -75,13 +77,19 @@ struct Scene {
 	GLFWwindow* p_window;
 	PortalManager* p_portalManager;
 	ShaderManager* p_shaderManager;
+	StreamBuffer* p_streamBuffer;
 	std::vector<PortalViewDrawInfo> portalViewDrawInfos;
 	std::vector<StencilDrawInfo> stencilDrawInfos;
+
+	PortalVisibilityGraph portalGraph;
+	// One per recursion depth, kept so the stencil vectors keep their capacity between frames:
+	std::vector<PortalReference> portalReferenceScratch[MAX_SEEN_PORTALS];
+	// Each candidate's posts and stencil, for the level being filled.  The level is done with them before it recurses:
+	std::vector<vechelp::InlinePoly> postsClipScratch, stencilClipScratch;
 	
 	// OpenGL stuff:
 	glm::ivec2 sceneSize;
 	GLuint VAO, VBO, EBO;
-	GLuint stencilVAO, stencilVBO, stencilEBO;
 	GLuint sceneTexture;
 	GLuint sceneRBO;
 	GLuint sceneFBO;
@@ -90,15 +98,12 @@ struct Scene {
 
 	int frameStencilVal;
 
-	Scene(Camera* c, PortalManager* pm, ShaderManager* sm);
+	Scene(Camera* c, PortalManager* pm, ShaderManager* sm, StreamBuffer* sb);
 
 	~Scene() {
 		glDeleteVertexArrays(1, &VAO);
 		glDeleteBuffers(1, &VBO);
 		glDeleteBuffers(1, &EBO);
-		glDeleteVertexArrays(1, &stencilVAO);
-		glDeleteBuffers(1, &stencilVBO);
-		glDeleteBuffers(1, &stencilEBO);
 		glDeleteFramebuffers(1, &sceneFBO);
 		glDeleteRenderbuffers(1, &sceneRBO);
 		glDeleteTextures(1, &sceneTexture);
@@ -109,7 +114,12 @@ struct Scene {
 		frameStencilVal = 1;
 		portalViewDrawInfos.clear();
 		stencilDrawInfos.clear();
-		fillPortalViewDrawInfos(nullptr, PortalReference(1), 0, 1.0f);
+
+		glm::vec2 camPos(p_camera->viewPlanePos.x, -p_camera->viewPlanePos.y);
+		if (portalGraph.isStale(camPos, p_portalManager->portalsVersion)) {
+			portalGraph.build(p_portalManager->portalPairs, camPos, MAX_SEEN_PORTALS, p_portalManager->portalsVersion);
+		}
+		fillPortalViewDrawInfos(PortalReference(1), 0, 1.0f);
 	}
 
 	// Because the portals have to be drawn recursively, each draw call will have a transformaiton matrix
@@ -117,14 +127,18 @@ struct Scene {
 	// be used to clip the drawn scene to it is only rendered inside the last portals frustum.  For a first pass,
 	// the portalTransf will have to be the identity matrix and the frustum will have to be the entire window!
 	// There are instances where there can be an infiniete amount of scenes drawn, so a maximum depth must be
-	// defined as recursionDepth.
-	void fillPortalViewDrawInfos(Portal* skipThisOne, PortalReference parentPr, int recursionDepth, float totalZoom);
-	bool createPortalReference(PortalReference* pr, PortalReference parentPr);
+	// defined as recursionDepth.  Which portals to try at each step comes from portalGraph.
+	void fillPortalViewDrawInfos(const PortalReference& parentPr, int recursionDepth, float totalZoom);
+	// Puts pr's (pr->node's portal's) posts and unclipped stencil, as seen through parentPr, into posts and stencil:
+	void preparePortalReference(PortalReference* pr, const PortalReference& parentPr,
+								vechelp::InlinePoly& posts, vechelp::InlinePoly& stencil);
+	// Once posts and stencil are cropped to parentPr's stencil, keeps the stencil and works out the tint.
+	// False if the portal can't be seen after all:
+	bool createPortalReference(PortalReference* pr, const PortalReference& parentPr,
+							   const vechelp::InlinePoly& posts, vechelp::InlinePoly& stencil);
 	void drawScenePiece(PortalViewDrawInfo pvdi);
 	void drawPortalViews();
-	// Draws an individual portal stencil:
-	void drawStencil(std::vector<glm::vec2>& stencilFrustum, int stencilVal, glm::vec3 color);
-	// Draws each portal stencil held in the stencilDrawInfos vector:
+	// Draws each portal stencil held in the stencilDrawInfos vector, all from one stream buffer allocation:
 	void drawPortalStencils();
 
 	void draw();
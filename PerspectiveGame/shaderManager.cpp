@@ -1,114 +1,201 @@
 #include "shaderManager.h"
+#include <filesystem>
+#include <algorithm>
 
-void Program::init(const char* vertexPath, const char* fragmentPath) {
-	// 1. retrieve the vertex/fragment source code from filePath
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	// ensure ifstream objects can throw exceptions:
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try {
-		vShaderFile.open(vertexPath);
-		fShaderFile.open(fragmentPath);
-		std::stringstream vShaderStream, fShaderStream;
-		// read files buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		fShaderStream << fShaderFile.rdbuf();
-		vShaderFile.close();
-		fShaderFile.close();
-
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
-	}
-	catch (std::ifstream::failure error) {
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+int Program::numLoadedFromCache = 0;
+int Program::numCompiled = 0;
+
+// #include "generated/..." files come from the C++ side instead of disk, so tables both sides use have one source:
+static bool getGeneratedShaderFile(const std::string& name, std::string& out)
+{
+	if (name == "generated/tnavMaps.glsl") out = tnav::mapTablesGlsl();
+	else return false;
+	return true;
+}
+
+// Reads the file at path into out, pasting in #include "..." files as it goes.  Every file gets an index
+// (its place in files) that #line directives use, so compile errors of the form "3(42)" mean line 42 of files[3].
+static bool preprocessShaderFile(const std::string& path, std::string& out, std::vector<std::string>& files)
+{
+	int fileIndex = (int)files.size();
+	files.push_back(path);
+
+	std::ifstream file(path);
+	if (!file.is_open()) {
+		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ: " << path << std::endl;
+		return false;
 	}
-	const char* vShaderCode = vertexCode.c_str();
-	const char* fShaderCode = fragmentCode.c_str();
+	std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
 
-	// 2. compile shaders
-	unsigned int vertex, fragment;
-	int success;
-	char infoLog[512];
+	std::string line;
+	int lineNumber = 0;
+	while (std::getline(file, line)) {
+		lineNumber++;
+		size_t start = line.find_first_not_of(" \t");
+		if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+			out += line;
+			out += '\n';
+			continue;
+		}
 
-	vertex = glCreateShader(GL_VERTEX_SHADER);
-	glShaderSource(vertex, 1, &vShaderCode, NULL);
-	glCompileShader(vertex);
+		size_t open = line.find('"', start);
+		size_t close = line.find('"', open + 1);
+		if (open == std::string::npos || close == std::string::npos) {
+			std::cout << "ERROR::SHADER::BAD_INCLUDE: " << path << "(" << lineNumber << ")" << std::endl;
+			return false;
+		}
+		std::string includeName = line.substr(open + 1, close - open - 1);
+		std::string generated;
+		bool isGenerated = getGeneratedShaderFile(includeName, generated);
+		std::string includePath = isGenerated ? includeName : directory + includeName;
+		if (std::find(files.begin(), files.end(), includePath) != files.end()) {
+			out += '\n'; // already pasted in somewhere.
+			continue;
+		}
+		out += "#line 1 " + std::to_string(files.size()) + "\n";
+		if (isGenerated) {
+			files.push_back(includePath);
+			out += generated;
+		}
+		else if (!preprocessShaderFile(includePath, out, files)) return false;
+		out += "#line " + std::to_string(lineNumber + 1) + " " + std::to_string(fileIndex) + "\n";
+	}
+	return true;
+}
 
-	fragment = glCreateShader(GL_FRAGMENT_SHADER);
-	glShaderSource(fragment, 1, &fShaderCode, NULL);
-	glCompileShader(fragment);
+// Full source for one stage: includes resolved and defines slotted in after #version.
+static bool preprocessShader(const char* path, const std::vector<std::string>& defines, std::string& out)
+{
+	std::vector<std::string> files;
+	std::string source;
+	if (!preprocessShaderFile(path, source, files)) return false;
 
-	// Print compile errors if any:
-	glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-	if (!success)
-	{
-		glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" <<
-			infoLog << std::endl;
-	};
-	glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
-	if (!success) {
-		glGetShaderInfoLog(fragment, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+	size_t afterVersion = 0;
+	if (source.compare(0, 8, "#version") == 0) {
+		afterVersion = source.find('\n') + 1;
+	}
+	std::string defineBlock;
+	for (const std::string& d : defines) {
+		defineBlock += "#define " + d + "\n";
 	}
+	if (!defineBlock.empty()) defineBlock += afterVersion == 0 ? "#line 1 0\n" : "#line 2 0\n";
 
-	ID = glCreateProgram();
-	glAttachShader(ID, vertex);
-	glAttachShader(ID, fragment);
-	glLinkProgram(ID);
-	// Print linking errors if any:
-	glGetProgramiv(ID, GL_LINK_STATUS, &success);
-	if (!success) {
-		glGetProgramInfoLog(ID, 512, NULL, infoLog);
-		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" <<
-			infoLog << std::endl;
+	out = source.substr(0, afterVersion) + defineBlock + source.substr(afterVersion);
+	return true;
+}
+
+static void printShaderFiles(const char* path)
+{
+	std::vector<std::string> files;
+	std::string unused;
+	preprocessShaderFile(path, unused, files);
+	for (int i = 0; i < files.size(); i++) {
+		std::cout << "  " << i << ": " << files[i] << std::endl;
 	}
-	// Delete the shaders as theyre linked into the program and no longer necessary:
-	glDeleteShader(vertex);
-	glDeleteShader(fragment);
 }
 
-void Program::init2d3rdPersonPov() {
-	// 1. retrieve the vertex/fragment source code from filePath
-	std::string vertexCode;
-	std::string fragmentCode;
-	std::ifstream vShaderFile;
-	std::ifstream fShaderFile;
-	std::ifstream fShaderFile2;
-	// ensure ifstream objects can throw exceptions:
-	vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-	try {
-		vShaderFile.open("shaders/2d3rdPersonPov.vert");
-		std::stringstream vShaderStream, fShaderStream;
-		// read files buffer contents into streams
-		vShaderStream << vShaderFile.rdbuf();
-		vShaderFile.close();
+// FNV-1a, only used to name cache files.
+static unsigned long long hashString(const std::string& s, unsigned long long hash = 14695981039346656037ull)
+{
+	for (unsigned char c : s) {
+		hash ^= c;
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
 
-		
+static bool programBinariesSupported()
+{
+	if (!GLAD_GL_VERSION_4_1 || glGetProgramBinary == nullptr) return false;
+	GLint numFormats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+	return numFormats > 0;
+}
 
-		fShaderFile.open("shaders/2d3rdPersonPovHeader.frag");
-		fShaderStream << fShaderFile.rdbuf();
-		fShaderFile.close();
+static std::string getProgramCachePath(const std::string& vertexCode, const std::string& fragmentCode)
+{
+	// A driver update makes old binaries useless, so it's part of the key:
+	std::string driver = std::string((const char*)glGetString(GL_VENDOR)) + "|"
+		+ (const char*)glGetString(GL_RENDERER) + "|"
+		+ (const char*)glGetString(GL_VERSION);
+	unsigned long long key = hashString(driver, hashString(fragmentCode, hashString(vertexCode)));
+
+	std::stringstream name;
+	name << SHADER_CACHE_DIRECTORY << std::hex << key << ".bin";
+	return name.str();
+}
 
-		fShaderFile2.open("shaders/2d3rdPersonPovBody.frag");
-		fShaderStream << fShaderFile2.rdbuf();
-		fShaderFile2.close();
+// Returns 0 if there was nothing usable cached.
+static GLuint loadProgramBinary(const std::string& cachePath)
+{
+	std::ifstream file(cachePath, std::ios::binary);
+	if (!file.is_open()) return 0;
 
-		vertexCode = vShaderStream.str();
-		fragmentCode = fShaderStream.str();
+	GLenum format;
+	if (!file.read((char*)&format, sizeof(format))) return 0;
+	std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	if (binary.empty()) return 0;
 
+	GLuint ID = glCreateProgram();
+	glProgramBinary(ID, format, binary.data(), (GLsizei)binary.size());
+	GLint success;
+	glGetProgramiv(ID, GL_LINK_STATUS, &success);
+	if (!success) { // driver rejected it, just recompile.
+		glDeleteProgram(ID);
+		return 0;
+	}
+	return ID;
+}
+
+static void saveProgramBinary(GLuint ID, const std::string& cachePath)
+{
+	GLint length = 0;
+	glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) return;
+
+	std::vector<char> binary(length);
+	GLenum format;
+	glGetProgramBinary(ID, length, nullptr, &format, binary.data());
+
+	std::error_code error;
+	std::filesystem::create_directories(SHADER_CACHE_DIRECTORY, error);
+	std::ofstream file(cachePath, std::ios::binary);
+	if (!file.is_open()) {
+		std::cout << "ERROR::SHADER::COULD_NOT_WRITE_CACHE: " << cachePath << std::endl;
+		return;
 	}
-	catch (std::ifstream::failure error) {
-		std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+	file.write((const char*)&format, sizeof(format));
+	file.write(binary.data(), binary.size());
+}
+
+void Program::init(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines) {
+	// 1. retrieve the vertex/fragment source code from filePath, resolving includes and defines:
+	std::string vertexCode;
+	std::string fragmentCode;
+	if (!preprocessShader(vertexPath, defines, vertexCode) ||
+		!preprocessShader(fragmentPath, defines, fragmentCode)) {
+		return;
 	}
+
+	source = vertexCode + fragmentCode;
+
+	// 2. try the cache:
+	bool useCache = programBinariesSupported();
+	std::string cachePath;
+	if (useCache) {
+		cachePath = getProgramCachePath(vertexCode, fragmentCode);
+		ID = loadProgramBinary(cachePath);
+		if (ID != 0) {
+			numLoadedFromCache++;
+			reflect();
+			return;
+		}
+	}
+
 	const char* vShaderCode = vertexCode.c_str();
 	const char* fShaderCode = fragmentCode.c_str();
 
-	// 2. compile shaders
+	// 3. compile shaders
 	unsigned int vertex, fragment;
 	int success;
 	char infoLog[512];
@@ -123,20 +210,24 @@ void Program::init2d3rdPersonPov() {
 
 	// Print compile errors if any:
 	glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
-	if (!success) {
+	if (!success)
+	{
 		glGetShaderInfoLog(vertex, 512, NULL, infoLog);
 		std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" <<
 			infoLog << std::endl;
+		printShaderFiles(vertexPath);
 	};
 	glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);
 	if (!success) {
 		glGetShaderInfoLog(fragment, 512, NULL, infoLog);
 		std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
+		printShaderFiles(fragmentPath);
 	}
 
 	ID = glCreateProgram();
 	glAttachShader(ID, vertex);
 	glAttachShader(ID, fragment);
+	if (useCache) glProgramParameteri(ID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
 	glLinkProgram(ID);
 	// Print linking errors if any:
 	glGetProgramiv(ID, GL_LINK_STATUS, &success);
@@ -145,7 +236,54 @@ void Program::init2d3rdPersonPov() {
 		std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" <<
 			infoLog << std::endl;
 	}
-	// Delete the shaders as theyre linked into the program and no longer necessary:
+	else if (useCache) {
+		saveProgramBinary(ID, cachePath);
+	}
+	numCompiled++;
+
+	// Delete the shaders as they're linked into the program and no longer necessary:
 	glDeleteShader(vertex);
 	glDeleteShader(fragment);
-}
\ No newline at end of file
+
+	reflect();
+}
+
+void Program::reflect() {
+	uniforms.clear();
+	uniformBlocks.clear();
+	storageBlocks.clear();
+
+	GLint count = 0, maxNameLength = 0;
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+	std::vector<char> name(std::max(maxNameLength, 1));
+	for (GLint i = 0; i < count; i++) {
+		GLint size;
+		GLenum type;
+		glGetActiveUniform(ID, i, (GLsizei)name.size(), nullptr, &size, &type, name.data());
+		GLint location = glGetUniformLocation(ID, name.data());
+		if (location == -1) continue; // part of a block, not set directly.
+
+		std::string n = name.data();
+		if (n.size() > 3 && n.compare(n.size() - 3, 3, "[0]") == 0) n.resize(n.size() - 3); // arrays
+		uniforms.push_back({ n, location, type });
+	}
+
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCKS, &count);
+	glGetProgramiv(ID, GL_ACTIVE_UNIFORM_BLOCK_MAX_NAME_LENGTH, &maxNameLength);
+	name.resize(std::max(maxNameLength, 1));
+	for (GLint i = 0; i < count; i++) {
+		glGetActiveUniformBlockName(ID, i, (GLsizei)name.size(), nullptr, name.data());
+		uniformBlocks.push_back(name.data());
+	}
+
+	if (GLAD_GL_VERSION_4_3) { // ssbos need the program interface queries.
+		glGetProgramInterfaceiv(ID, GL_SHADER_STORAGE_BLOCK, GL_ACTIVE_RESOURCES, &count);
+		glGetProgramInterfaceiv(ID, GL_SHADER_STORAGE_BLOCK, GL_MAX_NAME_LENGTH, &maxNameLength);
+		name.resize(std::max(maxNameLength, 1));
+		for (GLint i = 0; i < count; i++) {
+			glGetProgramResourceName(ID, GL_SHADER_STORAGE_BLOCK, i, (GLsizei)name.size(), nullptr, name.data());
+			storageBlocks.push_back(name.data());
+		}
+	}
+}
@@ -5,26 +5,116 @@
 #include <fstream>
 #include <sstream>
 #include"dependancyHeaders.h"
+#include "stepHistogram.h"
+#include "tileLod.h"
+#include "tileNavigation.h"
+
+// Handle to one uniform of a program, looked up once after linking so drawing never touches uniform names.
+// A location of -1 (uniform optimized out) makes set() a no-op, same as in gl.
+template <typename T>
+struct Uniform {
+	GLint location = -1;
+
+	void set(const T& value) const;
+};
+template <> inline void Uniform<int>::set(const int& v) const { glUniform1i(location, v); }
+template <> inline void Uniform<float>::set(const float& v) const { glUniform1f(location, v); }
+template <> inline void Uniform<glm::vec2>::set(const glm::vec2& v) const { glUniform2f(location, v.x, v.y); }
+template <> inline void Uniform<glm::vec3>::set(const glm::vec3& v) const { glUniform3f(location, v.x, v.y, v.z); }
+template <> inline void Uniform<glm::mat4>::set(const glm::mat4& v) const { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(v)); }
+
+// The gl types a Uniform<T> is allowed to point at, for the debug check in Program::getUniform():
+template <typename T> inline bool uniformTypeMatches(GLenum type);
+template <> inline bool uniformTypeMatches<int>(GLenum type) { return type == GL_INT || type == GL_BOOL || type == GL_SAMPLER_2D; }
+template <> inline bool uniformTypeMatches<float>(GLenum type) { return type == GL_FLOAT; }
+template <> inline bool uniformTypeMatches<glm::vec2>(GLenum type) { return type == GL_FLOAT_VEC2; }
+template <> inline bool uniformTypeMatches<glm::vec3>(GLenum type) { return type == GL_FLOAT_VEC3; }
+template <> inline bool uniformTypeMatches<glm::mat4>(GLenum type) { return type == GL_FLOAT_MAT4; }
+
+// Linked programs get saved here (keyed on their preprocessed source and the driver) so later launches can skip compiling:
+#define SHADER_CACHE_DIRECTORY "shaderCache/"
 
 struct Program {
 	GLuint ID;
 
+	// Stats over all programs:
+	static int numLoadedFromCache;
+	static int numCompiled;
+
 	// constructor reads and builds the shader
 	Program() : ID(0) {}
-	Program(const char* vertexPath, const char* fragmentPath) {
-		init(vertexPath, fragmentPath);
+	Program(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = {}) {
+		init(vertexPath, fragmentPath, defines);
 	}
-	void init(const char* vertexPath, const char* fragmentPath);
+	// Shader files can #include "other.glsl" (relative to themselves, each file pasted in at most once).
+	// "generated/..." includes are made on the C++ side, see getGeneratedShaderFile() in shaderManager.cpp.
+	// defines are put in right after #version, e.g. { "PEEK_OBSTRUCTION_MAPS", "MAX_STEPS 250" }, for cheap variants.
+	void init(const char* vertexPath, const char* fragmentPath, const std::vector<std::string>& defines = {});
+
+	// Everything active in the program, filled in by reflect() right after linking (or loading from the cache):
+	struct UniformInfo {
+		std::string name;
+		GLint location;
+		GLenum type;
+	};
+	std::vector<UniformInfo> uniforms;
+	std::vector<std::string> uniformBlocks;
+	std::vector<std::string> storageBlocks;
 
-	void init2d3rdPersonPov();
+	// Preprocessed source, kept around so the debug checks can tell a misspelled name from an optimized out one:
+	std::string source;
 
 	// use/activate the shader
 	void use() { glUseProgram(ID); }
 
+	// Call these once at startup and keep the handle, not every frame.
+	template <typename T>
+	Uniform<T> getUniform(const char* name)
+	{
+		Uniform<T> handle;
+		for (const UniformInfo& u : uniforms) {
+			if (u.name != name) continue;
+			handle.location = u.location;
+#ifndef NDEBUG
+			if (!uniformTypeMatches<T>(u.type)) {
+				std::cout << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH: " << name << std::endl;
+			}
+#endif
+			return handle;
+		}
+#ifndef NDEBUG
+		checkNameExists(name, "UNKNOWN_UNIFORM");
+#endif
+		return handle;
+	}
+
+	// Debug check only, the binding points themselves come from layout(binding = ...) in the shaders.
+	bool hasStorageBlock(const char* name)
+	{
+		for (const std::string& b : storageBlocks) {
+			if (b == name) return true;
+		}
+#ifndef NDEBUG
+		checkNameExists(name, "UNKNOWN_STORAGE_BLOCK");
+#endif
+		return false;
+	}
+
 	// utility uniform functions
 	void setUniformIndex(const std::string& name, int value) const {
 		glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
 	}
+
+private:
+	void reflect();
+
+	// Not active could just mean the compiler threw it out, which is fine.  Not in the source at all is a typo.
+	void checkNameExists(const char* name, const char* error)
+	{
+		if (source.find(name) == std::string::npos) {
+			std::cout << "ERROR::SHADER::" << error << ": " << name << std::endl;
+		}
+	}
 };
 
 struct ShaderManager {
@@ -38,6 +128,32 @@ struct ShaderManager {
 
 	Program POV2D3rdPersonViaNodeNetwork;
 	Program POV3D3rdPersonNodeNetwork;
+	Program entityInstances;
+
+	// Handles for everything set per frame, grouped by program:
+	struct {
+		Uniform<glm::vec3> inColor;
+	} stencilUniforms;
+	struct {
+		Uniform<glm::mat4> inTransfMatrix;
+		Uniform<float> inAlpha;
+		Uniform<float> inColorAlpha;
+	} simpleUniforms, POV3D3rdPersonUniforms;
+	struct {
+		Uniform<float> deltaTime;
+		Uniform<float> updateProgress;
+		Uniform<int> initialTileIndex;
+		Uniform<int> initialMapIndex;
+		Uniform<glm::mat4> inWindowToWorldSpace;
+		Uniform<int> debugRenderMode;
+		Uniform<int> collectStepHistogram;
+		Uniform<float> pixelWorldSize;
+		Uniform<int> drawEntities;
+	} POV2D3rdPersonViaNodeNetworkUniforms;
+	struct {
+		Uniform<glm::mat4> inWorldToWindowSpace;
+		Uniform<float> updateProgress;
+	} entityInstancesUniforms;
 
 	std::vector<GLuint> texIDs;
 
@@ -46,11 +162,44 @@ struct ShaderManager {
 		stencilShader.init("shaders/stencil.vert", "shaders/stencil.frag");
 		simpleShader.init("shaders/simple.vert", "shaders/simple.frag");
 		justVertsAndColors.init("shaders/passthrough.vert", "shaders/empty.frag");
-		POV2D3rdPerson.init2d3rdPersonPov();
+		POV2D3rdPerson.init("shaders/2D3rdPersonPOV.vert", "shaders/2d3rdPersonPov.frag", { "PEEK_OBSTRUCTION_MAPS" });
 		POV3D3rdPerson.init("shaders/3D3rdPersonPOV.vert", "shaders/3D3rdPersonPOV.frag");
 		
-		POV2D3rdPersonViaNodeNetwork.init("shaders/2d3rdPersonPovViaNodeNetwork.vert", "shaders/2d3rdPersonPovViaNodeNetwork.frag");
+		POV2D3rdPersonViaNodeNetwork.init("shaders/2d3rdPersonPovViaNodeNetwork.vert", "shaders/2d3rdPersonPovViaNodeNetwork.frag",
+										  { "MAX_STEPS " + std::to_string(MAX_NODE_NETWORK_RAY_STEPS),
+											"NUM_STEP_HISTOGRAM_BUCKETS " + std::to_string(NUM_STEP_HISTOGRAM_BUCKETS),
+											"NUM_TILE_JUMP_LEVELS " + std::to_string(NUM_TILE_JUMP_LEVELS) });
+		entityInstances.init("shaders/entityInstance.vert", "shaders/entityInstance.frag");
 		//POV3D3rdPersonNodeNetwork.init("shaders/3D3rdPersonPOVNodeNetwork.vert", "shaders/3D3rdPersonPOVNodeNetwork.frag");
+
+		stencilUniforms.inColor = stencilShader.getUniform<glm::vec3>("inColor");
+
+		simpleUniforms.inTransfMatrix = simpleShader.getUniform<glm::mat4>("inTransfMatrix");
+		simpleUniforms.inAlpha = simpleShader.getUniform<float>("inAlpha");
+		simpleUniforms.inColorAlpha = simpleShader.getUniform<float>("inColorAlpha");
+
+		POV3D3rdPersonUniforms.inTransfMatrix = POV3D3rdPerson.getUniform<glm::mat4>("inTransfMatrix");
+		POV3D3rdPersonUniforms.inAlpha = POV3D3rdPerson.getUniform<float>("inAlpha");
+		POV3D3rdPersonUniforms.inColorAlpha = POV3D3rdPerson.getUniform<float>("inColorAlpha");
+
+		Program& p = POV2D3rdPersonViaNodeNetwork;
+		POV2D3rdPersonViaNodeNetworkUniforms.deltaTime = p.getUniform<float>("deltaTime");
+		POV2D3rdPersonViaNodeNetworkUniforms.updateProgress = p.getUniform<float>("updateProgress");
+		POV2D3rdPersonViaNodeNetworkUniforms.initialTileIndex = p.getUniform<int>("initialTileIndex");
+		POV2D3rdPersonViaNodeNetworkUniforms.initialMapIndex = p.getUniform<int>("initialMapIndex");
+		POV2D3rdPersonViaNodeNetworkUniforms.inWindowToWorldSpace = p.getUniform<glm::mat4>("inWindowToWorldSpace");
+		POV2D3rdPersonViaNodeNetworkUniforms.debugRenderMode = p.getUniform<int>("debugRenderMode");
+		POV2D3rdPersonViaNodeNetworkUniforms.collectStepHistogram = p.getUniform<int>("collectStepHistogram");
+		POV2D3rdPersonViaNodeNetworkUniforms.pixelWorldSize = p.getUniform<float>("pixelWorldSize");
+		POV2D3rdPersonViaNodeNetworkUniforms.drawEntities = p.getUniform<int>("drawEntities");
+		p.hasStorageBlock("tilesBuffer");
+		p.hasStorageBlock("entityQuadsBuffer");
+		p.hasStorageBlock("tileEntityQuadRangesBuffer");
+		p.hasStorageBlock("stepHistogramBuffer");
+		p.hasStorageBlock("tileLodsBuffer");
+
+		entityInstancesUniforms.inWorldToWindowSpace = entityInstances.getUniform<glm::mat4>("inWorldToWindowSpace");
+		entityInstancesUniforms.updateProgress = entityInstances.getUniform<float>("updateProgress");
 	}
 
 	~ShaderManager() {
@@ -59,5 +208,6 @@ struct ShaderManager {
 		glDeleteProgram(simpleShader.ID);
 		glDeleteProgram(justVertsAndColors.ID);
 		glDeleteProgram(POV2D3rdPerson.ID);
+		glDeleteProgram(entityInstances.ID);
 	}
 };
\ No newline at end of file
@@ -0,0 +1,5 @@
+#version 430 core // We need 430 for SSBOs.
+
+// Built with PEEK_OBSTRUCTION_MAPS defined, see ShaderManager::init().
+#include "2d3rdPersonPovHeader.frag"
+#include "2d3rdPersonPovBody.frag"
@@ -1,11 +1,6 @@
-#version 430 core // We need 430 for SSBOs.
+// Included by 2d3rdPersonPov.frag.
 
-#define PEEK_OBSTRUCTION_MAPS
-
-#define PI 3.1415926535897932384626433832795
-
-#define TRUE  1
-#define FALSE 0
+#include "commonDefines.glsl"
 
 // Entity IDs:
 #define NONE 0
@@ -24,7 +19,9 @@
 #define BELT_END_FORWARD     3
 #define BELT_END_BACKWARD    4
 
+#ifndef MAX_STEPS
 #define MAX_STEPS 1000 // <- Protects against infinite loops.
+#endif
 
 // Lazy defines:
 #define CurrentTile tileInfos[currentTileIndex]
@@ -87,29 +84,7 @@ layout (std430, binding = 3) buffer entityTileInfosBuffer { EntityTileInfo entit
 
 
 
-// USEFUL FUNCTIONS NOT RELATED TO THIS SHADER IN PARTICULAR:
-
-float signedDistanceBox(vec2 point, vec2 box) {
-    vec2 d = abs(point) - box;
-    return length(max(d,0.0)) + min(max(d.x,d.y),0.0);
-}
-float pointToLineSegDist(vec2 A, vec2 B, vec2 E) {
-	vec2 AB = B - A;
-	vec2 AE = E - A;
-	vec2 BE = E - B;
-
-    if (dot(AB, BE) > 0) { 
-		return length(BE); 
-	}
-    else if (dot(AB, AE) < 0) {
-		return length(AE); 
-	}
-	return abs(AB.x * AE.y - AB.y * AE.x) / length(AB);
-}
-vec2 rotate(vec2 v, float angle) {
-    return mat2(cos(angle), -sin(angle), sin(angle), cos(angle)) * v;
-}
-vec4 rgb(float r, float g, float b) { return vec4(r/256,g/256,b/256,1); }
+#include "commonHelperFunctions.glsl"
 
 
 
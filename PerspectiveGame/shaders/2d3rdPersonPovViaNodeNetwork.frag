@@ -11,115 +11,91 @@ uniform sampler2D inTexture;
 //uniform mat4      inPovRelativePositions;
 uniform int initialTileIndex;
 uniform int initialMapIndex;
+uniform int debugRenderMode; // DEBUG_RENDER_MODE_* below.
+uniform int collectStepHistogram; // bool
+uniform float pixelWorldSize; // how many tiles wide one pixel is.
+uniform int drawEntities; // bool, off when they're drawn instanced on top instead (see entityInstance.vert).
 
+// Packed, see GPU_Tile in tile.h:
 struct Tile {
 	int neighborIndices[4];
-	int maps[4];
-
-	int entityPositions[4];
-	int entityDirections[4];
+	uint mapsAndTexOrientation; // 3 bits per map, then 3 bits of texture orientation.
+	uint color; // RGBA8
+};
 
-	vec2 texCoords[4];
-	
-	vec4 color;
-	int numEntities;
-	int padding[3];
+// See GPU_EntityQuad in tile.h, already in the coords of the tile it's listed under:
+struct EntityQuad {
+	vec2 pos;
+	vec2 offset; // moved by this much over a tick.
 };
 
 layout (std430, binding = 1) buffer tilesBuffer { Tile tiles[]; };
+layout (std430, binding = 2) buffer entityQuadsBuffer { EntityQuad entityQuads[]; };
+// (first quad, number of quads) overlapping tile i:
+layout (std430, binding = 3) buffer tileEntityQuadRangesBuffer { ivec2 tileEntityQuadRanges[]; };
+// Steps per pixel this frame, bucketed like StepHistogram in stepHistogram.h.  Slot NUM_STEP_HISTOGRAM_BUCKETS
+// counts rays that hit MAX_STEPS and the one after it is the total step count:
+layout (std430, binding = 4) buffer stepHistogramBuffer { uint stepHistogram[]; };
+
+#ifndef NUM_TILE_JUMP_LEVELS
+#define NUM_TILE_JUMP_LEVELS 5
+#endif
+
+// See GPU_TileLod in tileLod.h:
+struct TileLod {
+	int jumps[4 * NUM_TILE_JUMP_LEVELS]; // (tile index << 3) | map, for 2^k steps in local direction d.
+	int flatRadius;
+};
+
+layout (std430, binding = 5) buffer tileLodsBuffer { TileLod tileLods[]; };
 
 // GLOBAL VARIABLES:
 
-#define LOCAL_DIRECTION_0 0
-#define LOCAL_DIRECTION_1 1
-#define LOCAL_DIRECTION_2 2
-#define LOCAL_DIRECTION_3 3
-#define LOCAL_DIRECTION_0_1 4
-#define LOCAL_DIRECTION_1_0 4
-#define LOCAL_DIRECTION_1_2 5
-#define LOCAL_DIRECTION_2_1 5
-#define LOCAL_DIRECTION_2_3 6
-#define LOCAL_DIRECTION_3_2 6
-#define LOCAL_DIRECTION_3_0 7
-#define LOCAL_DIRECTION_0_3 7
-
-#define NUM_ORTHO_DIRS 4
-
-#define LOCAL_POSITION_CENTER 8
-
-const int ORTHOGONAL_DIRECTION_SET[4] = { 
-	LOCAL_DIRECTION_0,
-	LOCAL_DIRECTION_1,
-	LOCAL_DIRECTION_2,
-	LOCAL_DIRECTION_3,
-};
+#include "commonDefines.glsl"
 
-const vec2 LOCAL_POS_TO_COORD[9] = {
-	vec2(1.0f, 0.5f),
-	vec2(0.5f, 0.0f),
-	vec2(0.0f, 0.5f),
-	vec2(0.5f, 1.0f),
-	vec2(1.0f, 0.0f),
-	vec2(0.0f, 0.0f),
-	vec2(0.0f, 1.0f),
-	vec2(1.0f, 1.0f),
-	vec2(0.5f, 0.5f), // center
-};
+#ifndef MAX_STEPS
+#define MAX_STEPS 500 // normally set from MAX_NODE_NETWORK_RAY_STEPS in stepHistogram.h.
+#endif
+#ifndef NUM_STEP_HISTOGRAM_BUCKETS
+#define NUM_STEP_HISTOGRAM_BUCKETS 32
+#endif
 
-const vec2 LOCAL_DIR_TO_VEC[9] = {
-	vec2(1.0f, 0.0f),
-	vec2(0.0f, -1.0f),
-	vec2(-1.0f, 0.0f),
-	vec2(0.0f, 1.0f),
-	vec2(1.0f, -1.0f),
-	vec2(-1.0f, -1.0f),
-	vec2(-1.0f, 1.0f),
-	vec2(1.0f, 1.0f),
-	vec2(0.0f, 0.0f), // static
-};
+#define MIN_JUMP_RADIUS 2 // below this single steps are just as quick.
 
-#define MAX_STEPS 500
+#define DEBUG_RENDER_MODE_NONE 0
+#define DEBUG_RENDER_MODE_STEP_HEATMAP 1
 
 int currentTileIndex = initialTileIndex;
 int currentMapIndex = initialMapIndex;
+int numSteps = 0; // how many tiles findTile() had to walk through.
 
 #define CurrentTile tiles[currentTileIndex]
 
+int getTileMap(int tileIndex, int d) {
+	return int((tiles[tileIndex].mapsAndTexOrientation >> (3 * d)) & 0x7u);
+}
+
+const vec2 DEFAULT_TEX_COORDS[4] = { vec2(1, 1), vec2(1, 0), vec2(0, 0), vec2(0, 1) };
+
+vec2 getTileTexCoord(int tileIndex, int i) {
+	int o = int(tiles[tileIndex].mapsAndTexOrientation >> 12) & 0x7;
+	return DEFAULT_TEX_COORDS[o < 4 ? (i + o) % 4 : (o - i) & 3];
+}
+
 vec2 localPixelPosition;
 const vec2  povToPixelPos = pixelWorldPos - povWorldPos;
 const float totalDist = length(povToPixelPos);
 
 // CONST FUNCTIONS:
 
-// MAP_DIRECTION[map index][direction to map]
-const int MAP_DIRECTION[8][8] = {
-	{ 0, 1, 2, 3, 4, 5, 6, 7 },
-	{ 1, 2, 3, 0, 5, 6, 7, 4 },
-	{ 2, 3, 0, 1, 6, 7, 4, 5 },
-	{ 3, 0, 1, 2, 7, 4, 5, 6 },
-	{ 0, 3, 2, 1, 7, 6, 5, 4 },
-	{ 1, 0, 3, 2, 4, 7, 6, 5 },
-	{ 2, 1, 0, 3, 5, 4, 7, 6 },
-	{ 3, 2, 1, 0, 6, 5, 4, 7 }
-};
+// MAP_DIRECTION, COMBINE_MAP_INDICES and INVERSE_MAP, the same tables tnav uses:
+#include "generated/tnavMaps.glsl"
 
 int getLocalEast()  { return MAP_DIRECTION[currentMapIndex][LOCAL_DIRECTION_0]; }
 int getLocalSouth() { return MAP_DIRECTION[currentMapIndex][LOCAL_DIRECTION_1]; }
 int getLocalWest()  { return MAP_DIRECTION[currentMapIndex][LOCAL_DIRECTION_2]; }
 int getLocalNorth() { return MAP_DIRECTION[currentMapIndex][LOCAL_DIRECTION_3]; }
 
-// ALIGNMENT_MAP_COMBINATIONS[initial mapping][next mapping]
-const int COMBINE_MAP_INDICES[8][8] = {
-	{ 0, 1, 2, 3, 4, 5, 6, 7 },
-	{ 1, 2, 3, 0, 7, 4, 5, 6 },
-	{ 2, 3, 0, 1, 6, 7, 4, 5 },
-	{ 3, 0, 1, 2, 5, 6, 7, 4 },
-	{ 4, 5, 6, 7, 0, 1, 2, 3 },
-	{ 5, 6, 7, 4, 3, 0, 1, 2 },
-	{ 6, 7, 4, 5, 2, 3, 0, 1 },
-	{ 7, 4, 5, 6, 1, 2, 3, 0 }
-};
-
 // FUNCTIONS
 
 // Returns the coordinates of the fragment local to its tile.
@@ -133,9 +109,9 @@ vec2 getPixelPos() {
 	int s = getLocalSouth(), w = getLocalWest(), n = getLocalNorth();
 	if (currentMapIndex > 3) { s = ++s % 4; w = ++w % 4; n = ++n % 4; }
 
-	vec2 southEastUV = CurrentTile.texCoords[s];
-	vec2 southWestUV = CurrentTile.texCoords[w];
-	vec2 northWestUV = CurrentTile.texCoords[n];
+	vec2 southEastUV = getTileTexCoord(currentTileIndex, s);
+	vec2 southWestUV = getTileTexCoord(currentTileIndex, w);
+	vec2 northWestUV = getTileTexCoord(currentTileIndex, n);
 
 	vec2 xDir = southEastUV - southWestUV;
 	vec2 yDir = northWestUV - southWestUV;
@@ -143,56 +119,56 @@ vec2 getPixelPos() {
 }
 
 bool colorPixelInsideEntity(vec2 pixelPos) {
-	for (int i = 0; i < CurrentTile.numEntities; i++) {
-		vec2 entityPos = LOCAL_POS_TO_COORD[CurrentTile.entityPositions[i]];
-		vec2 dir = LOCAL_DIR_TO_VEC[CurrentTile.entityDirections[i]] / 2.0f;
-		vec2 offset = dir * updateProgress;
-		entityPos += offset;
+	ivec2 range = tileEntityQuadRanges[currentTileIndex];
+	if (range.y == 0) return false; // nothing on or spilling into this tile.
 
+	int first = range.x;
+	int last = first + range.y;
+	for (int i = first; i < last; i++) {
+		vec2 entityPos = entityQuads[i].pos + entityQuads[i].offset * updateProgress;
 		if (abs(entityPos.x - pixelPos.x) < 0.5f && 
 			abs(entityPos.y - pixelPos.y) < 0.5f) {
 			gl_FragColor = vec4(0, 1, 0, 1);
 			return true;
 		}
 	}
-
-	for (int dir = LOCAL_DIRECTION_0; dir < NUM_ORTHO_DIRS; dir++) {
-		int ni = CurrentTile.neighborIndices[dir];
-		int mappedDir = MAP_DIRECTION[CurrentTile.maps[dir]][(dir + 2) % 4];
-		#define neighborTile tiles[ni]
-
-		if (neighborTile.numEntities != 1 || // only center-positioned tiles can spill over to neighbors
-			neighborTile.entityPositions[0] != LOCAL_POSITION_CENTER ||
-			neighborTile.entityDirections[0] != mappedDir) 
-				continue; 
-
-		vec2 entityPos = LOCAL_POS_TO_COORD[dir] + (LOCAL_DIR_TO_VEC[dir] / 2.0f);
-		entityPos -= (LOCAL_DIR_TO_VEC[dir] / 2.0f) * updateProgress;
-
-		if (abs(entityPos.x - pixelPos.x) < 0.5f && 
-			abs(entityPos.y - pixelPos.y) < 0.5f) {
-			gl_FragColor = vec4(0, 1, 0, 1);
-			return true;
-		}
-	}
-
 	return false;
 }
 
 void colorPixel() {
 	vec2 pixelPos = getPixelPos();
 
-	if (!colorPixelInsideEntity(pixelPos)) {
-		gl_FragColor = mix(texture(inTexture, pixelPos), CurrentTile.color, 0.5);
+	if (drawEntities == FALSE || !colorPixelInsideEntity(pixelPos)) {
+		// Once tiles get smaller than a pixel the higher mips stand in for the average over the tile:
+		float lod = log2(max(pixelWorldSize * float(textureSize(inTexture, 0).x), 1.0f));
+		gl_FragColor = mix(textureLod(inTexture, pixelPos, lod), unpackUnorm4x8(CurrentTile.color), 0.5);
 	}
 }
 
 // transitions currentTileIndex and currentMapIndex 1 tile over in the given direction (d).
 void shiftCurrentTile(int d) {
-	currentMapIndex = COMBINE_MAP_INDICES[currentMapIndex][CurrentTile.maps[d]];
+	currentMapIndex = COMBINE_MAP_INDICES[currentMapIndex][getTileMap(currentTileIndex, d)];
 	currentTileIndex = CurrentTile.neighborIndices[d];
 }
 
+// Walks n tiles in direction d (as in shiftCurrentTile()) with popcount(n) lookups.
+void jumpCurrentTile(int d, int n) {
+	for (int k = 0; n != 0; k++, n >>= 1) {
+		if ((n & 1) == 0) continue;
+		int jump = tileLods[currentTileIndex].jumps[MAP_DIRECTION[currentMapIndex][d] * NUM_TILE_JUMP_LEVELS + k];
+		currentMapIndex = COMBINE_MAP_INDICES[currentMapIndex][jump & 0x7];
+		currentTileIndex = jump >> 3;
+	}
+}
+
+// How many of the crossings at first, first + step, ... come before leaveDist (and don't overshoot the pixel), up to max:
+int crossingsBefore(float first, float stepDist, float leaveDist, int maxCrossings) {
+	if (!(first <= totalDist) || first >= leaveDist) return 0; // also catches the inf/nan of axis aligned rays.
+	int beforeLeaving = int(ceil((leaveDist - first) / stepDist));
+	int beforeArriving = int(floor((totalDist - first) / stepDist)) + 1;
+	return clamp(min(beforeLeaving, beforeArriving), 0, maxCrossings);
+}
+
 bool findTile() {
 	vec2 runningDist;
 	vec2 stepDist = totalDist / abs(povToPixelPos);
@@ -207,9 +183,31 @@ bool findTile() {
 	if (GO_WINDOW_NORTH) { runningDist.y = (1.0f - povWorldPos.y) * stepDist.y; } 
 	else { runningDist.y = povWorldPos.y * stepDist.y; }
 
+	const int X_DIR = GO_WINDOW_EAST ? LOCAL_DIRECTION_0 : LOCAL_DIRECTION_2;
+	const int Y_DIR = GO_WINDOW_NORTH ? LOCAL_DIRECTION_3 : LOCAL_DIRECTION_1;
+	// Crossings past this all land inside this pixel anyway, so there's no point walking them:
+	const float closeEnough = totalDist - 0.5f * pixelWorldSize;
+	bool arrived = false;
+
 	// Raycast:
-	while (stepCount++ < MAX_STEPS) {
-		if (runningDist.x > totalDist && runningDist.y > totalDist) { break; } // We have arrived!
+	while (stepCount < MAX_STEPS) {
+		stepCount++;
+		if (runningDist.x > closeEnough && runningDist.y > closeEnough) { arrived = true; break; } // We have arrived!
+
+		// Inside a flat patch the ray is just a line on a grid, so skip to where it leaves the patch:
+		int r = tileLods[currentTileIndex].flatRadius;
+		if (r >= MIN_JUMP_RADIUS) {
+			float leaveDist = min(runningDist.x + r * stepDist.x, runningDist.y + r * stepDist.y);
+			int nx = crossingsBefore(runningDist.x, stepDist.x, leaveDist, r);
+			int ny = crossingsBefore(runningDist.y, stepDist.y, leaveDist, r);
+			// Flat, so x steps then y steps ends up where the interleaved ones would:
+			jumpCurrentTile(X_DIR, nx);
+			jumpCurrentTile(Y_DIR, ny);
+			if (nx > 0) runningDist.x += nx * stepDist.x; // not 0 * inf for axis aligned rays.
+			if (ny > 0) runningDist.y += ny * stepDist.y;
+			stepCount += bitCount(nx) + bitCount(ny);
+			continue;
+		}
 
 		if (runningDist.x < runningDist.y) {
 			if (GO_WINDOW_EAST) { shiftCurrentTile(getLocalEast()); } 
@@ -222,7 +220,26 @@ bool findTile() {
 			runningDist.y += stepDist.y;
 		}
 	}
-	return stepCount < MAX_STEPS;
+	numSteps = min(stepCount, MAX_STEPS);
+	return arrived;
+}
+
+// Blue (free) -> green -> yellow -> red (MAX_STEPS).  Rays that gave up are magenta.
+vec4 stepHeatColor(bool foundTile) {
+	if (!foundTile) return vec4(1, 0, 1, 1);
+	float t = sqrt(float(numSteps) / float(MAX_STEPS)); // sqrt so the cheap end isn't all one color.
+	vec3 c = t < 0.5f ? mix(vec3(0, 0, 1), vec3(0, 1, 0), t * 2.0f)
+		: t < 0.75f ? mix(vec3(0, 1, 0), vec3(1, 1, 0), (t - 0.5f) * 4.0f)
+		: mix(vec3(1, 1, 0), vec3(1, 0, 0), (t - 0.75f) * 4.0f);
+	return vec4(c, 1);
+}
+
+void recordSteps(bool foundTile) {
+	if (collectStepHistogram == FALSE) return;
+	int bucket = foundTile ? min(numSteps * NUM_STEP_HISTOGRAM_BUCKETS / MAX_STEPS, NUM_STEP_HISTOGRAM_BUCKETS - 1)
+		: NUM_STEP_HISTOGRAM_BUCKETS;
+	atomicAdd(stepHistogram[bucket], 1u);
+	atomicAdd(stepHistogram[NUM_STEP_HISTOGRAM_BUCKETS + 1], uint(numSteps));
 }
 
 void main() {
@@ -231,6 +248,8 @@ void main() {
 		getFragDrawTilePos();
 		//getRelativeVertPositions();
 		colorPixel();
+		recordSteps(true);
+		if (debugRenderMode == DEBUG_RENDER_MODE_STEP_HEATMAP) gl_FragColor = stepHeatColor(true);
 		return;
 	}
 
@@ -243,4 +262,7 @@ void main() {
 	else {
 		gl_FragColor = vec4(0, 0, 0, 1);
 	}
+
+	recordSteps(foundTile);
+	if (debugRenderMode == DEBUG_RENDER_MODE_STEP_HEATMAP) gl_FragColor = stepHeatColor(foundTile);
 };
\ No newline at end of file
@@ -1,19 +1,55 @@
-#version 330 core
+// Defines/tables shared between shaders.  #include this, don't paste it.
+// Directions and positions match LocalDirection/LocalPosition in tileNavigation.h.
 
-layout(location = 0) in vec2 inVertPos;
+#define PI 3.1415926535897932384626433832795
 
-layout(location = 0) out vec2 fragWorldPos;
-layout(location = 1) out vec2 povPos;
-layout(location = 2) out mat4 povRelativePos;
+#define TRUE  1
+#define FALSE 0
 
-uniform mat4 inWindowToWorldSpace;
-uniform vec2 inPovPosWindowSpace;
+#define LOCAL_DIRECTION_0 0
+#define LOCAL_DIRECTION_1 1
+#define LOCAL_DIRECTION_2 2
+#define LOCAL_DIRECTION_3 3
+#define LOCAL_DIRECTION_0_1 4
+#define LOCAL_DIRECTION_1_0 4
+#define LOCAL_DIRECTION_1_2 5
+#define LOCAL_DIRECTION_2_1 5
+#define LOCAL_DIRECTION_2_3 6
+#define LOCAL_DIRECTION_3_2 6
+#define LOCAL_DIRECTION_3_0 7
+#define LOCAL_DIRECTION_0_3 7
 
-void main() {
-	gl_Position = vec4(inVertPos, 0, 1);
+#define NUM_ORTHO_DIRS 4
 
-	// y is inverted to translate from CPU side coords to OpenGL coords.
-	fragWorldPos = vec2(inWindowToWorldSpace * vec4(inVertPos.x, -inVertPos.y, 0, 1));
-	povPos = vec2(inWindowToWorldSpace * vec4(inPovPosWindowSpace, 0, 1));
-	//povRelativePos = inPovRelativePosWindowSpace;
-}
\ No newline at end of file
+#define LOCAL_POSITION_CENTER 8
+
+const int ORTHOGONAL_DIRECTION_SET[4] = { 
+	LOCAL_DIRECTION_0,
+	LOCAL_DIRECTION_1,
+	LOCAL_DIRECTION_2,
+	LOCAL_DIRECTION_3,
+};
+
+const vec2 LOCAL_POS_TO_COORD[9] = {
+	vec2(1.0f, 0.5f),
+	vec2(0.5f, 0.0f),
+	vec2(0.0f, 0.5f),
+	vec2(0.5f, 1.0f),
+	vec2(1.0f, 0.0f),
+	vec2(0.0f, 0.0f),
+	vec2(0.0f, 1.0f),
+	vec2(1.0f, 1.0f),
+	vec2(0.5f, 0.5f), // center
+};
+
+const vec2 LOCAL_DIR_TO_VEC[9] = {
+	vec2(1.0f, 0.0f),
+	vec2(0.0f, -1.0f),
+	vec2(-1.0f, 0.0f),
+	vec2(0.0f, 1.0f),
+	vec2(1.0f, -1.0f),
+	vec2(-1.0f, -1.0f),
+	vec2(-1.0f, 1.0f),
+	vec2(1.0f, 1.0f),
+	vec2(0.0f, 0.0f), // static
+};
@@ -1,19 +1,23 @@
-#version 330 core
+// Useful functions not related to any shader in particular.  #include this, don't paste it.
 
-layout(location = 0) in vec2 inVertPos;
+float signedDistanceBox(vec2 point, vec2 box) {
+    vec2 d = abs(point) - box;
+    return length(max(d,0.0)) + min(max(d.x,d.y),0.0);
+}
+float pointToLineSegDist(vec2 A, vec2 B, vec2 E) {
+	vec2 AB = B - A;
+	vec2 AE = E - A;
+	vec2 BE = E - B;
 
-layout(location = 0) out vec2 fragWorldPos;
-layout(location = 1) out vec2 povPos;
-layout(location = 2) out mat4 povRelativePos;
-
-uniform mat4 inWindowToWorldSpace;
-uniform vec2 inPovPosWindowSpace;
-
-void main() {
-	gl_Position = vec4(inVertPos, 0, 1);
-
-	// y is inverted to translate from CPU side coords to OpenGL coords.
-	fragWorldPos = vec2(inWindowToWorldSpace * vec4(inVertPos.x, -inVertPos.y, 0, 1));
-	povPos = vec2(inWindowToWorldSpace * vec4(inPovPosWindowSpace, 0, 1));
-	//povRelativePos = inPovRelativePosWindowSpace;
-}
\ No newline at end of file
+    if (dot(AB, BE) > 0) { 
+		return length(BE); 
+	}
+    else if (dot(AB, AE) < 0) {
+		return length(AE); 
+	}
+	return abs(AB.x * AE.y - AB.y * AE.x) / length(AB);
+}
+vec2 rotate(vec2 v, float angle) {
+    return mat2(cos(angle), -sin(angle), sin(angle), cos(angle)) * v;
+}
+vec4 rgb(float r, float g, float b) { return vec4(r/256,g/256,b/256,1); }
@@ -0,0 +1,12 @@
+#version 330 core
+
+layout (location = 0) in vec2 fragWorldPos;
+layout (location = 1) flat in vec2 fragCell;
+layout (location = 2) flat in vec4 fragColor;
+
+void main() {
+	// Only draw over the tile the quad was listed under, same as the per pixel test in the node network shader:
+	vec2 local = fragWorldPos - fragCell;
+	if (local.x < 0 || local.x > 1 || local.y < 0 || local.y > 1) discard;
+	gl_FragColor = fragColor;
+}
@@ -0,0 +1,25 @@
+#version 330 core
+
+// One unit quad per entity quad, placed by GuiManager::drawEntityInstances() (see GPU_EntityInstance in tile.h).
+layout (location = 0) in vec2 inCorner; // -0.5 to 0.5
+layout (location = 1) in vec2 inPos;    // per instance from here on.
+layout (location = 2) in vec2 inOffset;
+layout (location = 3) in vec2 inCell;
+layout (location = 4) in vec4 inColor;
+
+layout (location = 0) out vec2 fragWorldPos;
+layout (location = 1) flat out vec2 fragCell;
+layout (location = 2) flat out vec4 fragColor;
+
+uniform mat4 inWorldToWindowSpace;
+uniform float updateProgress;
+
+void main() {
+	fragWorldPos = inPos + inOffset * updateProgress + inCorner;
+	fragCell = inCell;
+	fragColor = inColor;
+
+	vec4 pos = inWorldToWindowSpace * vec4(fragWorldPos, 0, 1);
+	pos.y *= -1; // OpenGL expects inversed y.
+	gl_Position = pos;
+}
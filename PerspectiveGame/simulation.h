@@ -0,0 +1,363 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <shared_mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+
+#include "globalVariables.h"
+#include "tileNodeNetwork.h"
+#include "entityManager.h"
+#include "pov.h"
+#include "tileLod.h"
+#include "tileBvh.h"
+#include "worldEdit.h"
+#include "scenarioSetup.h"
+#include "tripleBuffer.h"
+#include "profiler.h"
+#include "memoryAccounting.h"
+#include "jobSystem.h"
+
+// Everything the renderer needs from the tiles.  Only rebuilt when the world is edited, and shared (never changed)
+// by every snapshot until then.
+struct TileSnapshot {
+	int version = 0;
+	std::vector<GPU_Tile> gpuTiles;
+	std::vector<GPU_TileLod> gpuTileLods;
+	TileBVH bvh; // for the 3D view's frustum culling.
+
+	// Ready to append to the 3D view's batch, same layout as setVertAttribVec3PosVec3NormVec3ColorVec2TextCoord1Index():
+	static const int FLOATS_PER_VERT = 12;
+	struct Tile3D {
+		GLfloat verts[4 * FLOATS_PER_VERT];
+		bool front;
+		bool live; // false for removed tiles waiting in the free list.
+	};
+	std::vector<Tile3D> tiles3D;
+};
+
+// The entities as the 2D view draws them, rebuilt after every tick.
+struct EntitySnapshot {
+	int rangesVersion = 0; // the ranges hardly ever change, so the renderer only re-uploads them when this does.
+	std::vector<GPU_EntityQuad> quads;
+	std::vector<unsigned int> quadColors; // packed, one per quad.
+	std::vector<int> tileQuadRanges; // (first quad, number of quads) per tile, see EntityManager.
+};
+
+// Where the 2D view starts its rays.
+struct PovView {
+	int tileIndex = 0;
+	MapType mapType = MAP_TYPE_IDENTITY;
+	int worldVersion = -1; // which world the tile index is for.
+};
+
+// What one simulation step hands to the renderer.  Cheap to copy, the big parts are shared.
+struct WorldSnapshot {
+	std::shared_ptr<const TileSnapshot> tiles;
+	std::shared_ptr<const EntitySnapshot> entities;
+	PovView pov;
+	int worldVersion = 0;
+	float lastTickTime = 0; // for the entities' updateProgress.
+	int tick = 0;
+	MemoryTracker memory; // as of this step, peaks since the last scenario load.
+};
+
+// Runs the world (edits, entity ticks and building what the renderer needs) on its own thread, so neither the
+// tick rate nor the frame rate waits on the other.  The input thread still moves the pov and the selection,
+// which only read the world, under a shared lock on worldMutex; the simulation takes it exclusively only while
+// it changes the world, and builds the snapshot under a shared lock.  Everything else goes through the
+// edit queue one way and the snapshot triple buffer the other.
+// Without start() nothing runs on its own and step() gets called once a frame instead (the benchmark does this).
+struct Simulation {
+	TileNodeNetwork* p_nodeNetwork = nullptr;
+	EntityManager* p_entityManager = nullptr;
+	POV* p_pov = nullptr;
+	POV* p_selectionPov = nullptr; // CurrentSelection's addTileParentPOV, it points into the world like the pov does.
+
+	std::shared_mutex worldMutex;
+	TripleBuffer<WorldSnapshot> snapshots;
+	int worldVersion = 0; // bumped by every batch of edits, only written with worldMutex held exclusively.
+	// Prints the network's size (and corner nodes) after every tile edit.  Slow on big worlds and it's done with the
+	// world locked, so off unless you're debugging the network:
+	std::atomic<bool> printEdits{ false };
+
+private:
+	std::mutex editsMutex;
+	std::condition_variable wakeUp;
+	std::vector<WorldEdit> queuedEdits; // behind editsMutex.
+	std::vector<WorldEdit> stepEdits;
+	std::thread thread;
+	std::atomic<bool> running{ false };
+
+	bool hasPublished = false;
+	int tilesVersion = 0;
+	int entityQuadsVersion = -1;
+	std::shared_ptr<const TileSnapshot> latestTiles;
+	std::shared_ptr<const EntitySnapshot> latestEntities;
+	MemoryTracker memory;
+
+public:
+	~Simulation() { stop(); }
+
+	void init(TileNodeNetwork* nn, EntityManager* em, POV* pov)
+	{
+		p_nodeNetwork = nn;
+		p_entityManager = em;
+		p_pov = pov;
+	}
+
+	bool isRunning() const { return running.load(std::memory_order_relaxed); }
+
+	void start()
+	{
+		if (isRunning()) return;
+		step(secondsSinceProgramStart()); // so there's a snapshot before the first frame.
+		running = true;
+		thread = std::thread(&Simulation::threadMain, this);
+	}
+
+	void stop()
+	{
+		if (!isRunning()) return;
+		{
+			std::lock_guard<std::mutex> lock(editsMutex);
+			running = false;
+		}
+		wakeUp.notify_one();
+		thread.join();
+	}
+
+	// Takes the edits, they happen on the next step.
+	void queueEdits(std::vector<WorldEdit>& edits)
+	{
+		if (edits.empty()) return;
+		{
+			std::lock_guard<std::mutex> lock(editsMutex);
+			queuedEdits.insert(queuedEdits.end(), edits.begin(), edits.end());
+		}
+		edits.clear();
+		wakeUp.notify_one();
+	}
+
+	// Needs worldMutex, either way:
+	PovView capturePov()
+	{
+		PovView v;
+		v.tileIndex = p_pov->getNode()->getTileIndex();
+		v.mapType = p_pov->mapType;
+		v.worldVersion = worldVersion;
+		return v;
+	}
+
+	// Swaps the whole world for the scenario's.  Takes the world like an edit does, so the thread can keep running.
+	// Queued edits are dropped, their tile indices mean nothing in the new world.  Returns how long it took.
+	ScenarioTiming loadScenario(const Scenario& scenario)
+	{
+		{
+			std::lock_guard<std::mutex> lock(editsMutex);
+			queuedEdits.clear();
+		}
+		ScenarioTiming timing;
+		timing.name = scenario.name;
+		std::unique_lock<std::shared_mutex> world(worldMutex);
+		auto start = std::chrono::steady_clock::now();
+		timing.numTilePairs = scenario.apply(*p_nodeNetwork, *p_entityManager, *p_pov);
+		timing.loadMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+		timing.numEntities = (int)p_entityManager->entities.size();
+		// Its node is from the old world, and the cursor ray doesn't move it when it takes no steps:
+		if (p_selectionPov != nullptr) *p_selectionPov = *p_pov;
+		worldVersion++;
+		memory.reset(); // the old world's peaks say nothing about this one.
+		return timing;
+	}
+
+	// Applies queued edits, ticks the entities if it's time and publishes a new snapshot if any of that happened.
+	void step(float now)
+	{
+		PROFILE_SCOPE(PROFILE_PHASE_SIMULATION_STEP);
+		{
+			std::lock_guard<std::mutex> lock(editsMutex);
+			stepEdits.swap(queuedEdits);
+		}
+		bool tick = (now - LastUpdateTime) >= UpdateTime;
+		if (stepEdits.empty() && !tick && hasPublished) return;
+
+		WorldSnapshot& snapshot = snapshots.writeSlot();
+		TileBVH bvh;
+		bool tilesChanged;
+		size_t liveBvhBytes;
+		{
+			std::unique_lock<std::shared_mutex> world(worldMutex);
+			if (!stepEdits.empty()) {
+				PROFILE_SCOPE(PROFILE_PHASE_EDIT_WORLD);
+				for (const WorldEdit& e : stepEdits) applyEdit(e);
+				stepEdits.clear();
+				worldVersion++;
+			}
+			if (tick) {
+				PROFILE_SCOPE(PROFILE_PHASE_MOVE_ENTITIES);
+				p_entityManager->moveEntities();
+				LastUpdateTime = now;
+				CurrentTick++;
+			}
+
+			// The input thread's cursor raycasts refit the bvh, so it can only be copied in here:
+			tilesChanged = p_nodeNetwork->gpuTilesDirty;
+			if (tilesChanged) bvh = p_nodeNetwork->bvh;
+			liveBvhBytes = p_nodeNetwork->bvh.memoryBytes(); // same goes for counting it.
+
+			snapshot.pov = capturePov();
+			snapshot.worldVersion = worldVersion;
+			snapshot.lastTickTime = LastUpdateTime;
+			snapshot.tick = CurrentTick;
+		}
+
+		// Nothing changes the world from here on, so the pov and selection can carry on alongside:
+		std::shared_lock<std::shared_mutex> world(worldMutex);
+		{
+			PROFILE_SCOPE(PROFILE_PHASE_NODE_NETWORK_UPDATE);
+			p_nodeNetwork->update();
+		}
+		{
+			PROFILE_SCOPE(PROFILE_PHASE_UPDATE_GPU_ENTITIES);
+			p_entityManager->updateGpuEntities(); // before the tiles, it checks gpuTilesDirty.
+		}
+		{
+			PROFILE_SCOPE(PROFILE_PHASE_BUILD_SNAPSHOT);
+			if (tilesChanged) {
+				p_nodeNetwork->rebuildGpuTilesIfDirty();
+				latestTiles = buildTileSnapshot(std::move(bvh));
+			}
+			if (p_entityManager->gpuEntityQuadsVersion != entityQuadsVersion) latestEntities = buildEntitySnapshot();
+		}
+		snapshot.tiles = latestTiles;
+		snapshot.entities = latestEntities;
+		memory.record(accountMemory(liveBvhBytes));
+		snapshot.memory = memory;
+		snapshots.publish();
+		hasPublished = true;
+	}
+
+private:
+	float secondsSinceProgramStart()
+	{
+		return std::chrono::duration<float, std::chrono::seconds::period>(std::chrono::steady_clock::now() - ProgramStart).count();
+	}
+
+	void threadMain()
+	{
+		std::unique_lock<std::mutex> lock(editsMutex);
+		while (running) {
+			// Sleep until the next tick is due or somebody wants the world edited:
+			auto nextTick = ProgramStart + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+				std::chrono::duration<float>(LastUpdateTime + UpdateTime));
+			wakeUp.wait_until(lock, nextTick, [this] { return !running || !queuedEdits.empty(); });
+			if (!running) break;
+
+			lock.unlock();
+			step(secondsSinceProgramStart());
+			lock.lock();
+		}
+	}
+
+	void applyEdit(const WorldEdit& e)
+	{
+		switch (e.type) {
+		case WORLD_EDIT_CREATE_TILE_PAIR:
+			p_nodeNetwork->createTilePair(e.pos, e.superTileType);
+			if (printEdits) {
+				p_nodeNetwork->printSize();
+				p_nodeNetwork->printCornerNodePositions();
+			}
+			break;
+		case WORLD_EDIT_REMOVE_TILE_PAIR: {
+			if (e.tileIndex < 0 || e.tileIndex >= p_nodeNetwork->numTiles()) break;
+			Tile* tile = p_nodeNetwork->getTile(e.tileIndex);
+			// Already gone (two clicks before a step), or it's under the pov, which may have moved since the click:
+			if (tile->index == -1) break;
+			int povTile = p_pov->getNode()->getTileIndex();
+			if (e.tileIndex == povTile || e.tileIndex == p_pov->getTile()->siblingIndex) break;
+
+			p_nodeNetwork->removeTilePair(tile);
+			if (printEdits) p_nodeNetwork->printSize();
+			break;
+		}
+		}
+	}
+
+	// Needs at least a shared lock on the world.  The live bvh gets counted under the exclusive one, see step():
+	MemoryReport accountMemory(size_t liveBvhBytes) const
+	{
+		MemoryReport report;
+		p_nodeNetwork->accountMemory(report);
+		report.bytes[MEMORY_TILE_BVH] += liveBvhBytes;
+		p_entityManager->accountMemory(report);
+		size_t& snapshotBytes = report.bytes[MEMORY_SNAPSHOTS];
+		if (latestTiles != nullptr) {
+			snapshotBytes += sizeof(TileSnapshot) + vectorBytes(latestTiles->gpuTiles) + vectorBytes(latestTiles->gpuTileLods) +
+				latestTiles->bvh.memoryBytes() + vectorBytes(latestTiles->tiles3D);
+		}
+		if (latestEntities != nullptr) {
+			snapshotBytes += sizeof(EntitySnapshot) + vectorBytes(latestEntities->quads) +
+				vectorBytes(latestEntities->quadColors) + vectorBytes(latestEntities->tileQuadRanges);
+		}
+		return report;
+	}
+
+	std::shared_ptr<const TileSnapshot> buildTileSnapshot(TileBVH&& bvh)
+	{
+		auto s = std::make_shared<TileSnapshot>();
+		s->version = ++tilesVersion;
+		s->gpuTiles = p_nodeNetwork->gpuTiles;
+		s->gpuTileLods = p_nodeNetwork->gpuTileLods;
+		s->bvh = std::move(bvh);
+
+		s->tiles3D.resize(p_nodeNetwork->numTiles());
+		GlobalJobSystem.parallelFor(p_nodeNetwork->numTiles(), 1024, [&](int begin, int end) {
+			for (int t = begin; t < end; t++) {
+				Tile* info = p_nodeNetwork->getTile(t);
+				TileSnapshot::Tile3D& out = s->tiles3D[t];
+				out.live = info->index != -1;
+				if (!out.live) continue;
+				out.front = tnav::isFront(info->type);
+
+				const glm::vec3* offsets = tnav::getNodePositionOffsets(info->type);
+				glm::vec3 center = p_nodeNetwork->getNode(info->centerNodeIndex)->getPosition();
+				glm::vec3 normal = tnav::getNormal(info->type);
+				for (int i = 0; i < 4; i++) {
+					GLfloat* v = &out.verts[i * TileSnapshot::FLOATS_PER_VERT];
+					glm::vec3 pos = center + offsets[i + 4];
+					v[0] = pos.x; v[1] = pos.y; v[2] = pos.z;
+					v[3] = normal.x; v[4] = normal.y; v[5] = normal.z;
+					v[6] = info->color.r; v[7] = info->color.g; v[8] = info->color.b;
+					v[9] = info->textureCoordinates[i].x; v[10] = info->textureCoordinates[i].y;
+					v[11] = (GLfloat)info->index;
+				}
+			}
+		});
+		return s;
+	}
+
+	std::shared_ptr<const EntitySnapshot> buildEntitySnapshot()
+	{
+		EntityManager& em = *p_entityManager;
+		entityQuadsVersion = em.gpuEntityQuadsVersion;
+
+		auto s = std::make_shared<EntitySnapshot>();
+		s->rangesVersion = em.gpuTileEntityQuadRangesVersion;
+		s->quads = em.gpuEntityQuads;
+		s->tileQuadRanges = em.gpuTileEntityQuadRanges;
+		s->quadColors.resize(em.gpuEntityQuadOwners.size());
+		GlobalJobSystem.parallelFor((int)em.gpuEntityQuadOwners.size(), 4096, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				GPU_EntityInfo info(&em.entities[em.gpuEntityQuadOwners[i]]);
+				s->quadColors[i] = GPU_Tile::packColor(glm::vec4(glm::vec3(info.info), 1.0f));
+			}
+		});
+		return s;
+	}
+};
@@ -0,0 +1,226 @@
+#include "soakTest.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <algorithm>
+
+#include "forceManager.h"
+#include "tileNodeNetwork.h"
+
+namespace {
+	struct SoakEdit {
+		bool add;
+		glm::vec3 pos;
+		SuperTileType type; // add only, removes take whatever pair is at pos.
+	};
+
+	struct SoakWorld {
+		Camera camera;
+		ForceManager forceManager;
+		TileNodeNetwork nodeNetwork;
+		int numPairs = 1; // the network starts out with one.
+
+		SoakWorld() : nodeNetwork(&camera, &forceManager) {}
+
+		int findTile(glm::vec3 pos)
+		{
+			for (int t = 0; t < nodeNetwork.numTiles(); t++) {
+				Tile* tile = nodeNetwork.getTile(t);
+				if (tile->index != -1 && nodeNetwork.getNode(tile->centerNodeIndex)->getPosition() == pos) return t;
+			}
+			return -1;
+		}
+
+		// False if it didn't change anything (tile already there, nothing to remove, or it's the last pair):
+		bool apply(const SoakEdit& e)
+		{
+			if (e.add) {
+				if (nodeNetwork.createTilePair(e.pos, e.type) == nullptr) return false;
+				numPairs++;
+				return true;
+			}
+			int t = findTile(e.pos);
+			if (t == -1 || numPairs <= 1) return false;
+			nodeNetwork.removeTilePair(t);
+			numPairs--;
+			return true;
+		}
+	};
+
+	const char* superTileTypeName(SuperTileType type)
+	{
+		switch (type) {
+		case TILE_TYPE_XY: return "XY";
+		case TILE_TYPE_XZ: return "XZ";
+		default: return "YZ";
+		}
+	}
+
+	std::ostream& operator<<(std::ostream& out, const SoakEdit& e)
+	{
+		out << (e.add ? "add " : "remove ") << e.pos.x << " " << e.pos.y << " " << e.pos.z;
+		if (e.add) out << " " << superTileTypeName(e.type);
+		return out;
+	}
+
+	// Replays edits into a fresh network, checking after every one.  Returns how many edits in it broke, 0 if it was
+	// broken from the start, or -1 if it never broke:
+	int replay(const std::vector<SoakEdit>& edits, std::vector<std::string>& errors)
+	{
+		std::unique_ptr<SoakWorld> world = std::make_unique<SoakWorld>();
+		if (!world->nodeNetwork.checkInvariants(errors)) return 0;
+		for (int i = 0; i < (int)edits.size(); i++) {
+			if (world->apply(edits[i]) && !world->nodeNetwork.checkInvariants(errors)) return i + 1;
+		}
+		return -1;
+	}
+
+	bool stillFails(const std::vector<SoakEdit>& edits)
+	{
+		std::vector<std::string> errors;
+		return replay(edits, errors) != -1;
+	}
+
+	// Delta debugging (ddmin): keep throwing out chunks of edits as long as what's left still breaks something, with
+	// smaller and smaller chunks until no single edit can go:
+	std::vector<SoakEdit> shrink(std::vector<SoakEdit> edits)
+	{
+		int numChunks = 2;
+		while (edits.size() >= 2) {
+			int chunkSize = (int)(edits.size() + numChunks - 1) / numChunks;
+			bool shrunk = false;
+			for (int start = 0; start < (int)edits.size() && !shrunk; start += chunkSize) {
+				int end = std::min(start + chunkSize, (int)edits.size());
+				std::vector<SoakEdit> chunk(edits.begin() + start, edits.begin() + end);
+				std::vector<SoakEdit> rest(edits.begin(), edits.begin() + start);
+				rest.insert(rest.end(), edits.begin() + end, edits.end());
+				if (stillFails(chunk)) {
+					edits = chunk;
+					numChunks = 2;
+					shrunk = true;
+				}
+				else if (stillFails(rest)) {
+					edits = rest;
+					numChunks = std::max(numChunks - 1, 2);
+					shrunk = true;
+				}
+			}
+			if (shrunk) continue;
+			if (numChunks >= (int)edits.size()) break;
+			numChunks = std::min(numChunks * 2, (int)edits.size());
+		}
+		if (edits.size() == 1 && stillFails({})) edits.clear();
+		return edits;
+	}
+
+	void reportFailure(const SoakTestSettings& settings, int episode, const std::vector<SoakEdit>& episodeEdits)
+	{
+		std::cout << "ERROR::SOAK_TEST:: invariants broke in episode " << episode << " after " << episodeEdits.size()
+			<< " edits, shrinking..." << std::endl;
+
+		std::vector<SoakEdit> edits = shrink(episodeEdits);
+		std::vector<std::string> errors;
+		int brokeAt = replay(edits, errors);
+		if (brokeAt == -1) {
+			// Something outside the edits (left over gl or force state?), keep the whole episode:
+			std::cout << "ERROR::SOAK_TEST:: the failure doesn't replay in a fresh network, keeping all edits" << std::endl;
+			edits = episodeEdits;
+		}
+
+		std::ofstream file(settings.failureFile);
+		std::cout << "Smallest failing edit sequence (" << edits.size() << " edits, starting from the single tile at the origin):\n";
+		file << "# soak test seed " << settings.seed << ", episode " << episode << ", from the single tile at the origin\n";
+		for (const SoakEdit& e : edits) {
+			std::cout << "  " << e << "\n";
+			file << e << "\n";
+		}
+		std::cout << "Broken invariants:\n";
+		for (const std::string& error : errors) {
+			std::cout << "  " << error << "\n";
+			file << "# " << error << "\n";
+		}
+		std::cout << (file.good() ? "Written to " + settings.failureFile : "ERROR::SOAK_TEST:: could not write " + settings.failureFile) << std::endl;
+	}
+}
+
+bool runSoakTest(const SoakTestSettings& settings)
+{
+	using clock = std::chrono::steady_clock;
+
+	int64_t numAdds = 0, numRemoves = 0, numSkipped = 0, numChecks = 0;
+	double editSeconds = 0, checkSeconds = 0;
+	bool passed = true;
+	auto start = clock::now();
+	auto lastProgress = start;
+
+	std::vector<SoakEdit> episodeEdits;
+	std::vector<std::string> errors;
+	for (int episode = 0; numAdds + numRemoves + numSkipped < settings.numEdits; episode++) {
+		// Seeded per episode, so a crash in one can be looked at without running everything before it:
+		std::seed_seq seq{ settings.seed, (uint32_t)episode };
+		std::mt19937 rng(seq);
+		std::uniform_int_distribution<int> cellDist(0, settings.worldSize - 1), typeDist(0, 2);
+		std::uniform_real_distribution<float> unitDist(0, 1);
+
+		std::unique_ptr<SoakWorld> world = std::make_unique<SoakWorld>();
+		episodeEdits.clear();
+		for (int i = 0; i < settings.editsPerEpisode && passed; i++) {
+			SoakEdit e;
+			e.add = true;
+			// Removes pick a tile that's actually there, otherwise most of them would miss:
+			if (world->numPairs > 1 && unitDist(rng) < 0.4f) {
+				std::uniform_int_distribution<int> tileDist(0, world->nodeNetwork.numTiles() - 1);
+				for (int tries = 0; tries < 16 && e.add; tries++) {
+					Tile* t = world->nodeNetwork.getTile(tileDist(rng));
+					if (t->index == -1) continue;
+					e.add = false;
+					e.pos = world->nodeNetwork.getNode(t->centerNodeIndex)->getPosition();
+				}
+			}
+			if (e.add) {
+				int x = cellDist(rng), y = cellDist(rng), z = cellDist(rng);
+				e.type = SuperTileType(typeDist(rng));
+				e.pos = latticeTilePos(e.type, x, y, z);
+			}
+			episodeEdits.push_back(e);
+
+			auto editStart = clock::now();
+			bool changed = world->apply(e);
+			editSeconds += std::chrono::duration<double>(clock::now() - editStart).count();
+			if (!changed) numSkipped++;
+			else if (e.add) numAdds++;
+			else numRemoves++;
+
+			if ((i + 1) % settings.editsPerCheck == 0 || i + 1 == settings.editsPerEpisode) {
+				auto checkStart = clock::now();
+				passed = world->nodeNetwork.checkInvariants(errors);
+				checkSeconds += std::chrono::duration<double>(clock::now() - checkStart).count();
+				numChecks++;
+			}
+		}
+		if (!passed) {
+			reportFailure(settings, episode, episodeEdits);
+			break;
+		}
+
+		if (clock::now() - lastProgress > std::chrono::seconds(5)) {
+			lastProgress = clock::now();
+			std::cout << "Soak test: episode " << episode << ", " << numAdds + numRemoves + numSkipped << " edits, "
+				<< world->numPairs << " tile pairs" << std::endl;
+		}
+	}
+
+	double totalSeconds = std::chrono::duration<double>(clock::now() - start).count();
+	int64_t numEdits = numAdds + numRemoves + numSkipped;
+	std::cout << "Soak test (seed " << settings.seed << "): " << (passed ? "passed" : "FAILED") << "\n";
+	std::cout << "  " << numAdds << " adds, " << numRemoves << " removes, " << numSkipped << " skipped (already there / last pair)\n";
+	std::cout << "  " << numEdits / std::max(editSeconds, 1e-9) << " edits/s editing, "
+		<< numEdits / std::max(totalSeconds, 1e-9) << " edits/s overall\n";
+	std::cout << "  " << numChecks << " invariant checks, " << 1000.0 * checkSeconds / std::max<int64_t>(numChecks, 1)
+		<< " ms each, " << totalSeconds << " s total" << std::endl;
+	return passed;
+}
@@ -0,0 +1,20 @@
+#pragma once
+#include <string>
+#include <cstdint>
+
+// Throws seeded random tile pair adds and removes at the node network, a short episode at a time in a fresh network,
+// and every so often runs TileNodeNetwork::checkInvariants() over the whole thing.  When a check fails the episode is
+// replayed and shrunk down to the fewest edits that still break it, which get printed and written to failureFile.
+// Edits are positions, not indices, so any subset of an episode still means something when replayed.
+// Topology only, no gl context needed, so it runs anywhere, display or not.
+struct SoakTestSettings {
+	int64_t numEdits = 2000000;
+	uint32_t seed = 1;
+	int editsPerEpisode = 2000; // fresh network after this many, so the world can't just fill up.
+	int editsPerCheck = 100;
+	int worldSize = 6;          // tiles go on the lattice in a worldSize^3 box, small so edits keep running into each other.
+	std::string failureFile = "soak_failure.txt";
+};
+
+// Returns false if an invariant broke.
+bool runSoakTest(const SoakTestSettings& settings);
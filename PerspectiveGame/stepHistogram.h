@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <algorithm>
+
+// How many tile-to-tile steps ray marches take.  The gpu fills one per frame from the node network shader
+// (see findTile() in 2d3rdPersonPovViaNodeNetwork.frag), the cpu raycasters keep their own.
+// The shader buckets steps the same way as add(), so keep them in sync.
+const int NUM_STEP_HISTOGRAM_BUCKETS = 32;
+const int MAX_NODE_NETWORK_RAY_STEPS = 500; // MAX_STEPS in the node network shader.
+
+struct StepHistogram {
+	// Last slot counts rays that gave up at maxSteps (the black pixels), so it's NUM_STEP_HISTOGRAM_BUCKETS + 1 big.
+	uint32_t buckets[NUM_STEP_HISTOGRAM_BUCKETS + 1] = {};
+	int maxSteps;
+	uint64_t totalSteps = 0;
+
+	StepHistogram(int maxSteps) : maxSteps(maxSteps) {}
+
+	static int bucketOf(int steps, int maxSteps)
+	{
+		return std::min(steps * NUM_STEP_HISTOGRAM_BUCKETS / maxSteps, NUM_STEP_HISTOGRAM_BUCKETS - 1);
+	}
+
+	void add(int steps)
+	{
+		if (steps >= maxSteps) buckets[NUM_STEP_HISTOGRAM_BUCKETS]++;
+		else buckets[bucketOf(steps, maxSteps)]++;
+		totalSteps += steps;
+	}
+
+	void clear()
+	{
+		std::fill(std::begin(buckets), std::end(buckets), 0);
+		totalSteps = 0;
+	}
+
+	uint64_t numRays() const
+	{
+		uint64_t n = 0;
+		for (uint32_t b : buckets) n += b;
+		return n;
+	}
+
+	uint32_t numMaxedOut() const { return buckets[NUM_STEP_HISTOGRAM_BUCKETS]; }
+
+	float averageSteps() const
+	{
+		uint64_t n = numRays();
+		return n == 0 ? 0.0f : (float)totalSteps / n;
+	}
+};
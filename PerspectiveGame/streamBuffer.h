@@ -0,0 +1,257 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <cstring>
+#include <algorithm>
+#ifndef __gl_h_
+#include <glad/glad.h>
+#endif
+
+#include "memoryAccounting.h"
+
+// Uncomment to always use the glBufferSubData path, even if persistent mapping is available
+// (or pass forceFallback to init(), streamBufferCheck.h runs both ways):
+//#define STREAM_BUFFER_FORCE_FALLBACK
+
+// A chunk of the stream buffer handed out for one upload.  Only valid for the frame it was allocated in.
+struct StreamAllocation {
+	GLintptr offset = 0;
+	GLsizeiptr size = 0;
+	GLsizei stride = 1;
+	GLintptr indexStart = 0; // where the indices start, relative to offset (see uploadIndexed()).
+	unsigned char* ptr = nullptr; // write the data here, then commit() it.
+
+	// For glDrawElementsBaseVertex, offsets are always a multiple of the vertex stride:
+	GLint baseVertex() const { return (GLint)(offset / stride); }
+	// For the indices argument of glDrawElements* when the stream buffer is the element buffer:
+	void* indexOffset() const { return (void*)(offset + indexStart); }
+};
+
+// Ring buffer for all the per-frame dynamic uploads (quads, tile verts, ssbo data, ...).
+// The buffer is split into one region per frame in flight, each guarded by a fence so the cpu never
+// writes over something the gpu is still reading.  With GL 4.4 the whole thing is persistently mapped
+// and uploads are plain memcpys.  Otherwise (GL 3.3, some Mesa drivers) writes go to a cpu-side shadow copy
+// and get pushed with glBufferSubData, which is still fenced and never orphans.
+struct StreamBuffer {
+	static const int NUM_FRAMES_IN_FLIGHT = 3;
+	static const GLuint MAX_VERTEX_ATTRIBS = 5; // highest attrib location used by vertexManager + 1.
+	const GLsizeiptr INITIAL_REGION_SIZE = 1 << 20;
+
+	GLuint ID = 0;
+	GLuint VAO = 0; // streamed vertex formats all get set up on this one.
+	bool persistentlyMapped = false;
+
+private:
+	GLsizeiptr regionSize = 0;
+	int currentRegion = 0;
+	GLintptr head = 0; // next free byte in the current region, relative to the buffer start.
+	GLsync fences[NUM_FRAMES_IN_FLIGHT] = {};
+	unsigned char* mappedPtr = nullptr;
+	std::vector<unsigned char> shadowCopy; // only used when not persistently mapped.
+	GLint storageBufferAlignment = 256;
+	std::vector<GLuint> retiredBuffers; // replaced by a grow(), deleted next frame so earlier bindings stay valid.
+
+public: // Stats:
+	int numAllocationsThisFrame = 0;
+	GLsizeiptr bytesThisFrame = 0;
+	int numStalls = 0; // times beginFrame() had to wait on the gpu.
+	int numGrows = 0;
+
+public:
+	void init(bool forceFallback = false)
+	{
+#ifndef STREAM_BUFFER_FORCE_FALLBACK
+		persistentlyMapped = GLAD_GL_VERSION_4_4 != 0 && !forceFallback;
+#endif
+		if (GLAD_GL_VERSION_4_3) {
+			glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &storageBufferAlignment);
+		}
+		GLint uniformAlignment = 256;
+		glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uniformAlignment);
+		storageBufferAlignment = std::max(storageBufferAlignment, uniformAlignment);
+
+		glGenVertexArrays(1, &VAO);
+		createBuffer(INITIAL_REGION_SIZE);
+	}
+
+	~StreamBuffer()
+	{
+		destroyBuffer();
+		for (GLuint retired : retiredBuffers) GlobalGlBufferMemory.remove(retired);
+		if (!retiredBuffers.empty()) glDeleteBuffers((GLsizei)retiredBuffers.size(), retiredBuffers.data());
+		if (VAO != 0) glDeleteVertexArrays(1, &VAO);
+	}
+
+	GLint getStorageBufferAlignment() { return storageBufferAlignment; }
+
+	// Moves on to the next region, waiting for the gpu to be done with it if need be.
+	void beginFrame()
+	{
+		currentRegion = (currentRegion + 1) % NUM_FRAMES_IN_FLIGHT;
+		head = currentRegion * regionSize;
+		numAllocationsThisFrame = 0;
+		bytesThisFrame = 0;
+
+		if (!retiredBuffers.empty()) {
+			for (GLuint retired : retiredBuffers) GlobalGlBufferMemory.remove(retired);
+			glDeleteBuffers((GLsizei)retiredBuffers.size(), retiredBuffers.data());
+			retiredBuffers.clear();
+		}
+
+		GLsync& fence = fences[currentRegion];
+		if (fence == nullptr) return;
+
+		GLenum result = glClientWaitSync(fence, 0, 0);
+		if (result == GL_TIMEOUT_EXPIRED) {
+			numStalls++;
+			do {
+				result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000); // 1 sec
+			} while (result == GL_TIMEOUT_EXPIRED);
+		}
+		if (result == GL_WAIT_FAILED) {
+			std::cout << "ERROR::STREAM_BUFFER:: glClientWaitSync failed!" << std::endl;
+		}
+		glDeleteSync(fence);
+		fence = nullptr;
+	}
+
+	// Everything the gpu was told to do with this frame's region is behind this fence:
+	void endFrame()
+	{
+		if (fences[currentRegion] != nullptr) glDeleteSync(fences[currentRegion]);
+		fences[currentRegion] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// Reserves size bytes with the given alignment (which does not have to be a power of 2, vertex strides are fine).
+	// Fill in the returned ptr and then commit().  If the frame runs out of room the buffer is replaced by a
+	// bigger one, so always re-read ID (or bind()) after allocating.  Ranges already bound stay valid till next frame.
+	StreamAllocation allocate(GLsizeiptr size, GLsizei alignment)
+	{
+		GLintptr regionEnd = (currentRegion + 1) * regionSize;
+		GLintptr offset = ((head + alignment - 1) / alignment) * alignment;
+		if (offset + size > regionEnd) {
+			grow(size + alignment);
+			regionEnd = (currentRegion + 1) * regionSize;
+			offset = ((head + alignment - 1) / alignment) * alignment;
+		}
+		head = offset + size;
+
+		numAllocationsThisFrame++;
+		bytesThisFrame += size;
+
+		StreamAllocation a;
+		a.offset = offset;
+		a.size = size;
+		a.stride = alignment;
+		a.ptr = persistentlyMapped ? mappedPtr + offset : shadowCopy.data() + offset;
+		return a;
+	}
+
+	void commit(const StreamAllocation& a)
+	{
+		if (persistentlyMapped) return; // coherent mapping, nothing to do.
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+		glBufferSubData(GL_COPY_WRITE_BUFFER, a.offset, a.size, a.ptr);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+	}
+
+	StreamAllocation upload(const void* data, GLsizeiptr size, GLsizei alignment)
+	{
+		StreamAllocation a = allocate(size, alignment);
+		memcpy(a.ptr, data, size);
+		commit(a);
+		return a;
+	}
+
+	// Verts and indices in one allocation, so they can never end up split across a grow().
+	// Draw with glDrawElementsBaseVertex(..., a.indexOffset(), a.baseVertex()) after bind().
+	StreamAllocation uploadIndexed(const void* verts, GLsizeiptr vertBytes, GLsizei vertStride,
+								   const GLuint* indices, GLsizeiptr indexBytes)
+	{
+		StreamAllocation a = allocate(vertBytes + indexBytes, vertStride);
+		memcpy(a.ptr, verts, vertBytes);
+		memcpy(a.ptr + vertBytes, indices, indexBytes);
+		a.indexStart = vertBytes; // vert strides are all whole floats, so this stays 4 byte aligned.
+		commit(a);
+		return a;
+	}
+
+	// Convenience for ssbo/ubo data, which has stricter offset rules:
+	StreamAllocation uploadStorage(const void* data, GLsizeiptr size)
+	{
+		return upload(data, size, storageBufferAlignment);
+	}
+
+	// Binds the stream VAO with the stream buffer as both vertex and element buffer.
+	// Call this after uploading, as an upload may have had to grow (and so replace) the buffer,
+	// then set up the vertex format with one of the setVertAttrib*() functions.
+	void bind()
+	{
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, ID);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ID);
+		// The VAO is shared between formats, so clear out whatever the last one left enabled:
+		for (GLuint i = 0; i < MAX_VERTEX_ATTRIBS; i++) {
+			glDisableVertexAttribArray(i);
+			glVertexAttribDivisor(i, 0); // instanced draws set some to 1.
+		}
+	}
+
+	GLsizeiptr capacity() { return regionSize * NUM_FRAMES_IN_FLIGHT; }
+
+private:
+	void createBuffer(GLsizeiptr newRegionSize)
+	{
+		regionSize = newRegionSize;
+		GLsizeiptr totalSize = regionSize * NUM_FRAMES_IN_FLIGHT;
+
+		glGenBuffers(1, &ID);
+		glBindBuffer(GL_COPY_WRITE_BUFFER, ID);
+		if (persistentlyMapped) {
+			GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(GL_COPY_WRITE_BUFFER, totalSize, nullptr, flags);
+			mappedPtr = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalSize, flags);
+			if (mappedPtr == nullptr) {
+				std::cout << "ERROR::STREAM_BUFFER:: persistent map failed, falling back to glBufferSubData" << std::endl;
+				glDeleteBuffers(1, &ID);
+				persistentlyMapped = false;
+				createBuffer(newRegionSize);
+				return;
+			}
+		}
+		else {
+			glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+			shadowCopy.resize(totalSize);
+		}
+		glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+		GlobalGlBufferMemory.set(ID, (size_t)totalSize);
+
+		currentRegion = 0;
+		head = 0;
+	}
+
+	void destroyBuffer()
+	{
+		for (GLsync& fence : fences) {
+			if (fence != nullptr) glDeleteSync(fence);
+			fence = nullptr;
+		}
+		GlobalGlBufferMemory.remove(ID);
+		if (ID != 0) glDeleteBuffers(1, &ID); // also unmaps it.
+		ID = 0;
+		mappedPtr = nullptr;
+	}
+
+	// Out of room this frame.  The old buffer is kept (mapped and all) until the next beginFrame() since
+	// this frame may still have ranges of it bound, and the new one starts with no fences to wait on.
+	void grow(GLsizeiptr minSize)
+	{
+		GLsizeiptr newRegionSize = regionSize * 2;
+		while (newRegionSize < minSize) newRegionSize *= 2;
+		retiredBuffers.push_back(ID);
+		ID = 0;
+		destroyBuffer();
+		createBuffer(newRegionSize);
+		numGrows++;
+	}
+};
@@ -0,0 +1,160 @@
+#include "streamBufferCheck.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "streamBuffer.h"
+
+namespace {
+	struct StreamBufferChecker {
+		StreamBuffer& stream;
+		std::string mode;
+		int numErrors = 0;
+
+		void fail(const std::string& what)
+		{
+			if (numErrors++ < 20) std::cout << "ERROR::STREAM_BUFFER_CHECK:: " << mode << ": " << what << std::endl;
+		}
+
+		// Bytes that depend on where they're from, so a chunk landing in the wrong place shows up:
+		static std::vector<unsigned char> pattern(size_t size, int seed)
+		{
+			std::vector<unsigned char> bytes(size);
+			for (size_t i = 0; i < size; i++) bytes[i] = (unsigned char)(i * 31 + seed * 7 + (i >> 8));
+			return bytes;
+		}
+
+		// What the gpu sees, not what's in the mapping/shadow copy:
+		void checkContents(const StreamAllocation& a, const std::vector<unsigned char>& expected, const std::string& what)
+		{
+			std::vector<unsigned char> actual(expected.size());
+			glBindBuffer(GL_COPY_READ_BUFFER, stream.ID);
+			glGetBufferSubData(GL_COPY_READ_BUFFER, a.offset, (GLsizeiptr)actual.size(), actual.data());
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			if (actual != expected) fail(what + " reads back wrong at offset " + std::to_string(a.offset));
+		}
+
+		void checkPlacement(const StreamAllocation& a, GLsizei alignment, int region, const std::string& what)
+		{
+			GLsizeiptr regionSize = stream.capacity() / StreamBuffer::NUM_FRAMES_IN_FLIGHT;
+			if (a.offset % alignment != 0) fail(what + " isn't aligned to " + std::to_string(alignment));
+			if (a.offset < region * regionSize || a.offset + a.size > (region + 1) * regionSize) {
+				fail(what + " is outside region " + std::to_string(region));
+			}
+		}
+
+		// Round the ring twice and a bit.  init() starts on region 0 so the first beginFrame() is region 1:
+		void checkWrapAround(int& region)
+		{
+			GLsizeiptr regionSize = stream.capacity() / StreamBuffer::NUM_FRAMES_IN_FLIGHT;
+			const GLsizei VERT_STRIDE = 28; // not a power of 2, like the real vertex formats.
+			const GLuint INDICES[6] = { 0, 1, 3, 1, 2, 3 };
+			for (int frame = 0; frame < 2 * StreamBuffer::NUM_FRAMES_IN_FLIGHT + 1; frame++) {
+				stream.beginFrame();
+				region = (region + 1) % StreamBuffer::NUM_FRAMES_IN_FLIGHT;
+
+				std::vector<unsigned char> bytes = pattern(37, frame);
+				StreamAllocation first = stream.upload(bytes.data(), (GLsizeiptr)bytes.size(), 1);
+				if (first.offset != region * regionSize) fail("frame " + std::to_string(frame) + " doesn't start at its region");
+				checkContents(first, bytes, "unaligned upload");
+
+				for (int i = 0; i < 50; i++) {
+					std::vector<unsigned char> verts = pattern(4 * VERT_STRIDE, frame * 100 + i);
+					StreamAllocation a = stream.uploadIndexed(verts.data(), (GLsizeiptr)verts.size(), VERT_STRIDE,
+															  INDICES, sizeof(INDICES));
+					checkPlacement(a, VERT_STRIDE, region, "indexed upload");
+					if ((a.offset + a.indexStart) % 4 != 0) fail("indices aren't 4 byte aligned");
+					if (a.baseVertex() * VERT_STRIDE != a.offset) fail("baseVertex() doesn't match the offset");
+					std::vector<unsigned char> expected = verts;
+					expected.insert(expected.end(), (const unsigned char*)INDICES, (const unsigned char*)INDICES + sizeof(INDICES));
+					checkContents(a, expected, "indexed upload");
+				}
+
+				std::vector<unsigned char> storage = pattern(100, frame);
+				StreamAllocation s = stream.uploadStorage(storage.data(), (GLsizeiptr)storage.size());
+				checkPlacement(s, stream.getStorageBufferAlignment(), region, "storage upload");
+				checkContents(s, storage, "storage upload");
+				stream.endFrame();
+			}
+		}
+
+		// An upload bigger than a whole region in the middle of a frame:
+		void checkGrow(int& region)
+		{
+			stream.beginFrame();
+			std::vector<unsigned char> small = pattern(64, 1);
+			StreamAllocation before = stream.upload(small.data(), (GLsizeiptr)small.size(), 4);
+			GLuint oldID = stream.ID;
+			GLsizeiptr oldCapacity = stream.capacity();
+			int oldGrows = stream.numGrows;
+
+			std::vector<unsigned char> big = pattern((size_t)(oldCapacity / StreamBuffer::NUM_FRAMES_IN_FLIGHT) + 1000, 2);
+			StreamAllocation a = stream.upload(big.data(), (GLsizeiptr)big.size(), 4);
+			if (stream.numGrows != oldGrows + 1) fail("the big upload didn't grow the buffer once");
+			if (stream.ID == oldID || stream.capacity() <= oldCapacity) fail("grow() didn't make a bigger buffer");
+			if (!glIsBuffer(oldID)) fail("grow() deleted the old buffer while this frame could still be using it");
+			// A grow starts the new buffer over on region 0:
+			region = 0;
+			checkPlacement(a, 4, region, "upload after grow");
+			checkContents(a, big, "upload after grow");
+
+			glBindBuffer(GL_COPY_READ_BUFFER, oldID);
+			std::vector<unsigned char> old(small.size());
+			glGetBufferSubData(GL_COPY_READ_BUFFER, before.offset, (GLsizeiptr)old.size(), old.data());
+			glBindBuffer(GL_COPY_READ_BUFFER, 0);
+			if (old != small) fail("the retired buffer lost what was uploaded before the grow");
+			stream.endFrame();
+
+			stream.beginFrame();
+			region = (region + 1) % StreamBuffer::NUM_FRAMES_IN_FLIGHT;
+			if (glIsBuffer(oldID)) fail("the retired buffer is still around the frame after");
+			if (GlobalGlBufferMemory.sizes.count(oldID) != 0) fail("the retired buffer is still in GlobalGlBufferMemory");
+			if (GlobalGlBufferMemory.sizes.count(stream.ID) == 0) fail("the new buffer isn't in GlobalGlBufferMemory");
+			StreamAllocation after = stream.upload(small.data(), (GLsizeiptr)small.size(), 4);
+			checkPlacement(after, 4, region, "upload the frame after a grow");
+			checkContents(after, small, "upload the frame after a grow");
+			stream.endFrame();
+		}
+	};
+
+	bool checkMode(bool forceFallback)
+	{
+		StreamBuffer stream;
+		stream.init(forceFallback);
+		StreamBufferChecker checker{ stream, forceFallback ? "glBufferSubData fallback" : "persistently mapped" };
+		if (!forceFallback && !stream.persistentlyMapped) {
+			std::cout << "Stream buffer check: no GL 4.4, skipping the persistently mapped pass" << std::endl;
+			return true;
+		}
+
+		int region = 0;
+		checker.checkWrapAround(region);
+		checker.checkGrow(region);
+		checker.checkWrapAround(region);
+		glFinish();
+		if (glGetError() != GL_NO_ERROR) checker.fail("gl errors");
+
+		std::cout << "Stream buffer check (" << checker.mode << "): " << (checker.numErrors == 0 ? "passed" : "FAILED")
+			<< ", " << stream.numGrows << " grows, " << stream.numStalls << " stalls, capacity "
+			<< stream.capacity() / 1024 << " KB" << std::endl;
+		return checker.numErrors == 0;
+	}
+}
+
+bool runStreamBufferCheck(HeadlessBackend backend)
+{
+	HeadlessContext context;
+	if (!context.init(backend, glm::ivec2(64, 64))) return false;
+
+	bool passed = checkMode(false);
+	passed = checkMode(true) && passed;
+
+	// Nothing takes the hidden window over here like App does:
+	if (context.window != nullptr) {
+		glfwDestroyWindow(context.window);
+		context.window = nullptr;
+		glfwTerminate();
+	}
+	return passed;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "headlessContext.h"
+
+// Runs the StreamBuffer through its awkward cases on a real (headless) context and reads everything back with
+// glGetBufferSubData: a few times round the ring of frame regions with odd alignments, an upload too big for the
+// region so grow() has to replace the buffer (the old one has to outlive the frame, then get deleted and dropped
+// from GlobalGlBufferMemory), and all of it again on the glBufferSubData fallback (STREAM_BUFFER_FORCE_FALLBACK).
+// The persistently mapped pass is skipped on contexts without GL 4.4.
+// Returns false if anything came back wrong or a context couldn't be made.
+bool runStreamBufferCheck(HeadlessBackend backend);
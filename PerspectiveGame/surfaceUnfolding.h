@@ -0,0 +1,89 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "tileLod.h"
+
+// Which tile (and which way round) the 2D view shows in each whole-number cell of world space, as seen
+// from the pov.  The pov tile is cell (0, 0) with the pov's map.  Every other cell is one step on from the
+// cell the 2D pov shader's ray (aimed at the cell's center) passed through just before it, so it lands on
+// the same tile as the shader does (exactly in flat areas, where every ray through a cell agrees).
+// Cells are done in order of distance from the pov so that cell is always already known.
+struct SurfaceUnfolding {
+	static const int MAX_CELLS = 1 << 16; // past this (very zoomed out) only the cells nearest the pov get done.
+	bool complete = true; // false if the last build() was too big to do, the cells are stale then.
+
+	glm::ivec2 minCell = glm::ivec2(0), maxCell = glm::ivec2(0); // inclusive.
+	std::vector<int> cellTiles; // -1 where the walk fell off the network.
+	std::vector<MapType> cellMaps;
+
+	int width() const { return maxCell.x - minCell.x + 1; }
+	int height() const { return maxCell.y - minCell.y + 1; }
+	int numCells() const { return width() * height(); }
+	int cellIndex(int x, int y) const { return (y - minCell.y) * width() + (x - minCell.x); }
+
+	// Unfolds every cell touched by the world space box [worldMin, worldMax].  Returns false without unfolding
+	// anything if that's more than MAX_CELLS, the cells would only cover part of the view.
+	bool build(const std::vector<GPU_Tile>& tiles, int povTile, MapType povMap, glm::vec2 povPos,
+			   glm::vec2 worldMin, glm::vec2 worldMax)
+	{
+		minCell = glm::min(glm::ivec2(glm::floor(worldMin)), glm::ivec2(0));
+		maxCell = glm::max(glm::ivec2(glm::floor(worldMax)), glm::ivec2(0));
+		// Too many, keep the square around the pov:
+		int maxRadius = (int)std::sqrt((float)MAX_CELLS) / 2 - 1;
+		glm::ivec2 wantedMin = minCell, wantedMax = maxCell;
+		minCell = glm::max(minCell, glm::ivec2(-maxRadius));
+		maxCell = glm::min(maxCell, glm::ivec2(maxRadius));
+		complete = minCell == wantedMin && maxCell == wantedMax;
+		if (!complete) return false;
+
+		cellTiles.assign(numCells(), -1);
+		cellMaps.assign(numCells(), MAP_TYPE_IDENTITY);
+		cellTiles[cellIndex(0, 0)] = povTile;
+		cellMaps[cellIndex(0, 0)] = povMap;
+
+		int maxDist = std::max(-minCell.x, maxCell.x) + std::max(-minCell.y, maxCell.y);
+		for (int d = 1; d <= maxDist; d++) {
+			for (int x = std::max(minCell.x, -d); x <= std::min(maxCell.x, d); x++) {
+				int rest = d - std::abs(x);
+				if (rest <= maxCell.y) unfoldCell(tiles, povPos, x, rest);
+				if (rest != 0 && -rest >= minCell.y) unfoldCell(tiles, povPos, x, -rest);
+			}
+		}
+		return complete;
+	}
+
+private:
+	void unfoldCell(const std::vector<GPU_Tile>& tiles, glm::vec2 povPos, int x, int y)
+	{
+		// Which edge did the ray cross last, the x one or the y one?  Ties go to x, the shader steps y first.
+		bool fromX;
+		if (x == 0) fromX = false;
+		else if (y == 0) fromX = true;
+		else {
+			glm::vec2 toCenter = glm::vec2(x + 0.5f, y + 0.5f) - povPos;
+			float tx = ((x > 0 ? x : x + 1) - povPos.x) / toCenter.x;
+			float ty = ((y > 0 ? y : y + 1) - povPos.y) / toCenter.y;
+			fromX = tx >= ty;
+		}
+
+		int px = fromX ? x - (x > 0 ? 1 : -1) : x;
+		int py = fromX ? y : y - (y > 0 ? 1 : -1);
+		int tile = cellTiles[cellIndex(px, py)];
+		if (tile == -1) return;
+
+		MapType map = cellMaps[cellIndex(px, py)];
+		LocalDirection dir = fromX ? (x > 0 ? LOCAL_DIRECTION_0 : LOCAL_DIRECTION_2)
+			: (y > 0 ? LOCAL_DIRECTION_3 : LOCAL_DIRECTION_1);
+		if (!tileLod::step(tiles, tile, map, dir)) return;
+
+		cellTiles[cellIndex(x, y)] = tile;
+		cellMaps[cellIndex(x, y)] = map;
+	}
+};
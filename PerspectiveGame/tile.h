@@ -59,35 +59,119 @@ public:
 	void setNeighborMap(LocalDirection d, MapType m) { neighborMaps[d] = m; }
 };
 
-struct alignas(32) GPU_Tile
+// Static per-tile data, only re-uploaded when the world is edited.  Mirrors Tile in the 2D pov shader (std430).
+// Packed down to 24 bytes since the shader reads neighbors/maps on every step of its walk:
+//  - mapsAndTexOrientation: bits [3d, 3d+3) hold the map across side d, bits 12-14 the texture orientation.
+//  - color: RGBA8, unpacked with unpackUnorm4x8().
+struct GPU_Tile
 {
-	alignas(4) int neighbors[4];
-	alignas(4) int maps[4];
+	static const unsigned int MAP_BITS = 3;
+	static const unsigned int MAP_MASK = 0x7;
+	static const unsigned int TEX_ORIENTATION_SHIFT = 4 * MAP_BITS;
 
-	alignas(4) int entityPositions[4];
-	alignas(4) int entityDirections[4];
-
-	alignas(32) glm::vec2 texCoords[4];
-
-	alignas(16) glm::vec4 color;
-	alignas(4) int numEntities;
-	alignas(4) int padding[3];
+	int neighbors[4];
+	unsigned int mapsAndTexOrientation;
+	unsigned int color;
 
+	GPU_Tile() {}
 	GPU_Tile(Tile& tile)
 	{
+		mapsAndTexOrientation = 0;
 		for (LocalDirection d : tnav::ORTHOGONAL_DIRECTION_SET) {
 			neighbors[d] = tile.getNeighborIndex(d);
-			maps[d] = tile.getNeighborMap(d);
-			texCoords[d] = tile.textureCoordinates[d];
+			mapsAndTexOrientation |= (tile.getNeighborMap(d) & MAP_MASK) << (MAP_BITS * d);
 		}
-		color = glm::vec4(tile.color, 1.0f);
-		numEntities = 0;
+		mapsAndTexOrientation |= getTexOrientation(tile.textureCoordinates) << TEX_ORIENTATION_SHIFT;
+		color = packColor(glm::vec4(tile.color, 1.0f));
 	}
 
-	void addEntity(LocalPosition pos, LocalDirection heading)
+	// Same as getTileTexCoord() in the 2D pov shader:
+	glm::vec2 getTexCoord(int i) const
 	{
-		entityPositions[numEntities] = pos;
-		entityDirections[numEntities] = heading;
-		numEntities++;
+		const glm::vec2 DEFAULT[4] = { glm::vec2(1, 1), glm::vec2(1, 0), glm::vec2(0, 0), glm::vec2(0, 1) };
+		unsigned int o = (mapsAndTexOrientation >> TEX_ORIENTATION_SHIFT) & MAP_MASK;
+		return DEFAULT[o < 4 ? (i + o) % 4 : (o - i) & 3];
 	}
+
+	// Which of the 8 rotations/reflections of the default texture square the coords are:
+	// 0-3 are texCoords[i] = DEFAULT[(i + o) % 4], 4-7 are texCoords[i] = DEFAULT[(o - i) % 4].
+	static unsigned int getTexOrientation(const glm::vec2 texCoords[4])
+	{
+		const glm::vec2 DEFAULT[4] = { glm::vec2(1, 1), glm::vec2(1, 0), glm::vec2(0, 0), glm::vec2(0, 1) };
+		for (unsigned int o = 0; o < 8; o++) {
+			bool matches = true;
+			for (int i = 0; i < 4 && matches; i++) {
+				int j = o < 4 ? (i + o) % 4 : (o - i) & 3;
+				matches = texCoords[i] == DEFAULT[j];
+			}
+			if (matches) return o;
+		}
+		std::cout << "ERROR::GPU_TILE:: texture coords are not a rotation/reflection of the default square!" << std::endl;
+		return 0;
+	}
+
+	static unsigned int packColor(glm::vec4 c)
+	{
+		c = glm::clamp(c, 0.0f, 1.0f);
+		return  (unsigned int)(c.r * 255.0f + 0.5f)
+			 | ((unsigned int)(c.g * 255.0f + 0.5f) << 8)
+			 | ((unsigned int)(c.b * 255.0f + 0.5f) << 16)
+			 | ((unsigned int)(c.a * 255.0f + 0.5f) << 24);
+	}
+};
+static_assert(sizeof(GPU_Tile) == 24, "GPU_Tile has to match the std430 layout in the shader!");
+
+// One entity as seen from one tile (entities on side nodes show up in both tiles).
+// Which tile it belongs to is given by the per tile offsets in EntityManager::gpuTileEntityOffsets.
+// These get turned into GPU_EntityQuads for the 2D pov shader.
+struct GPU_Entity
+{
+	int position;
+	int direction;
+	int entityIndex; // into EntityManager::entities.
+
+	GPU_Entity() : position(LOCAL_POSITION_ERROR), direction(LOCAL_DIRECTION_ERROR), entityIndex(-1) {}
+	GPU_Entity(LocalPosition pos, LocalDirection heading, int entityIndex)
+		: position(pos), direction(heading), entityIndex(entityIndex) {}
+};
+
+// What the 2D pov shader actually draws: one entity quad as seen from one tile, already in that tile's coords
+// (0-1 across the tile), including entities on neighboring tiles that reach over into it.
+// The quad is 1x1 and centered on (x, y) + updateProgress * (dx, dy).
+struct GPU_EntityQuad
+{
+	float x, y;
+	float dx, dy;
+
+	GPU_EntityQuad(glm::vec2 pos, glm::vec2 offset) : x(pos.x), y(pos.y), dx(offset.x), dy(offset.y) {}
+
+	// Same as LOCAL_POS_TO_COORD/LOCAL_DIR_TO_VEC in commonDefines.glsl:
+	static glm::vec2 localPosToCoord(int p)
+	{
+		const glm::vec2 COORDS[9] = {
+			glm::vec2(1.0f, 0.5f), glm::vec2(0.5f, 0.0f), glm::vec2(0.0f, 0.5f), glm::vec2(0.5f, 1.0f),
+			glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 0.0f), glm::vec2(0.0f, 1.0f), glm::vec2(1.0f, 1.0f),
+			glm::vec2(0.5f, 0.5f),
+		};
+		return COORDS[p];
+	}
+	static glm::vec2 localDirToVec(int d)
+	{
+		const glm::vec2 VECS[9] = {
+			glm::vec2(1, 0), glm::vec2(0, -1), glm::vec2(-1, 0), glm::vec2(0, 1),
+			glm::vec2(1, -1), glm::vec2(-1, -1), glm::vec2(-1, 1), glm::vec2(1, 1),
+			glm::vec2(0, 0),
+		};
+		return VECS[d];
+	}
+};
+
+// One entity quad placed in world space by SurfaceUnfolding, drawn instanced by the entityInstance shaders.
+// Clipped to its cell so spill-over only shows where the tile it was listed under does.
+struct GPU_EntityInstance
+{
+	glm::vec2 pos; // world space center at updateProgress 0.
+	glm::vec2 offset;
+	glm::vec2 cell; // bottom left corner of the cell it belongs to.
+	unsigned int color; // RGBA8
 };
\ No newline at end of file
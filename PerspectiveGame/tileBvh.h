@@ -0,0 +1,355 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cfloat>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "memoryAccounting.h"
+
+// Axis aligned bounding box.  Tiles are flat so their boxes are (almost) flat too.
+struct AABB {
+	glm::vec3 min, max;
+
+	AABB() : min(FLT_MAX), max(-FLT_MAX) {}
+	AABB(glm::vec3 min, glm::vec3 max) : min(min), max(max) {}
+
+	bool empty() const { return min.x > max.x; }
+	glm::vec3 center() const { return 0.5f * (min + max); }
+
+	void grow(const AABB& b)
+	{
+		min = glm::min(min, b.min);
+		max = glm::max(max, b.max);
+	}
+
+	void grow(glm::vec3 p)
+	{
+		min = glm::min(min, p);
+		max = glm::max(max, p);
+	}
+
+	// Slab test.  Returns the entry distance along the ray in tHit, which is 0 if origin is inside.
+	bool intersectRay(glm::vec3 origin, glm::vec3 invDir, float tMax, float& tHit) const
+	{
+		glm::vec3 t1 = (min - origin) * invDir;
+		glm::vec3 t2 = (max - origin) * invDir;
+		glm::vec3 tNear = glm::min(t1, t2);
+		glm::vec3 tFar = glm::max(t1, t2);
+		float tEnter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+		float tExit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+		tHit = tEnter;
+		return tEnter <= tExit;
+	}
+};
+
+// The six clip planes of a projection * view matrix, pointing inward.
+struct Frustum {
+	enum Containment {
+		FRUSTUM_OUTSIDE,
+		FRUSTUM_INTERSECTS,
+		FRUSTUM_INSIDE,
+	};
+
+	glm::vec4 planes[6];
+
+	Frustum() {}
+
+	// Gribb/Hartmann plane extraction.  Depth is [0, 1] (GLM_FORCE_DEPTH_ZERO_TO_ONE) so the near plane is just row 2.
+	Frustum(const glm::mat4& m)
+	{
+		glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+		glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+		glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+		glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+		planes[0] = row3 + row0; // left
+		planes[1] = row3 - row0; // right
+		planes[2] = row3 + row1; // bottom
+		planes[3] = row3 - row1; // top
+		planes[4] = row2;        // near
+		planes[5] = row3 - row2; // far
+
+		for (glm::vec4& p : planes) p /= glm::length(glm::vec3(p));
+	}
+
+	Containment classify(const AABB& box) const
+	{
+		Containment result = FRUSTUM_INSIDE;
+		for (const glm::vec4& p : planes) {
+			glm::vec3 n(p);
+			// the corners of the box furthest along and furthest against the plane normal:
+			glm::vec3 positive(n.x >= 0 ? box.max.x : box.min.x,
+							   n.y >= 0 ? box.max.y : box.min.y,
+							   n.z >= 0 ? box.max.z : box.min.z);
+			glm::vec3 negative(n.x >= 0 ? box.min.x : box.max.x,
+							   n.y >= 0 ? box.min.y : box.max.y,
+							   n.z >= 0 ? box.min.z : box.max.z);
+			if (glm::dot(n, positive) + p.w < 0) return FRUSTUM_OUTSIDE;
+			if (glm::dot(n, negative) + p.w < 0) result = FRUSTUM_INTERSECTS;
+		}
+		return result;
+	}
+};
+
+// Bounding volume hierarchy over tile slots.  Bounds are handed in per tile index by the owner (TileNodeNetwork),
+// edits only mark tiles dirty and the tree is refit lazily the next time it is queried.  Edits that the tree cannot
+// absorb with a refit (new tile slots, or so many refits the boxes have gone baggy) trigger a full rebuild instead.
+struct TileBVH {
+	static const int MAX_TILES_PER_LEAF = 4;
+	// Padding so that flat tiles still have some volume for the slab test:
+	static constexpr float TILE_BOUNDS_PADDING = 0.001f;
+
+	struct Node {
+		AABB bounds;
+		int left = -1, right = -1; // children, -1 if this is a leaf
+		int parent = -1;
+		int firstTile = 0, numTiles = 0; // range inside tileIndices, leaves only
+
+		bool isLeaf() const { return left == -1; }
+	};
+
+private:
+	std::vector<Node> nodes;
+	std::vector<int> tileIndices;
+	std::vector<AABB> tileBounds; // one per tile slot, empty() if the slot is unused.
+	std::vector<int> leafOfTile;  // one per tile slot, -1 if the slot is not in the tree.
+	std::vector<int> dirtyTiles;
+	std::vector<int> traversalStack;
+
+	bool needsRebuild = true;
+	int numLiveTiles = 0;
+	int numRefitsSinceRebuild = 0;
+
+public: // Stats for the debug window:
+	int numRebuilds = 0;
+	int numNodesVisitedLastQuery = 0;
+
+public:
+	int size() { return (int)nodes.size(); }
+	int numTiles() { return numLiveTiles; }
+
+	// Everything the tree holds on to, see memoryAccounting.h:
+	size_t memoryBytes() const
+	{
+		return vectorBytes(nodes) + vectorBytes(tileIndices) + vectorBytes(tileBounds) + vectorBytes(leafOfTile) +
+			vectorBytes(dirtyTiles) + vectorBytes(traversalStack);
+	}
+
+	void setTile(int tileIndex, AABB bounds)
+	{
+		if (tileIndex >= tileBounds.size()) {
+			tileBounds.resize(tileIndex + 1);
+			leafOfTile.resize(tileIndex + 1, -1);
+		}
+		if (tileBounds[tileIndex].empty()) numLiveTiles++;
+
+		bounds.min -= glm::vec3(TILE_BOUNDS_PADDING);
+		bounds.max += glm::vec3(TILE_BOUNDS_PADDING);
+		tileBounds[tileIndex] = bounds;
+
+		// slots that were never part of the tree cant be refit into it:
+		if (leafOfTile[tileIndex] == -1) needsRebuild = true;
+		else dirtyTiles.push_back(tileIndex);
+	}
+
+	void removeTile(int tileIndex)
+	{
+		if (tileIndex >= tileBounds.size() || tileBounds[tileIndex].empty()) return;
+
+		tileBounds[tileIndex] = AABB();
+		numLiveTiles--;
+		if (leafOfTile[tileIndex] != -1) dirtyTiles.push_back(tileIndex);
+	}
+
+	// Brings the tree up to date with all the edits since the last query.
+	void refit()
+	{
+		if (!needsRebuild && numRefitsSinceRebuild + (int)dirtyTiles.size() > numLiveTiles / 2) {
+			needsRebuild = true;
+		}
+		if (needsRebuild) {
+			rebuild();
+			return;
+		}
+
+		for (int tileIndex : dirtyTiles) {
+			int nodeIndex = leafOfTile[tileIndex];
+			Node& leaf = nodes[nodeIndex];
+			leaf.bounds = AABB();
+			for (int i = leaf.firstTile; i < leaf.firstTile + leaf.numTiles; i++) {
+				if (!tileBounds[tileIndices[i]].empty()) leaf.bounds.grow(tileBounds[tileIndices[i]]);
+			}
+			// walk up the tree, growing/shrinking each parent to its children:
+			nodeIndex = leaf.parent;
+			while (nodeIndex != -1) {
+				Node& n = nodes[nodeIndex];
+				n.bounds = nodes[n.left].bounds;
+				n.bounds.grow(nodes[n.right].bounds);
+				nodeIndex = n.parent;
+			}
+			numRefitsSinceRebuild++;
+		}
+		dirtyTiles.clear();
+	}
+
+	void rebuild()
+	{
+		nodes.clear();
+		tileIndices.clear();
+		std::fill(leafOfTile.begin(), leafOfTile.end(), -1);
+		for (int i = 0; i < tileBounds.size(); i++) {
+			if (!tileBounds[i].empty()) tileIndices.push_back(i);
+		}
+
+		nodes.reserve(2 * (tileIndices.size() / MAX_TILES_PER_LEAF + 1));
+		if (tileIndices.size() > 0) buildNode(-1, 0, (int)tileIndices.size());
+
+		dirtyTiles.clear();
+		needsRebuild = false;
+		numRefitsSinceRebuild = 0;
+		numRebuilds++;
+	}
+
+	// Fills visibleTiles with every tile whose bounds touch the frustum of viewProjection.
+	void cullFrustum(const glm::mat4& viewProjection, std::vector<int>& visibleTiles)
+	{
+		visibleTiles.clear();
+		refit();
+		numNodesVisitedLastQuery = 0;
+		if (nodes.size() == 0) return;
+
+		Frustum frustum(viewProjection);
+		traversalStack.clear();
+		traversalStack.push_back(0);
+		while (traversalStack.size() > 0) {
+			int nodeIndex = traversalStack.back();
+			traversalStack.pop_back();
+			Node& n = nodes[nodeIndex];
+			numNodesVisitedLastQuery++;
+
+			if (n.bounds.empty()) continue;
+			Frustum::Containment c = frustum.classify(n.bounds);
+			if (c == Frustum::FRUSTUM_OUTSIDE) continue;
+			if (c == Frustum::FRUSTUM_INSIDE) {
+				// no need to test anything further down, it is all visible:
+				gatherTiles(nodeIndex, visibleTiles);
+				continue;
+			}
+
+			if (n.isLeaf()) {
+				for (int i = n.firstTile; i < n.firstTile + n.numTiles; i++) {
+					int t = tileIndices[i];
+					if (!tileBounds[t].empty() && frustum.classify(tileBounds[t]) != Frustum::FRUSTUM_OUTSIDE)
+						visibleTiles.push_back(t);
+				}
+			}
+			else {
+				traversalStack.push_back(n.left);
+				traversalStack.push_back(n.right);
+			}
+		}
+	}
+
+	// Returns the index of the closest tile hit by the ray, or -1 if nothing is hit.
+	// Both tiles of a pair share bounds, so callers have to pick the side facing the ray themselves.
+	int raycast(glm::vec3 origin, glm::vec3 dir, float& tHit, float tMax = FLT_MAX)
+	{
+		refit();
+		numNodesVisitedLastQuery = 0;
+		int closestTile = -1;
+		tHit = tMax;
+		if (nodes.size() == 0) return -1;
+
+		glm::vec3 invDir = 1.0f / dir;
+		float t;
+		traversalStack.clear();
+		traversalStack.push_back(0);
+		while (traversalStack.size() > 0) {
+			Node& n = nodes[traversalStack.back()];
+			traversalStack.pop_back();
+			numNodesVisitedLastQuery++;
+
+			if (n.bounds.empty() || !n.bounds.intersectRay(origin, invDir, tHit, t)) continue;
+
+			if (n.isLeaf()) {
+				for (int i = n.firstTile; i < n.firstTile + n.numTiles; i++) {
+					int tileIndex = tileIndices[i];
+					if (tileBounds[tileIndex].empty()) continue;
+					if (tileBounds[tileIndex].intersectRay(origin, invDir, tHit, t) && t < tHit) {
+						tHit = t;
+						closestTile = tileIndex;
+					}
+				}
+				continue;
+			}
+
+			// visit the closer child first so tHit shrinks sooner:
+			float tLeft = FLT_MAX, tRight = FLT_MAX;
+			bool hitLeft = nodes[n.left].bounds.intersectRay(origin, invDir, tHit, tLeft);
+			bool hitRight = nodes[n.right].bounds.intersectRay(origin, invDir, tHit, tRight);
+			int left = n.left, right = n.right;
+			if (hitLeft && hitRight) {
+				if (tLeft < tRight) std::swap(left, right);
+				traversalStack.push_back(left);
+				traversalStack.push_back(right);
+			}
+			else if (hitLeft) traversalStack.push_back(left);
+			else if (hitRight) traversalStack.push_back(right);
+		}
+		return closestTile;
+	}
+
+private:
+	int buildNode(int parent, int first, int count)
+	{
+		int nodeIndex = (int)nodes.size();
+		nodes.push_back(Node());
+		nodes[nodeIndex].parent = parent;
+
+		AABB bounds, centers;
+		for (int i = first; i < first + count; i++) {
+			bounds.grow(tileBounds[tileIndices[i]]);
+			centers.grow(tileBounds[tileIndices[i]].center());
+		}
+		nodes[nodeIndex].bounds = bounds;
+
+		if (count <= MAX_TILES_PER_LEAF) {
+			nodes[nodeIndex].firstTile = first;
+			nodes[nodeIndex].numTiles = count;
+			for (int i = first; i < first + count; i++) leafOfTile[tileIndices[i]] = nodeIndex;
+			return nodeIndex;
+		}
+
+		// median split along the longest axis of the tile centers:
+		glm::vec3 extent = centers.max - centers.min;
+		int axis = (extent.x > extent.y && extent.x > extent.z) ? 0 : (extent.y > extent.z) ? 1 : 2;
+		int half = count / 2;
+		std::nth_element(tileIndices.begin() + first, tileIndices.begin() + first + half, tileIndices.begin() + first + count,
+						 [this, axis](int a, int b) { return tileBounds[a].center()[axis] < tileBounds[b].center()[axis]; });
+
+		// nodes may reallocate during the recursion, so no references across these calls:
+		int left = buildNode(nodeIndex, first, half);
+		int right = buildNode(nodeIndex, first + half, count - half);
+		nodes[nodeIndex].left = left;
+		nodes[nodeIndex].right = right;
+		return nodeIndex;
+	}
+
+	void gatherTiles(int nodeIndex, std::vector<int>& out)
+	{
+		Node& n = nodes[nodeIndex];
+		if (!n.isLeaf()) {
+			gatherTiles(n.left, out);
+			gatherTiles(n.right, out);
+			return;
+		}
+		for (int i = n.firstTile; i < n.firstTile + n.numTiles; i++) {
+			if (!tileBounds[tileIndices[i]].empty()) out.push_back(tileIndices[i]);
+		}
+	}
+};
@@ -0,0 +1,154 @@
+#include "tileLod.h"
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <chrono>
+#include <random>
+#include <cstdlib>
+
+#include "forceManager.h"
+#include "tileNodeNetwork.h"
+#include "scenarioSetup.h"
+
+namespace {
+	// n single steps, what the jumps are supposed to add up to:
+	int walk(const std::vector<GPU_Tile>& tiles, int tile, MapType& map, LocalDirection d, int n)
+	{
+		for (int i = 0; i < n; i++) tileLod::step(tiles, tile, map, d);
+		return tile;
+	}
+
+	// n steps using the jumps, one per set bit, same as the shader does it:
+	int jumpWalk(const std::vector<GPU_TileLod>& lods, int tile, MapType& map, LocalDirection d, int n)
+	{
+		for (int k = 0; n > 0; k++, n >>= 1) {
+			if ((n & 1) == 0) continue;
+			int jump = lods[tile].jumps[tnav::map(map, (LocalAlignment)d) * NUM_TILE_JUMP_LEVELS + k];
+			map = tnav::combine(map, GPU_TileLod::jumpMap(jump));
+			tile = GPU_TileLod::jumpTile(jump);
+		}
+		return tile;
+	}
+
+	struct LodCheckCounts {
+		int64_t jumps = 0, badJumps = 0;
+		int64_t squares = 0, notFlat = 0, badSquareJumps = 0;
+	};
+
+	// Everything build() claims, the slow way, from every starting map (the ray can come in with any of them):
+	//  * every jump lands where 2^k single steps do,
+	//  * inside flatRadius, x then y steps land on the same tile/map as y then x, and so do the jumps.
+	void checkLods(const std::vector<GPU_Tile>& tiles, const std::vector<GPU_TileLod>& lods, LodCheckCounts& c)
+	{
+		for (int i = 0; i < (int)tiles.size(); i++) {
+			for (int m = 0; m < tnav::d4::NUM_MAPS; m++) {
+				for (int d = 0; d < 4; d++) {
+					for (int k = 0; k < NUM_TILE_JUMP_LEVELS; k++) {
+						MapType walkMap = (MapType)m, jumpMap = (MapType)m;
+						int a = walk(tiles, i, walkMap, (LocalDirection)d, 1 << k);
+						int b = jumpWalk(lods, i, jumpMap, (LocalDirection)d, 1 << k);
+						c.jumps++;
+						if (a != b || walkMap != jumpMap) c.badJumps++;
+					}
+				}
+
+				int r = lods[i].flatRadius;
+				for (int dx = -r; dx <= r; dx++) {
+					for (int dy = -r; dy <= r; dy++) {
+						LocalDirection xd = dx >= 0 ? LOCAL_DIRECTION_0 : LOCAL_DIRECTION_2;
+						LocalDirection yd = dy >= 0 ? LOCAL_DIRECTION_3 : LOCAL_DIRECTION_1;
+						MapType m1 = (MapType)m, m2 = (MapType)m, m3 = (MapType)m;
+						int a = walk(tiles, walk(tiles, i, m1, xd, abs(dx)), m1, yd, abs(dy));
+						int b = walk(tiles, walk(tiles, i, m2, yd, abs(dy)), m2, xd, abs(dx));
+						int j = jumpWalk(lods, jumpWalk(lods, i, m3, xd, abs(dx)), m3, yd, abs(dy));
+						c.squares++;
+						if (a != b || m1 != m2) c.notFlat++;
+						if (j != a || m3 != m1) c.badSquareJumps++;
+					}
+				}
+			}
+		}
+	}
+
+	// W x H flat torus, every map identity, then a few links pointed at random tiles with random maps so there's
+	// something for the flat radii to stop at.  Radii here go all the way up to MAX_TILE_FLAT_RADIUS, which the
+	// scenario worlds (small, with edges everywhere) don't.
+	std::vector<GPU_Tile> brokenTorus(int w, int h, int numBrokenLinks, std::mt19937& rng)
+	{
+		std::vector<GPU_Tile> tiles(w * h);
+		for (int y = 0; y < h; y++) {
+			for (int x = 0; x < w; x++) {
+				GPU_Tile& t = tiles[y * w + x];
+				t.neighbors[LOCAL_DIRECTION_0] = y * w + (x + 1) % w;
+				t.neighbors[LOCAL_DIRECTION_1] = ((y + h - 1) % h) * w + x;
+				t.neighbors[LOCAL_DIRECTION_2] = y * w + (x + w - 1) % w;
+				t.neighbors[LOCAL_DIRECTION_3] = ((y + 1) % h) * w + x;
+				t.mapsAndTexOrientation = 0;
+				t.color = 0;
+			}
+		}
+		std::uniform_int_distribution<int> tileDist(0, w * h - 1), dirDist(0, 3), mapDist(0, tnav::d4::NUM_MAPS - 1);
+		for (int i = 0; i < numBrokenLinks; i++) {
+			GPU_Tile& t = tiles[tileDist(rng)];
+			int d = dirDist(rng);
+			t.neighbors[d] = tileDist(rng);
+			t.mapsAndTexOrientation &= ~(GPU_Tile::MAP_MASK << (GPU_Tile::MAP_BITS * d));
+			t.mapsAndTexOrientation |= (unsigned int)mapDist(rng) << (GPU_Tile::MAP_BITS * d);
+		}
+		return tiles;
+	}
+}
+
+bool tileLod::runLodCheck(const std::string& scenarioDirectory)
+{
+	using clock = std::chrono::steady_clock;
+	auto start = clock::now();
+	LodCheckCounts counts;
+	int64_t numTiles = 0;
+
+	// The scenario worlds, built by the node network itself, so this follows whatever it does to the topology:
+	std::vector<std::string> files = listScenarioFiles(scenarioDirectory);
+	if (files.empty()) {
+		std::cout << "ERROR::LOD_CHECK:: no .scenario files in " << scenarioDirectory << std::endl;
+		return false;
+	}
+	for (const std::string& file : files) {
+		Scenario scenario;
+		if (!scenario.load(file)) return false;
+		Camera camera;
+		ForceManager forceManager;
+		std::unique_ptr<TileNodeNetwork> network = std::make_unique<TileNodeNetwork>(&camera, &forceManager);
+		network->clear();
+		network->createTilePairs(scenario.tiles);
+		network->rebuildGpuTilesIfDirty();
+		checkLods(network->gpuTiles, network->gpuTileLods, counts);
+		numTiles += network->gpuTiles.size();
+	}
+
+	std::mt19937 rng(1234);
+	std::vector<GPU_Tile> torus = brokenTorus(40, 40, 6, rng);
+	std::vector<GPU_TileLod> torusLods;
+	build(torus, torusLods);
+	checkLods(torus, torusLods, counts);
+	numTiles += torus.size();
+
+	double seconds = std::chrono::duration<double>(clock::now() - start).count();
+	std::cout << "Lod check: " << files.size() << " scenario worlds and a broken torus, " << numTiles << " tiles, "
+		<< seconds << " s\n";
+	std::cout << "  " << counts.jumps << " jumps, " << counts.badJumps << " wrong\n";
+	std::cout << "  " << counts.squares << " steps inside flat radii, " << counts.notFlat << " not flat, "
+		<< counts.badSquareJumps << " wrong with jumps" << std::endl;
+
+	bool passed = true;
+	if (counts.badJumps > 0) {
+		std::cout << "ERROR::LOD_CHECK:: " << counts.badJumps << " jumps don't land where stepping does" << std::endl;
+		passed = false;
+	}
+	if (counts.notFlat > 0 || counts.badSquareJumps > 0) {
+		std::cout << "ERROR::LOD_CHECK:: " << counts.notFlat + counts.badSquareJumps
+			<< " steps inside flat radii don't match stepping them out" << std::endl;
+		passed = false;
+	}
+	return passed;
+}
@@ -0,0 +1,151 @@
+#pragma once
+#include <iostream>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <string>
+
+#include "tileNavigation.h"
+#include "tile.h"
+#include "jobSystem.h"
+
+// Level of detail info for the 2D view's ray march, so zoomed out views don't have to walk every tile:
+//  * jumps: where 1, 2, 4, ... straight steps from a tile end up (and the map picked up on the way),
+//    so a walk of n tiles in one direction takes popcount(n) lookups.
+//  * flatRadius: every tile within this many steps (in x and y) is reached by the same tile/map no
+//    matter the order of steps, so inside that square ("supertile") the ray is plain euclidean and can skip
+//    ahead with jumps instead of stepping tile by tile.
+// The tile texture mip chain does the per tile average color part, see colorPixel() in the shader.
+const int NUM_TILE_JUMP_LEVELS = 5; // jumps of 1, 2, 4, 8 and 16 tiles.
+const int MAX_TILE_FLAT_RADIUS = 1 << (NUM_TILE_JUMP_LEVELS - 1); // keeps every jump a sum of the levels we have.
+
+struct GPU_TileLod
+{
+	// jumps[d * NUM_TILE_JUMP_LEVELS + k] is (tile index << 3) | map for 2^k steps in local direction d:
+	int jumps[4 * NUM_TILE_JUMP_LEVELS];
+	int flatRadius;
+
+	static int packJump(int tileIndex, int map) { return (tileIndex << 3) | map; }
+	static int jumpTile(int jump) { return jump >> 3; }
+	static MapType jumpMap(int jump) { return (MapType)(jump & 0x7); }
+};
+
+namespace tileLod {
+	inline MapType neighborMap(const GPU_Tile& t, int d)
+	{
+		return (MapType)((t.mapsAndTexOrientation >> (GPU_Tile::MAP_BITS * d)) & GPU_Tile::MAP_MASK);
+	}
+
+	inline bool validNeighbor(const std::vector<GPU_Tile>& tiles, int i, int d)
+	{
+		int n = tiles[i].neighbors[d];
+		return n >= 0 && n < (int)tiles.size();
+	}
+
+	// One step in direction d of whatever frame 'map' takes us to, same as shiftCurrentTile() in the shader:
+	inline bool step(const std::vector<GPU_Tile>& tiles, int& tile, MapType& map, LocalDirection d)
+	{
+		int localDir = tnav::map(map, (LocalAlignment)d);
+		if (!validNeighbor(tiles, tile, localDir)) return false;
+		map = tnav::combine(map, neighborMap(tiles[tile], localDir));
+		tile = tiles[tile].neighbors[localDir];
+		return true;
+	}
+
+	// A corner where going one way then the other doesn't land on the same tile the same way round,
+	// like the three tiles meeting at a cube corner.  Also any tile missing a neighbor.
+	inline bool hasNonFlatCorner(const std::vector<GPU_Tile>& tiles, int i)
+	{
+		for (int d = 0; d < 4; d++) {
+			LocalDirection a = (LocalDirection)d, b = (LocalDirection)((d + 1) % 4);
+			int t1 = i, t2 = i;
+			MapType m1 = MAP_TYPE_IDENTITY, m2 = MAP_TYPE_IDENTITY;
+			if (!step(tiles, t1, m1, a) || !step(tiles, t1, m1, b)) return true;
+			if (!step(tiles, t2, m2, b) || !step(tiles, t2, m2, a)) return true;
+			if (t1 != t2 || m1 != m2) return true;
+		}
+		return false;
+	}
+
+	// Rebuilds every tile's lod info.  Linear in the number of tiles, run whenever gpuTiles is.
+	inline void build(const std::vector<GPU_Tile>& tiles, std::vector<GPU_TileLod>& lods)
+	{
+		int n = (int)tiles.size();
+		lods.resize(n);
+
+		// Jumps, each level is two of the last one.  The second half starts in the first half's frame,
+		// so its direction gets mapped and its map gets combined on.  A level only reads the one before, so each
+		// one is split across the job system:
+		GlobalJobSystem.parallelFor(n, 2048, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				for (int d = 0; d < 4; d++) {
+					lods[i].jumps[d * NUM_TILE_JUMP_LEVELS] = validNeighbor(tiles, i, d)
+						? GPU_TileLod::packJump(tiles[i].neighbors[d], neighborMap(tiles[i], d))
+						: GPU_TileLod::packJump(i, MAP_TYPE_IDENTITY);
+				}
+			}
+		});
+		for (int k = 1; k < NUM_TILE_JUMP_LEVELS; k++) {
+			GlobalJobSystem.parallelFor(n, 2048, [&](int begin, int end) {
+				for (int i = begin; i < end; i++) {
+					for (int d = 0; d < 4; d++) {
+						int half = lods[i].jumps[d * NUM_TILE_JUMP_LEVELS + k - 1];
+						int mid = GPU_TileLod::jumpTile(half);
+						MapType midMap = GPU_TileLod::jumpMap(half);
+						int midDir = tnav::map(midMap, (LocalAlignment)d);
+						int rest = lods[mid].jumps[midDir * NUM_TILE_JUMP_LEVELS + k - 1];
+						lods[i].jumps[d * NUM_TILE_JUMP_LEVELS + k] = GPU_TileLod::packJump(
+							GPU_TileLod::jumpTile(rest), tnav::combine(midMap, GPU_TileLod::jumpMap(rest)));
+					}
+				}
+			});
+		}
+
+		// Flat radius is one less than the distance (8-connected) to the nearest non-flat tile,
+		// so a multi-source bfs out from all of those:
+		std::vector<int> dist(n, MAX_TILE_FLAT_RADIUS + 1);
+		std::deque<int> frontier;
+		std::vector<char> nonFlat(n);
+		GlobalJobSystem.parallelFor(n, 2048, [&](int begin, int end) {
+			for (int i = begin; i < end; i++) nonFlat[i] = hasNonFlatCorner(tiles, i);
+		});
+		for (int i = 0; i < n; i++) {
+			if (nonFlat[i]) {
+				dist[i] = 0;
+				frontier.push_back(i);
+			}
+		}
+		while (!frontier.empty()) {
+			int i = frontier.front();
+			frontier.pop_front();
+			if (dist[i] >= MAX_TILE_FLAT_RADIUS) continue;
+
+			auto visit = [&](int t) {
+				if (dist[t] > dist[i] + 1) {
+					dist[t] = dist[i] + 1;
+					frontier.push_back(t);
+				}
+			};
+			for (int d = 0; d < 4; d++) {
+				// Orthogonal neighbor, then both ways round to the diagonal (they can differ here):
+				int t = i;
+				MapType m = MAP_TYPE_IDENTITY;
+				if (!step(tiles, t, m, (LocalDirection)d)) continue;
+				visit(t);
+				if (step(tiles, t, m, (LocalDirection)((d + 1) % 4))) visit(t);
+				t = i;
+				m = MAP_TYPE_IDENTITY;
+				if (step(tiles, t, m, (LocalDirection)((d + 1) % 4)) && step(tiles, t, m, (LocalDirection)d)) visit(t);
+			}
+		}
+		for (int i = 0; i < n; i++) {
+			lods[i].flatRadius = std::max(0, std::min(dist[i], MAX_TILE_FLAT_RADIUS + 1) - 1);
+		}
+	}
+
+	// Checks what build() makes against stepping it out one tile at a time: every jump of every tile, and every step
+	// inside every flat radius (both orders, and by jumps), from all 8 starting maps.  Worlds are every .scenario
+	// file in scenarioDirectory (built by the node network) and a torus with some broken links.  No gl needed.
+	// Prints the counts, returns false if anything didn't match.
+	bool runLodCheck(const std::string& scenarioDirectory);
+}
@@ -1,4 +1,5 @@
 #include "tileNavigation.h"
+#include <sstream>
 
 const LocalAlignment tnav::LOCAL_ALIGNMENT_SET[] = {
 		LOCAL_ALIGNMENT_0, LOCAL_ALIGNMENT_1, LOCAL_ALIGNMENT_2, LOCAL_ALIGNMENT_3,
@@ -59,40 +60,6 @@ const LocalAlignment META_TO_LOCAL_ALIGNMENT[6][19] = {
 	#undef error
 };
 
-// Breaks down diagonal directions into their components.
-// Orthogonal components are just duplicated.
-const LocalDirection ALIGNMENT_COMPONENTS[8][2] = {
-	// Orthogonal:
-	{ LOCAL_ALIGNMENT_0, LOCAL_ALIGNMENT_0 }, // LOCAL_DIRECTION_0
-	{ LOCAL_ALIGNMENT_1, LOCAL_ALIGNMENT_1 }, // LOCAL_DIRECTION_1
-	{ LOCAL_ALIGNMENT_2, LOCAL_ALIGNMENT_2 }, // LOCAL_DIRECTION_2
-	{ LOCAL_ALIGNMENT_3, LOCAL_ALIGNMENT_3 }, // LOCAL_DIRECTION_3
-	// Diagonal:
-	{ LOCAL_ALIGNMENT_0, LOCAL_ALIGNMENT_1 }, // LOCAL_DIRECTION_0_1
-	{ LOCAL_ALIGNMENT_1, LOCAL_ALIGNMENT_2 }, // LOCAL_DIRECTION_1_2
-	{ LOCAL_ALIGNMENT_2, LOCAL_ALIGNMENT_3 }, // LOCAL_DIRECTION_2_3
-	{ LOCAL_ALIGNMENT_3, LOCAL_ALIGNMENT_0 }  // LOCAL_DIRECTION_3_0
-};
-
-const LocalAlignment* tnav::getAlignmentComponents(LocalAlignment alignment)
-{
-	return ALIGNMENT_COMPONENTS[alignment];
-}
-
-// Given two orthogonal LocalDirections, combines them into an orthogonal or diagonal direction.
-// Directions facing opposite ways are combined into the static enum.
-const LocalDirection COMBINED_ALIGNMENTS[4][4] = {
-	{ LOCAL_ALIGNMENT_0, LOCAL_ALIGNMENT_0_1, LOCAL_ALIGNMENT_NONE, LOCAL_ALIGNMENT_3_0 },
-	{ LOCAL_ALIGNMENT_0_1, LOCAL_ALIGNMENT_1, LOCAL_ALIGNMENT_1_2, LOCAL_ALIGNMENT_NONE },
-	{ LOCAL_ALIGNMENT_NONE, LOCAL_ALIGNMENT_1_2, LOCAL_ALIGNMENT_2, LOCAL_ALIGNMENT_2_3 },
-	{ LOCAL_ALIGNMENT_3_0, LOCAL_ALIGNMENT_NONE, LOCAL_ALIGNMENT_2_3, LOCAL_ALIGNMENT_3 }
-};
-
-const LocalAlignment tnav::combine(LocalAlignment a, LocalAlignment b)
-{
-	return COMBINED_ALIGNMENTS[a][b];
-}
-
 // [local Position][local direction]
 const LocalPosition NEXT_LOCAL_POSITIONS[9][8] = {
 #define _0_ LOCAL_POSITION_0
@@ -347,19 +314,6 @@ const GlobalAlignment LOCAL_DIR_TO_GLOBAL_DIR[6][4] = {
 	{ GLOBAL_ALIGNMENT_pY, GLOBAL_ALIGNMENT_nZ, GLOBAL_ALIGNMENT_nY, GLOBAL_ALIGNMENT_pZ },
 };
 
-const bool HAS_COMPONENT[10][10] = {
-	{ 1, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
-	{ 0, 1, 0, 0, 0, 0, 0, 0, 0, 0 },
-	{ 0, 0, 1, 0, 0, 0, 0, 0, 0, 0 },
-	{ 0, 0, 0, 1, 0, 0, 0, 0, 0, 0 },
-	{ 1, 1, 0, 0, 1, 0, 0, 0, 0, 0 },
-	{ 0, 1, 1, 0, 0, 1, 0, 0, 0, 0 },
-	{ 0, 0, 1, 1, 0, 0, 1, 0, 0, 0 },
-	{ 1, 0, 0, 1, 0, 0, 0, 1, 0, 0 },
-	{ 0, 0, 0, 0, 0, 0, 0, 0, 1, 0 },
-	{ 0, 0, 0, 0, 0, 0, 0, 0, 0, 1 }
-};
-
 // TODO: change local directions to always use flags instead of enums.  I think this will help?
 const uint8_t LOCAL_DIRECTION_TO_LOCAL_DIRECTION_FLAG[10] = {
 	0b0001, 0b0010, 0b0100, 0b1000, 0b0011, 0b0110, 0b1100, 0b1001, 0b0000, 0b1111
@@ -389,21 +343,6 @@ glm::vec3 tnav::globalDirToVec3(GlobalAlignment g)
 	}
 }
 
-bool tnav::isOrthogonal(LocalDirection direction) { return direction < 4; }
-
-bool tnav::isDiagonal(LocalDirection direction) { return 3 < direction && direction < 8; }
-
-LocalDirection tnav::inverse(LocalAlignment alignment)
-{
-	int diagonalOffset = (alignment > 3) * 4;
-	return LocalDirection((alignment + 2) % 4 + diagonalOffset);
-}
-
-const bool tnav::alignmentHasComponent(LocalAlignment alignment, LocalAlignment component)
-{
-	return HAS_COMPONENT[alignment][component];
-}
-
 const uint8_t tnav::getDirectionFlag(LocalDirection direction)
 {
 	return LOCAL_DIRECTION_TO_LOCAL_DIRECTION_FLAG[direction];
@@ -427,116 +366,6 @@ const LocalDirection tnav::getDirection(uint8_t directionFlag)
 	}
 }
 
-// ALIGNMENT_TRANSLATION_MAPS[map index][alignment to map]
-// Allows for a quick way to convert direction enums from one local tile space to a neighboring one.
-// Because there are only 2 axes in a 2D tile, there are only 8 ways to map x+, x-, y+, y- to each other
-// with the restriction that the 'next' direction has to be +1 or -1 'away' from the previous where
-// (x+, x-, y+, y-) -> (0, 2, 3, 1) (this ordering makes more sense in other contexts).
-const LocalAlignment ALIGNMENT_TRANSLATION_MAPS[8][10] = {
-#define _0 LOCAL_ALIGNMENT_0
-#define _1 LOCAL_ALIGNMENT_1
-#define _2 LOCAL_ALIGNMENT_2
-#define _3 LOCAL_ALIGNMENT_3
-#define _0_1 LOCAL_ALIGNMENT_0_1
-#define _1_2 LOCAL_ALIGNMENT_1_2
-#define _2_3 LOCAL_ALIGNMENT_2_3
-#define _3_0 LOCAL_ALIGNMENT_3_0
-#define NONE LOCAL_ALIGNMENT_NONE
-#define ALIGNMENT_ERROR LOCAL_ALIGNMENT_ERROR
-	{ _0, _1, _2, _3, _0_1, _1_2, _2_3, _3_0, NONE, ALIGNMENT_ERROR },
-	{ _1, _2, _3, _0, _1_2, _2_3, _3_0, _0_1, NONE, ALIGNMENT_ERROR },
-	{ _2, _3, _0, _1, _2_3, _3_0, _0_1, _1_2, NONE, ALIGNMENT_ERROR },
-	{ _3, _0, _1, _2, _3_0, _0_1, _1_2, _2_3, NONE, ALIGNMENT_ERROR },
-	{ _0, _3, _2, _1, _3_0, _2_3, _1_2, _0_1, NONE, ALIGNMENT_ERROR },
-	{ _1, _0, _3, _2, _0_1, _3_0, _2_3, _1_2, NONE, ALIGNMENT_ERROR },
-	{ _2, _1, _0, _3, _1_2, _0_1, _3_0, _2_3, NONE, ALIGNMENT_ERROR },
-	{ _3, _2, _1, _0, _2_3, _1_2, _0_1, _3_0, NONE, ALIGNMENT_ERROR }
-#undef a_0
-#undef a_1
-#undef a_2
-#undef a_3
-#undef a01
-#undef a12
-#undef a23
-#undef a30
-#undef NONE
-#undef ERROR
-};
-
-// Given an index to a local alignment to local alignment map and an alignment, will convert that
-// alignment to its mapped alignment and return it.  Map indices should be stored inside tiles as
-// current tile alignments -> neighbor tile alignments maps as well as other places.
-const LocalAlignment tnav::map(MapType mapType, LocalAlignment currentAlignment)
-{
-#ifdef RUNNING_DEBUG
-	if (mapType > 7) std::cout << "INVALID ALIGNMENT TRANSLATION MAP INDEX" << std::endl;
-#endif
-	return ALIGNMENT_TRANSLATION_MAPS[mapType][currentAlignment];
-}
-
-// NEIGHBOR_ALIGNMENT_MAP_INDICES[currentTileEdgeIndex][connectedNeighborEdgeIndex]
-const MapType NEIGHBOR_ALIGNMENT_MAP_TYPE[4][4] = {
-	{ MAP_TYPE_6, MAP_TYPE_7, MAP_TYPE_0, MAP_TYPE_1 },
-	{ MAP_TYPE_7, MAP_TYPE_4, MAP_TYPE_3, MAP_TYPE_0 },
-	{ MAP_TYPE_0, MAP_TYPE_1, MAP_TYPE_6, MAP_TYPE_7 },
-	{ MAP_TYPE_3, MAP_TYPE_0, MAP_TYPE_7, MAP_TYPE_4 }
-};
-
-// I have no idea why you dont have to account for the different starting tile types.  
-// They all come out to the same map indices somehow!  
-// 6x size decreas maybe due to the layout of edge indices on different tile types being a nice pattern?
-const MapType tnav::getNeighborMap(LocalDirection currentToNeighbor, LocalDirection neighborToCurrent)
-{
-#ifdef RUNNING_DEBUG
-	checkOrthogonal(connectedCurrentTileEdgeIndex);
-	checkOrthogonal(connectedNeighborEdgeIndex);
-#endif
-	return NEIGHBOR_ALIGNMENT_MAP_TYPE[currentToNeighbor][neighborToCurrent];
-}
-
-
-
-const MapType tnav::combine(MapType map1, MapType map2)
-{
-	const static MapType M_0 = MAP_TYPE_0;
-	const static MapType M_1 = MAP_TYPE_1;
-	const static MapType M_2 = MAP_TYPE_2;
-	const static MapType M_3 = MAP_TYPE_3;
-	const static MapType M_4 = MAP_TYPE_4;
-	const static MapType M_5 = MAP_TYPE_5;
-	const static MapType M_6 = MAP_TYPE_6;
-	const static MapType M_7 = MAP_TYPE_7;
-	const static MapType ERR = MAP_TYPE_ERROR;
-	// COMBINE_MAP_INDICES[map index 0][map index 1]
-	const static MapType COMBINE_MAP_INDICES[9][9] = {
-		{ M_0, M_1, M_2, M_3, M_4, M_5, M_6, M_7, ERR },
-		{ M_1, M_2, M_3, M_0, M_7, M_4, M_5, M_6, ERR },
-		{ M_2, M_3, M_0, M_1, M_6, M_7, M_4, M_5, ERR },
-		{ M_3, M_0, M_1, M_2, M_5, M_6, M_7, M_4, ERR },
-		{ M_4, M_5, M_6, M_7, M_0, M_1, M_2, M_3, ERR },
-		{ M_5, M_6, M_7, M_4, M_3, M_0, M_1, M_2, ERR },
-		{ M_6, M_7, M_4, M_5, M_2, M_3, M_0, M_1, ERR },
-		{ M_7, M_4, M_5, M_6, M_1, M_2, M_3, M_0, ERR },
-		{ ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR, ERR },
-	};
-
-	return COMBINE_MAP_INDICES[map1][map2];
-}
-
-const MapType tnav::inverse(MapType map)
-{
-	switch (map) {
-	case 0: return MAP_TYPE_0;
-	case 1: return MAP_TYPE_3;
-	case 2: return MAP_TYPE_2;
-	case 3: return MAP_TYPE_1;
-	case 4: return MAP_TYPE_4;
-	case 5: return MAP_TYPE_5;
-	case 6: return MAP_TYPE_6;
-	case 7: return MAP_TYPE_7;
-	default: throw std::runtime_error("INVALID ALIGNMENT MAP INDEX IN GIVEN TO inverseAlignmentMapIndex()");
-	}
-}
 
 const SuperTileType tnav::getSuperTileType(glm::ivec3 tileVert1, glm::ivec3 tileVert2, glm::ivec3 tileVert3)
 {
@@ -688,36 +517,6 @@ const TileType tnav::getTileType(glm::vec3 normal)
 }
 
 
-const LocalAlignment tnav::getOtherComponent(LocalAlignment diagonal, LocalAlignment component)
-{
-	switch (diagonal) {
-	case LOCAL_ALIGNMENT_0_1:
-		switch (component) {
-		case LOCAL_ALIGNMENT_0: return LOCAL_ALIGNMENT_1;
-		case LOCAL_ALIGNMENT_1: return LOCAL_ALIGNMENT_0;
-		default: return LOCAL_ALIGNMENT_ERROR;
-		}
-	case LOCAL_ALIGNMENT_1_2:
-		switch (component) {
-		case LOCAL_ALIGNMENT_1: return LOCAL_ALIGNMENT_2;
-		case LOCAL_ALIGNMENT_2: return LOCAL_ALIGNMENT_1;
-		default: return LOCAL_ALIGNMENT_ERROR;
-		}
-	case LOCAL_ALIGNMENT_2_3:
-		switch (component) {
-		case LOCAL_ALIGNMENT_2: return LOCAL_ALIGNMENT_3;
-		case LOCAL_ALIGNMENT_3: return LOCAL_ALIGNMENT_2;
-		default: return LOCAL_ALIGNMENT_ERROR;
-		}
-	case LOCAL_ALIGNMENT_3_0:
-		switch (component) {
-		case LOCAL_ALIGNMENT_3: return LOCAL_ALIGNMENT_0;
-		case LOCAL_ALIGNMENT_0: return LOCAL_ALIGNMENT_3;
-		default: return LOCAL_ALIGNMENT_ERROR;
-		}
-	default: return LOCAL_ALIGNMENT_ERROR;
-	}
-}
 
 const glm::vec3 tnav::TO_NODE_OFFSETS[3][8] = {
 	{ 
@@ -802,3 +601,36 @@ const glm::vec3 tnav::getCenterToNeighborVec(TileType type, LocalDirection dir)
 
 	return TILE_CENTER_TO_SIDE[type][dir];
 }
+
+static void writeGlslTable(std::stringstream& s, const char* name, const int* values, int rows, int columns)
+{
+	s << "const int " << name << "[" << rows << "][" << columns << "] = {\n";
+	for (int r = 0; r < rows; r++) {
+		s << "\t{ ";
+		for (int c = 0; c < columns; c++) s << values[r * columns + c] << (c + 1 < columns ? ", " : " ");
+		s << (r + 1 < rows ? "},\n" : "}\n");
+	}
+	s << "};\n";
+}
+
+std::string tnav::mapTablesGlsl()
+{
+	const int NUM_MAPS = d4::NUM_MAPS;
+	int mapDirection[NUM_MAPS][8], combineMaps[NUM_MAPS][NUM_MAPS], inverseMaps[1][NUM_MAPS];
+	for (int m = 0; m < NUM_MAPS; m++) {
+		for (int d = 0; d < 8; d++) mapDirection[m][d] = MAP_ALIGNMENT.v[m][d];
+		for (int n = 0; n < NUM_MAPS; n++) combineMaps[m][n] = COMBINE_MAPS.v[m][n];
+		inverseMaps[0][m] = INVERSE_MAPS.v[m];
+	}
+
+	std::stringstream s;
+	s << "// Made by tnav::mapTablesGlsl() from the tables in tileNavigation.h, change them there.\n";
+	s << "// MAP_DIRECTION[map index][direction to map]\n";
+	writeGlslTable(s, "MAP_DIRECTION", &mapDirection[0][0], NUM_MAPS, 8);
+	s << "// COMBINE_MAP_INDICES[initial mapping][next mapping]\n";
+	writeGlslTable(s, "COMBINE_MAP_INDICES", &combineMaps[0][0], NUM_MAPS, NUM_MAPS);
+	s << "const int INVERSE_MAP[" << NUM_MAPS << "] = { ";
+	for (int m = 0; m < NUM_MAPS; m++) s << inverseMaps[0][m] << (m + 1 < NUM_MAPS ? ", " : " ");
+	s << "};\n";
+	return s.str();
+}
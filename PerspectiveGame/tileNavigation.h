@@ -1,5 +1,6 @@
 #pragma once
 #include <iostream>
+#include <string>
 
 #include"dependancyHeaders.h"
 
@@ -208,23 +209,255 @@ namespace tnav { // tnav is short for 'tile navigation'
 	//#define directionToDirectionMap alignmentToAlignmentMap
 	//#define orientationToOrientationMap alignmentToAlignmentMap
 	
-	LocalDirection inverse(LocalDirection direction);
-	
-	const LocalAlignment* getAlignmentComponents(LocalAlignment alignment);
-	
-	const bool alignmentHasComponent(LocalDirection direction, LocalDirection component);
-	
-	const LocalDirection combine(LocalAlignment a, LocalAlignment b);
-	
-	const LocalAlignment map(MapType mapType, LocalAlignment currentAlignment);
+	// MapType and LocalAlignment algebra.  A MapType is one of the 8 symmetries of a square (the dihedral group D4):
+	// maps 0-3 turn orthogonal direction d into d + m and maps 4-7 flip it into m - d (mod 4), diagonals follow
+	// their components.  Every table below is built from that at compile time, the group laws are checked with
+	// static_asserts at the bottom, and the shaders get the same tables from mapTablesGlsl().
+	// These are on every neighbor hop (pov, entities, edits), so they're all inline lookups.
+	namespace d4 { // only for building the tables, use the functions after it.
+		constexpr int NUM_MAPS = 8;
+		constexpr int NUM_ALIGNMENTS = 10; // including NONE and ERROR.
+
+		constexpr bool isOrthogonal(int a) { return a < 4; }
+		constexpr bool isDiagonal(int a) { return 3 < a && a < 8; }
+
+		constexpr int mapAlignment(int m, int a)
+		{
+			if (isOrthogonal(a)) return m < 4 ? (a + m) % 4 : (m - a + 4) % 4;
+			// Diagonal k sits between k and k + 1, so it goes to whichever diagonal sits between where those went:
+			if (isDiagonal(a)) return 4 + (m < 4 ? (a - 4 + m) % 4 : (m - (a - 4) + 3) % 4);
+			return a; // NONE and ERROR stay put.
+		}
+
+		constexpr bool sameMap(int m1, int m2)
+		{
+			for (int a = 0; a < NUM_ALIGNMENTS; a++) if (mapAlignment(m1, a) != mapAlignment(m2, a)) return false;
+			return true;
+		}
+
+		// The map that does m1 then m2:
+		constexpr int combineMaps(int m1, int m2)
+		{
+			for (int c = 0; c < NUM_MAPS; c++) {
+				bool same = true;
+				for (int a = 0; a < NUM_ALIGNMENTS; a++) same = same && mapAlignment(c, a) == mapAlignment(m2, mapAlignment(m1, a));
+				if (same) return c;
+			}
+			return MAP_TYPE_ERROR;
+		}
+
+		struct AlignmentMaps { LocalAlignment v[NUM_MAPS][NUM_ALIGNMENTS]; };
+		struct MapCombinations { MapType v[NUM_MAPS + 1][NUM_MAPS + 1]; }; // the extra row/column is MAP_TYPE_ERROR.
+		struct MapInverses { MapType v[NUM_MAPS + 1]; };
+		struct AlignmentComponents { LocalAlignment v[8][2]; };
+		struct AlignmentCombinations { LocalAlignment v[4][4]; };
+		struct AlignmentHasComponent { bool v[NUM_ALIGNMENTS][NUM_ALIGNMENTS]; };
+
+		constexpr AlignmentMaps buildAlignmentMaps()
+		{
+			AlignmentMaps t{};
+			for (int m = 0; m < NUM_MAPS; m++)
+				for (int a = 0; a < NUM_ALIGNMENTS; a++) t.v[m][a] = LocalAlignment(mapAlignment(m, a));
+			return t;
+		}
+
+		constexpr MapCombinations buildMapCombinations()
+		{
+			MapCombinations t{};
+			for (int m1 = 0; m1 <= NUM_MAPS; m1++)
+				for (int m2 = 0; m2 <= NUM_MAPS; m2++)
+					t.v[m1][m2] = (m1 == NUM_MAPS || m2 == NUM_MAPS) ? MAP_TYPE_ERROR : MapType(combineMaps(m1, m2));
+			return t;
+		}
+
+		constexpr MapInverses buildMapInverses()
+		{
+			MapInverses t{};
+			for (int m = 0; m <= NUM_MAPS; m++) {
+				t.v[m] = MAP_TYPE_ERROR;
+				for (int i = 0; i < NUM_MAPS && m < NUM_MAPS; i++) if (combineMaps(m, i) == MAP_TYPE_IDENTITY) t.v[m] = MapType(i);
+			}
+			return t;
+		}
 
-	const MapType getNeighborMap(LocalDirection connectedCurrentTileEdgeIndex, LocalDirection connectedNeighborEdgeIndex);
+		// Orthogonals are just duplicated:
+		constexpr AlignmentComponents buildAlignmentComponents()
+		{
+			AlignmentComponents t{};
+			for (int a = 0; a < 8; a++) {
+				t.v[a][0] = LocalAlignment(a % 4);
+				t.v[a][1] = LocalAlignment(isOrthogonal(a) ? a : (a - 4 + 1) % 4);
+			}
+			return t;
+		}
+
+		// Two orthogonals make a diagonal if they're next to each other, and cancel out if they face opposite ways:
+		constexpr AlignmentCombinations buildAlignmentCombinations()
+		{
+			AlignmentCombinations t{};
+			for (int a = 0; a < 4; a++) {
+				for (int b = 0; b < 4; b++) {
+					int turn = (b - a + 4) % 4;
+					t.v[a][b] = LocalAlignment(turn == 0 ? a : turn == 1 ? 4 + a : turn == 3 ? 4 + b : LOCAL_ALIGNMENT_NONE);
+				}
+			}
+			return t;
+		}
+
+		constexpr AlignmentHasComponent buildAlignmentHasComponent()
+		{
+			AlignmentHasComponent t{};
+			for (int a = 0; a < NUM_ALIGNMENTS; a++)
+				for (int c = 0; c < NUM_ALIGNMENTS; c++)
+					t.v[a][c] = a == c || (isDiagonal(a) && isOrthogonal(c) && (c == a - 4 || c == (a - 4 + 1) % 4));
+			return t;
+		}
+	}
+
+	// MAP_ALIGNMENT[map][alignment]
+	inline constexpr d4::AlignmentMaps MAP_ALIGNMENT = d4::buildAlignmentMaps();
+	// COMBINE_MAPS[first map][second map]
+	inline constexpr d4::MapCombinations COMBINE_MAPS = d4::buildMapCombinations();
+	inline constexpr d4::MapInverses INVERSE_MAPS = d4::buildMapInverses();
+	inline constexpr d4::AlignmentComponents ALIGNMENT_COMPONENTS = d4::buildAlignmentComponents();
+	inline constexpr d4::AlignmentCombinations COMBINED_ALIGNMENTS = d4::buildAlignmentCombinations();
+	inline constexpr d4::AlignmentHasComponent HAS_COMPONENT = d4::buildAlignmentHasComponent();
+
+	// NEIGHBOR_MAPS[currentTileEdgeIndex][connectedNeighborEdgeIndex]
+	// I have no idea why you dont have to account for the different starting tile types.  
+	// They all come out to the same map indices somehow!  
+	// 6x size decreas maybe due to the layout of edge indices on different tile types being a nice pattern?
+	// (Checked below at least: leaving through an edge always comes out facing away from the neighbor's.)
+	inline constexpr MapType NEIGHBOR_MAPS[4][4] = {
+		{ MAP_TYPE_6, MAP_TYPE_7, MAP_TYPE_0, MAP_TYPE_1 },
+		{ MAP_TYPE_7, MAP_TYPE_4, MAP_TYPE_3, MAP_TYPE_0 },
+		{ MAP_TYPE_0, MAP_TYPE_1, MAP_TYPE_6, MAP_TYPE_7 },
+		{ MAP_TYPE_3, MAP_TYPE_0, MAP_TYPE_7, MAP_TYPE_4 }
+	};
+
+	constexpr bool isOrthogonal(LocalDirection direction) { return d4::isOrthogonal(direction); }
+	constexpr bool isDiagonal(LocalDirection direction) { return d4::isDiagonal(direction); }
+
+	// Given an index to a local alignment to local alignment map and an alignment, will convert that
+	// alignment to its mapped alignment and return it.  Map indices should be stored inside tiles as
+	// current tile alignments -> neighbor tile alignments maps as well as other places.
+	constexpr LocalAlignment map(MapType mapType, LocalAlignment currentAlignment)
+	{
+		return MAP_ALIGNMENT.v[mapType][currentAlignment];
+	}
+
+	constexpr MapType getNeighborMap(LocalDirection currentToNeighbor, LocalDirection neighborToCurrent)
+	{
+		return NEIGHBOR_MAPS[currentToNeighbor][neighborToCurrent];
+	}
 
 	// Combines and returns map1 -> map2.
 	// * Return may be different than map2 -> map1!
-	const MapType combine(MapType map1, MapType map2);
+	constexpr MapType combine(MapType map1, MapType map2) { return COMBINE_MAPS.v[map1][map2]; }
+
+	constexpr MapType inverse(MapType mapType) { return INVERSE_MAPS.v[mapType]; }
+
+	// Opposite direction, diagonals stay diagonal.  NONE and ERROR stay put.
+	constexpr LocalDirection inverse(LocalDirection direction)
+	{
+		return d4::isOrthogonal(direction) || d4::isDiagonal(direction)
+			? LocalDirection((direction + 2) % 4 + (direction > 3) * 4) : direction;
+	}
+
+	// Breaks down diagonal directions into their components.  Points to 2 of them.
+	inline const LocalAlignment* getAlignmentComponents(LocalAlignment alignment) { return ALIGNMENT_COMPONENTS.v[alignment]; }
+
+	constexpr bool alignmentHasComponent(LocalDirection direction, LocalDirection component)
+	{
+		return HAS_COMPONENT.v[direction][component];
+	}
+
+	// Given two orthogonal LocalDirections, combines them into an orthogonal or diagonal direction.
+	// Directions facing opposite ways are combined into the static enum.
+	constexpr LocalDirection combine(LocalAlignment a, LocalAlignment b) { return COMBINED_ALIGNMENTS.v[a][b]; }
+
+	// Given a diagonal alignment and one of its components, will return the other component.
+	// LOCAL_ALIGNMENT_ERROR is returned if 'component' is not a component of diagonal or 'diagonal' is not a diagonal alignment.
+	constexpr LocalAlignment getOtherComponent(LocalAlignment diagonal, LocalAlignment component)
+	{
+		if (!d4::isDiagonal(diagonal)) return LOCAL_ALIGNMENT_ERROR;
+		const LocalAlignment* c = ALIGNMENT_COMPONENTS.v[diagonal];
+		return component == c[0] ? c[1] : component == c[1] ? c[0] : LOCAL_ALIGNMENT_ERROR;
+	}
+
+	// The same tables for the shaders, as GLSL source: MAP_DIRECTION[map][direction], COMBINE_MAP_INDICES[first][second]
+	// and INVERSE_MAP[map].  Shaders get it with #include "generated/tnavMaps.glsl".
+	std::string mapTablesGlsl();
+
+	namespace d4 {
+		constexpr bool identityMapsNothing()
+		{
+			for (int a = 0; a < NUM_ALIGNMENTS; a++) if (mapAlignment(MAP_TYPE_IDENTITY, a) != a) return false;
+			return true;
+		}
+
+		// Each map shuffles the orthogonals among themselves and the diagonals among themselves, losing nothing:
+		constexpr bool mapsArePermutations()
+		{
+			for (int m = 0; m < NUM_MAPS; m++) {
+				bool hit[NUM_ALIGNMENTS] = {};
+				for (int a = 0; a < NUM_ALIGNMENTS; a++) {
+					int b = mapAlignment(m, a);
+					if (isOrthogonal(a) != isOrthogonal(b) || isDiagonal(a) != isDiagonal(b) || hit[b]) return false;
+					hit[b] = true;
+				}
+			}
+			return true;
+		}
+
+		constexpr bool mapsAreDistinct()
+		{
+			for (int m1 = 0; m1 < NUM_MAPS; m1++)
+				for (int m2 = m1 + 1; m2 < NUM_MAPS; m2++) if (sameMap(m1, m2)) return false;
+			return true;
+		}
+
+		// Any two maps in a row are one of the 8 again:
+		constexpr bool mapsAreClosed()
+		{
+			for (int m1 = 0; m1 < NUM_MAPS; m1++)
+				for (int m2 = 0; m2 < NUM_MAPS; m2++) if (COMBINE_MAPS.v[m1][m2] == MAP_TYPE_ERROR) return false;
+			return true;
+		}
+
+		constexpr bool combineIsAssociative()
+		{
+			for (int a = 0; a < NUM_MAPS; a++)
+				for (int b = 0; b < NUM_MAPS; b++)
+					for (int c = 0; c < NUM_MAPS; c++)
+						if (COMBINE_MAPS.v[COMBINE_MAPS.v[a][b]][c] != COMBINE_MAPS.v[a][COMBINE_MAPS.v[b][c]]) return false;
+			return true;
+		}
 
-	const MapType inverse(MapType mapType);
+		constexpr bool inversesUndo()
+		{
+			for (int m = 0; m < NUM_MAPS; m++) {
+				MapType i = INVERSE_MAPS.v[m];
+				if (COMBINE_MAPS.v[m][i] != MAP_TYPE_IDENTITY || COMBINE_MAPS.v[i][m] != MAP_TYPE_IDENTITY) return false;
+			}
+			return true;
+		}
+
+		// Leaving through edge c into an edge n of the neighbor, you have to end up heading away from n:
+		constexpr bool neighborMapsLineUpEdges()
+		{
+			for (int c = 0; c < 4; c++)
+				for (int n = 0; n < 4; n++) if (mapAlignment(NEIGHBOR_MAPS[c][n], c) != (n + 2) % 4) return false;
+			return true;
+		}
+	}
+	static_assert(d4::identityMapsNothing(), "MAP_TYPE_IDENTITY has to leave every alignment alone");
+	static_assert(d4::mapsArePermutations(), "every map has to be a permutation keeping orthogonals and diagonals apart");
+	static_assert(d4::mapsAreDistinct(), "the 8 maps have to be 8 different symmetries");
+	static_assert(d4::mapsAreClosed(), "combining two maps has to give another map");
+	static_assert(d4::combineIsAssociative(), "combining maps has to be associative");
+	static_assert(d4::inversesUndo(), "a map combined with its inverse (either way round) has to be the identity");
+	static_assert(d4::neighborMapsLineUpEdges(), "NEIGHBOR_MAPS has to send the exit edge to the opposite of the entry edge");
 
 	LocalPosition nextPosition(LocalPosition position, LocalDirection direction);
 
@@ -260,9 +493,6 @@ namespace tnav { // tnav is short for 'tile navigation'
 		}
 	}
 	
-	bool isOrthogonal(LocalDirection direction);
-	bool isDiagonal(LocalDirection direction);
-
 	const uint8_t getDirectionFlag(LocalDirection direction);
 	const LocalDirection getDirection(uint8_t directionFlag);
 
@@ -295,10 +525,6 @@ namespace tnav { // tnav is short for 'tile navigation'
 
 	const int getTileVisibility(TileType subjetTileType, LocalDirection orthoSide, TileType otherTileType);
 
-	// Given a diagonal alignment and one of its components, will return the other component.
-	// LOCAL_ALIGNMENT_ERROR is returned if 'component' is not a component of diagonal or 'diagonal' is not a diagonal alignment.
-	const LocalAlignment getOtherComponent(LocalAlignment diagonal, LocalAlignment component);
-
 	const glm::vec3 getNormal(TileType type);
 	const TileType getTileType(glm::vec3 normal);
 
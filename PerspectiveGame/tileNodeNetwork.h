@@ -3,6 +3,11 @@
 #include <iostream>
 #include <vector>
 #include <set>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+#include <cmath>
 
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
@@ -11,7 +16,12 @@
 #include "tileNavigation.h"
 #include "tileNode.h"
 #include "tile.h"
+#include "tileBvh.h"
+#include "tileLod.h"
 #include "cameraManager.h"
+#include "worldEdit.h"
+#include "memoryAccounting.h"
+#include "jobSystem.h"
 
 struct TileNodeNetwork {
 private:
@@ -21,18 +31,30 @@ private:
 	std::vector<Tile> tiles;
 	std::vector<int> freeTileInfoIndices;
 
+	// Only kept up to date inside createTilePairs(), so getConnectedTiles() doesn't have to look at every node:
+	bool bulkBuilding = false;
+	std::unordered_map<uint64_t, std::vector<int>> nodesAtPosition;
+
 	Camera* p_camera;
 	ForceManager* p_forceManager;
 
 public: // Rendering:
 	GLuint texID;
-	GLuint positionNodeInfosBufferID;
-	GLuint tilesBufferID;
+	// 0 until initGpuBuffers():
+	GLuint positionNodeInfosBufferID = 0;
+	GLuint tilesBufferID = 0;
+	GLuint tileLodsBufferID = 0;
 	std::vector<glm::vec2> windowFrustum;
 
+	// Only rebuilt when tiles are added, removed, reconnected or recolored:
 	std::vector<GPU_Tile> gpuTiles;
+	std::vector<GPU_TileLod> gpuTileLods; // built from gpuTiles, see tileLod.h.
+	bool gpuTilesDirty = true;
 	std::vector<GPU_TileNodeInfo> gpuPositionNodeInfos;
 
+	// Spatial index over tile bounds for culling the 3D view and picking tiles in it:
+	TileBVH bvh;
+
 	CenterNode CurrentNode;
 	int currentMapIndex = 0;
 	int currentNodeIndex = 4;
@@ -47,30 +69,70 @@ public:
 				createTilePair(glm::vec3(float(x), float(y), 0), TILE_TYPE_XY);
 			}
 		}
+	}
+
+	~TileNodeNetwork()
+	{
+		for (TileNode* n : nodes) delete n;
+		if (tilesBufferID == 0) return;
+		GlobalGlBufferMemory.remove(positionNodeInfosBufferID);
+		GlobalGlBufferMemory.remove(tilesBufferID);
+		GlobalGlBufferMemory.remove(tileLodsBufferID);
+		glDeleteBuffers(1, &positionNodeInfosBufferID);
+		glDeleteBuffers(1, &tilesBufferID);
+		glDeleteBuffers(1, &tileLodsBufferID);
+	}
 
-		// Rendering:
+	// Only the renderer needs these, and a gl context to make them.  The network itself doesn't, so the soak test
+	// and micro benchmarks never call this and run with no context at all.
+	void initGpuBuffers()
+	{
 		glGenBuffers(1, &positionNodeInfosBufferID);
 		glGenBuffers(1, &tilesBufferID);
+		glGenBuffers(1, &tileLodsBufferID);
 	}
 
-	void update()
+	// Back to no tiles at all (not even the one the constructor makes), forces included.  Whatever still holds node
+	// or tile indices (entities, the pov) has to start over too, see Scenario::apply().
+	void clear()
 	{
-		gpuPositionNodeInfos.clear();
-		for (TileNode* p : nodes) {
-			if (p == nullptr) 
-				gpuPositionNodeInfos.push_back(GPU_TileNodeInfo());
-			else
-				gpuPositionNodeInfos.push_back(GPU_TileNodeInfo(*p));
-		}
+		for (TileNode* n : nodes) delete n;
+		nodes.clear();
+		freeNodeIndices.clear();
+		tiles.clear();
+		freeTileInfoIndices.clear();
+		bvh = TileBVH();
+		p_forceManager->forceList.clear();
+		p_forceManager->freeForceListIndices.clear();
+		gpuTilesDirty = true;
+	}
 
-		gpuTiles.clear();
-		for (Tile& i : tiles) {
-			gpuTiles.push_back(GPU_Tile(i));
-		}
+	void update()
+	{
+		gpuPositionNodeInfos.resize(nodes.size());
+		GlobalJobSystem.parallelFor((int)nodes.size(), 4096, [this](int begin, int end) {
+			for (int i = begin; i < end; i++) {
+				TileNode* p = nodes[i];
+				gpuPositionNodeInfos[i] = p == nullptr ? GPU_TileNodeInfo() : GPU_TileNodeInfo(*p);
+			}
+		});
+	}
 
-		
+	// Rebuilds gpuTiles (and their lod info) if anything changed since the last time.  Cpu only, runs on the
+	// simulation thread; the renderer uploads them into the buffers above from its snapshot.
+	void rebuildGpuTilesIfDirty()
+	{
+		if (!gpuTilesDirty) return;
+		gpuTiles.resize(tiles.size());
+		GlobalJobSystem.parallelFor((int)tiles.size(), 4096, [this](int begin, int end) {
+			for (int i = begin; i < end; i++) gpuTiles[i] = GPU_Tile(tiles[i]);
+		});
+		tileLod::build(gpuTiles, gpuTileLods);
+		gpuTilesDirty = false;
 	}
 
+	int numTiles() { return (int)tiles.size(); }
+
 	void checkCornerConnections()
 	{
 		/*for (auto n : nodes) {
@@ -89,8 +151,182 @@ public:
 		}*/
 	}
 
+	// Everything the edits are meant to keep true, looking at every node and tile (so only for the soak test,
+	// see soakTest.h, or debugging).  Adds a line to errors for each thing wrong (up to a few dozen) and returns
+	// whether everything was fine.
+	bool checkInvariants(std::vector<std::string>& errors)
+	{
+		using namespace tnav;
+		using std::to_string;
+		size_t firstError = errors.size();
+		auto fail = [&](const std::string& what) { if (errors.size() - firstError < 32) errors.push_back(what); };
+		auto liveNode = [&](int i) { return 0 <= i && i < (int)nodes.size() && nodes[i] != nullptr; };
+		auto liveTile = [&](int i) { return 0 <= i && i < (int)tiles.size() && tiles[i].index != -1; };
+		// Asking a side or corner node about a direction it doesn't have indexes out of its arrays:
+		auto hasDirection = [](TileNode* n, LocalDirection d) {
+			switch (n->type) {
+			case NODE_TYPE_CENTER: return isOrthogonal(d) || isDiagonal(d);
+			case NODE_TYPE_SIDE: {
+				SideNode* side = static_cast<SideNode*>(n);
+				return d == side->getLocalDirDirect(0) || d == side->getLocalDirDirect(1);
+			}
+			case NODE_TYPE_CORNER: return isDiagonal(d);
+			default: return false;
+			}
+		};
+
+		// Free lists hold exactly the empty slots, once each:
+		std::vector<char> freeNode(nodes.size(), 0), freeTile(tiles.size(), 0);
+		for (int i : freeNodeIndices) {
+			if (i < 0 || i >= (int)nodes.size()) { fail("free node index " + to_string(i) + " is out of range"); continue; }
+			if (freeNode[i]) fail("node " + to_string(i) + " is on the free list twice");
+			if (nodes[i] != nullptr) fail("node " + to_string(i) + " is on the free list but still there");
+			freeNode[i] = 1;
+		}
+		for (int i = 0; i < (int)nodes.size(); i++) {
+			if (nodes[i] == nullptr) {
+				if (!freeNode[i]) fail("node " + to_string(i) + " is gone but not on the free list");
+				continue;
+			}
+			if (nodes[i]->index != i) fail("node " + to_string(i) + " thinks it's node " + to_string(nodes[i]->index));
+			// getNodeViaForceComponentIndex() counts on this:
+			if (nodes[i]->forceListIndex != i * 4)
+				fail("node " + to_string(i) + "'s forces are at " + to_string(nodes[i]->forceListIndex) + ", not " + to_string(i * 4));
+		}
+		for (int i : freeTileInfoIndices) {
+			if (i < 0 || i >= (int)tiles.size()) { fail("free tile index " + to_string(i) + " is out of range"); continue; }
+			if (freeTile[i]) fail("tile " + to_string(i) + " is on the free list twice");
+			if (tiles[i].index != -1) fail("tile " + to_string(i) + " is on the free list but still there");
+			freeTile[i] = 1;
+		}
+		for (int i = 0; i < (int)tiles.size(); i++) {
+			if (tiles[i].index == -1 && !freeTile[i]) fail("tile " + to_string(i) + " is gone but not on the free list");
+			if (tiles[i].index != -1 && tiles[i].index != i) fail("tile " + to_string(i) + " thinks it's tile " + to_string(tiles[i].index));
+		}
+
+		// Tiles come in pairs, each with its own center node, and their neighbors lead back with the inverse map:
+		for (int i = 0; i < (int)tiles.size(); i++) {
+			Tile& t = tiles[i];
+			if (t.index == -1) continue;
+			std::string name = "tile " + to_string(i);
+			if (!liveTile(t.siblingIndex) || tiles[t.siblingIndex].siblingIndex != i) fail(name + " and its sibling don't match up");
+			else if (getSuperTileType(tiles[t.siblingIndex].type) != getSuperTileType(t.type)) fail(name + "'s sibling faces another way");
+			if (!liveNode(t.centerNodeIndex) || nodes[t.centerNodeIndex]->type != NODE_TYPE_CENTER ||
+				static_cast<CenterNode*>(nodes[t.centerNodeIndex])->getTileIndex() != i) {
+				fail(name + " and its center node don't match up");
+			}
+			for (LocalDirection d : ORTHOGONAL_DIRECTION_SET) {
+				int n = t.getNeighborIndex(d);
+				MapType m = t.getNeighborMap(d);
+				if (!liveTile(n) || m >= MAP_TYPE_ERROR) { fail(name + " has no neighbor " + to_string(d)); continue; }
+				LocalDirection back = inverse(map(m, d));
+				if (tiles[n].getNeighborIndex(back) != i || tiles[n].getNeighborMap(back) != inverse(m))
+					fail(name + "'s neighbor " + to_string(d) + " (tile " + to_string(n) + ") doesn't lead back");
+			}
+		}
+
+		// Every link between nodes goes both ways, the way back with the inverse map.  Degenerate corners only keep
+		// force components, not links, so those are checked from their side below:
+		for (TileNode* a : nodes) {
+			if (a == nullptr || a->type == NODE_TYPE_DEGENERATE) continue;
+			std::string name = "node " + to_string(a->index);
+			for (LocalDirection d : DIRECTION_SET) {
+				if (!hasDirection(a, d)) continue;
+				int bi = a->getNeighborIndex(d);
+				if (!liveNode(bi)) { fail(name + " has no neighbor " + to_string(d)); continue; }
+				TileNode* b = nodes[bi];
+
+				bool rightType = (a->type == NODE_TYPE_CENTER)
+					? (isOrthogonal(d) ? b->type == NODE_TYPE_SIDE : b->type == NODE_TYPE_CORNER || b->type == NODE_TYPE_DEGENERATE)
+					: b->type == NODE_TYPE_CENTER;
+				if (!rightType) { fail(name + "'s neighbor " + to_string(d) + " (node " + to_string(bi) + ") is the wrong type"); continue; }
+				if (b->type == NODE_TYPE_DEGENERATE) continue;
+
+				MapType m = a->getNeighborMap(d);
+				if (m >= MAP_TYPE_ERROR) { fail(name + " has no map to neighbor " + to_string(d)); continue; }
+				LocalDirection back = inverse(map(m, d));
+				if (!hasDirection(b, back) || b->getNeighborIndex(back) != a->index || b->getNeighborMap(back) != inverse(m))
+					fail(name + "'s neighbor " + to_string(d) + " (node " + to_string(bi) + ") doesn't lead back");
+			}
+		}
+
+		// Degenerate corners: pairs of force components of the center nodes around them, and those center nodes
+		// point at them the way the pair says:
+		for (TileNode* n : nodes) {
+			if (n == nullptr || n->type != NODE_TYPE_DEGENERATE) continue;
+			DegenerateCornerNode* degen = static_cast<DegenerateCornerNode*>(n);
+			std::string name = "degenerate node " + to_string(degen->index);
+			const std::vector<int>& pairs = degen->componentPairIndices;
+			if ((int)pairs.size() != degen->numDegenComponents || pairs.size() % 2 != 0) {
+				fail(name + " has " + to_string(pairs.size()) + " components but counts " + to_string(degen->numDegenComponents));
+				continue;
+			}
+			for (int p = 0; p + 1 < (int)pairs.size(); p += 2) {
+				int centerIndex = pairs[p] / 4;
+				LocalDirection toCorner = combine(LocalDirection(pairs[p] % 4), LocalDirection(pairs[p + 1] % 4));
+				if (pairs[p + 1] / 4 != centerIndex || !isDiagonal(toCorner)) {
+					fail(name + "'s components " + to_string(pairs[p]) + ", " + to_string(pairs[p + 1]) + " aren't a corner of one node");
+				}
+				else if (!liveNode(centerIndex) || nodes[centerIndex]->type != NODE_TYPE_CENTER) {
+					fail(name + "'s components " + to_string(pairs[p]) + ", " + to_string(pairs[p + 1]) + " aren't a center node's");
+				}
+				else if (nodes[centerIndex]->getNeighborIndex(toCorner) != degen->index) {
+					fail(name + " isn't node " + to_string(centerIndex) + "'s neighbor " + to_string(toCorner));
+				}
+			}
+		}
+
+		// ...and every center node pointing at one is in its list:
+		for (TileNode* c : nodes) {
+			if (c == nullptr || c->type != NODE_TYPE_CENTER) continue;
+			for (LocalDirection d : DIAGONAL_DIRECTION_SET) {
+				int gi = c->getNeighborIndex(d);
+				if (!liveNode(gi) || nodes[gi]->type != NODE_TYPE_DEGENERATE) continue;
+				const LocalAlignment* components = getAlignmentComponents(d);
+				const std::vector<int>& pairs = static_cast<DegenerateCornerNode*>(nodes[gi])->componentPairIndices;
+				bool listed = false;
+				for (int p = 0; p + 1 < (int)pairs.size() && !listed; p += 2) {
+					listed = (pairs[p] == c->forceListIndex + components[0] && pairs[p + 1] == c->forceListIndex + components[1]) ||
+						(pairs[p] == c->forceListIndex + components[1] && pairs[p + 1] == c->forceListIndex + components[0]);
+				}
+				if (!listed) fail("node " + to_string(c->index) + "'s neighbor " + to_string(d) + " (degenerate node " + to_string(gi) + ") doesn't list it");
+			}
+		}
+
+		return errors.size() == firstError;
+	}
+
 	int size() { return (int)nodes.size(); }
 
+	// Adds what the network (and the force list it shares with the entities) is holding on to into report.  Not the
+	// bvh: cursor picks refit it under a shared lock, so only count bvh.memoryBytes() with the world to yourself.
+	void accountMemory(MemoryReport& report) const
+	{
+		size_t nodeBytes = vectorBytes(nodes) + vectorBytes(freeNodeIndices), degenBytes = 0;
+		for (const TileNode* n : nodes) {
+			if (n == nullptr) continue;
+			switch (n->type) {
+			case NODE_TYPE_CENTER: nodeBytes += sizeof(CenterNode); break;
+			case NODE_TYPE_SIDE: nodeBytes += sizeof(SideNode); break;
+			case NODE_TYPE_CORNER: nodeBytes += sizeof(CornerNode); break;
+			case NODE_TYPE_DEGENERATE:
+				nodeBytes += sizeof(DegenerateCornerNode);
+				degenBytes += vectorBytes(static_cast<const DegenerateCornerNode*>(n)->componentPairIndices);
+				break;
+			}
+		}
+		size_t positionIndexBytes = 0;
+		for (const auto& [key, here] : nodesAtPosition) positionIndexBytes += sizeof(key) + sizeof(here) + vectorBytes(here);
+
+		report.bytes[MEMORY_NODES] += nodeBytes + positionIndexBytes;
+		report.bytes[MEMORY_DEGENERATE_PAIRS] += degenBytes;
+		report.bytes[MEMORY_TILES] += vectorBytes(tiles) + vectorBytes(freeTileInfoIndices);
+		report.bytes[MEMORY_GPU_TILE_MIRRORS] += vectorBytes(gpuTiles) + vectorBytes(gpuTileLods);
+		report.bytes[MEMORY_GPU_NODE_INFOS] += vectorBytes(gpuPositionNodeInfos);
+		report.bytes[MEMORY_FORCES] += vectorBytes(p_forceManager->forceList) + vectorBytes(p_forceManager->freeForceListIndices);
+		report.numTilePairs += (int)(tiles.size() - freeTileInfoIndices.size()) / 2;
+	}
+
 	void printSize()
 	{
 		std::vector<int> degenConnections;
@@ -116,6 +352,12 @@ public:
 			<< "\nnum degenerate nodes: " << numDegenNodes
 			<< "\ntotal num nodes: " << numCenterNodes + numSideNodes + numCornerNodes + numDegenNodes
 			<< std::endl;
+		MemoryReport report;
+		accountMemory(report);
+		report.bytes[MEMORY_TILE_BVH] += bvh.memoryBytes(); // only ever printed by edits, with the world locked.
+		for (int c = MEMORY_NODES; c <= MEMORY_FORCES; c++)
+			std::cout << MEMORY_CATEGORY_NAMES[c] << ": " << report.bytes[c] << " bytes\n";
+		std::cout << "total: " << report.total() << " bytes, " << report.bytesPerTilePair() << " per tile pair" << std::endl;
 		for (int i = 0; i < degenConnections.size(); i++) {
 			vechelp::print(degenPositions[i]);
 			std::cout <<", " << degenConnections[i] << "\n";
@@ -148,6 +390,29 @@ public:
 
 	int numTileInfos() { return (int)tiles.size(); }
 
+	// Bounds of the tile in 3D, spanned by its four corners.
+	AABB getTileBounds(Tile& tile)
+	{
+		const glm::vec3* offsets = tnav::getNodePositionOffsets(tile.type);
+		glm::vec3 center = nodes[tile.centerNodeIndex]->getPosition();
+		AABB bounds;
+		for (int i = 4; i < 8; i++) bounds.grow(center + offsets[i]);
+		return bounds;
+	}
+
+	// Returns the tile hit by the ray facing back at it, or nullptr if nothing is hit.
+	Tile* pickTile(glm::vec3 origin, glm::vec3 dir)
+	{
+		float t;
+		int tileIndex = bvh.raycast(origin, dir, t);
+		if (tileIndex == -1) return nullptr;
+
+		// front and back tiles share bounds, so the bvh cannot tell them apart:
+		Tile* tile = &tiles[tileIndex];
+		if (glm::dot(tnav::getNormal(tile->type), dir) > 0) tile = &tiles[tile->siblingIndex];
+		return tile;
+	}
+
 	Tile* getTile(int tileInfoIndex, LocalDirection d)
 	{
 		return getTile(tiles[tileInfoIndex], d);
@@ -226,10 +491,25 @@ public:
 			nodes.back()->setIndex((int)nodes.size() - 1);
 			node->forceListIndex = p_forceManager->addForce(LOCAL_DIRECTION_STATIC, node->index);
 		}
+		if (bulkBuilding) indexNodePosition(node);
 
 		return node->getIndex();
 	}
 
+	// Node positions are all on the half lattice, so doubled they're exact ints (21 bits each is plenty):
+	static uint64_t positionKey(glm::vec3 p)
+	{
+		auto bits = [](float x) { return uint64_t(std::lround(x * 2.0f) + (1 << 20)) & 0x1FFFFF; };
+		return (bits(p.x) << 42) | (bits(p.y) << 21) | bits(p.z);
+	}
+
+	void indexNodePosition(TileNode* node)
+	{
+		std::vector<int>& here = nodesAtPosition[positionKey(node->getPosition())];
+		// Indices get reused, stale ones are weeded out by position when they're looked up:
+		if (std::find(here.begin(), here.end(), node->index) == here.end()) here.push_back(node->index);
+	}
+
 	// center nodes inherantly require more information, hence the inputs:
 	int addCenterNode(glm::vec3 pos, TileType orientation)
 	{
@@ -320,6 +600,7 @@ public:
 
 	void colorTile(int index)
 	{
+		gpuTilesDirty = true;
 		switch (tiles[index].type) {
 		case TILE_TYPE_XYF: tiles[index].color = glm::vec3(1.0f, 0.0f, 0.0f); break;
 		case TILE_TYPE_XYB: tiles[index].color = glm::vec3(0.5f, 0.0f, 0.0f); break;
@@ -332,6 +613,8 @@ public:
 
 	void removeTile(int index)
 	{
+		gpuTilesDirty = true;
+		bvh.removeTile(index);
 		tiles[index].wipe();
 		freeTileInfoIndices.push_back(index);
 	}
@@ -340,6 +623,7 @@ public:
 	// frontIndex and backIndex are meant to be used as returns.
 	void addTilePair(int frontCenterNodeIndex, int backCenterNodeIndex, SuperTileType type, int& frontInfoIndex, int& backInfoIndex)
 	{
+		gpuTilesDirty = true;
 		if (freeTileInfoIndices.size() > 1) {
 			frontInfoIndex = freeTileInfoIndices.back();
 			tiles[frontInfoIndex].index = freeTileInfoIndices.back();
@@ -389,9 +673,9 @@ public:
 		int sideNodeIndex = node->index;
 		glm::vec3 pos = nodes[sideNodeIndex]->getPosition();
 
-		for (TileNode* n : nodes) {
+		auto addConnectedTiles = [&](TileNode* n) {
 			if (n == nullptr || n->getPosition() != pos || n->getIndex() == sideNodeIndex)
-				continue;
+				return;
 
 			SideNode* s = static_cast<SideNode*>(n);
 			for (int i = 0; i < 2; i++) { // side nodes only have 2 neighbors
@@ -404,6 +688,16 @@ public:
 					]
 				);
 			}
+		};
+
+		if (bulkBuilding) {
+			auto found = nodesAtPosition.find(positionKey(pos));
+			if (found != nodesAtPosition.end()) {
+				for (int i : found->second) addConnectedTiles(i < (int)nodes.size() ? nodes[i] : nullptr);
+			}
+		}
+		else {
+			for (TileNode* n : nodes) addConnectedTiles(n);
 		}
 
 		return connectedTiles;
@@ -454,7 +748,41 @@ public:
 			if (nodes[tiles[i].centerNodeIndex]->getPosition() == pos)
 				return nullptr;
 		}
+		return buildTilePair(pos, type);
+	}
 
+	// Bulk createTilePair() for loading whole worlds (see scenarioSetup.h).  Same world as calling createTilePair()
+	// for each create edit in order, but taken positions are a hash lookup instead of a scan over every tile, and
+	// so are the nodes getConnectedTiles() looks for.  Returns how many pairs it made.
+	int createTilePairs(const std::vector<WorldEdit>& edits)
+	{
+		// All in order on the calling thread: every pair links up with the ones built before it, and the keys are
+		// too cheap to be worth handing out to the job system.
+		std::unordered_set<uint64_t> taken;
+		taken.reserve(tiles.size() + edits.size());
+		for (Tile& t : tiles) {
+			if (t.index != -1) taken.insert(positionKey(nodes[t.centerNodeIndex]->getPosition()));
+		}
+		nodesAtPosition.clear();
+		for (TileNode* n : nodes) if (n != nullptr) indexNodePosition(n);
+		tiles.reserve(tiles.size() + 2 * edits.size());
+		bulkBuilding = true;
+
+		int numCreated = 0;
+		for (const WorldEdit& e : edits) {
+			if (e.type != WORLD_EDIT_CREATE_TILE_PAIR || !taken.insert(positionKey(e.pos)).second) continue;
+			buildTilePair(e.pos, e.superTileType);
+			numCreated++;
+		}
+
+		bulkBuilding = false;
+		nodesAtPosition.clear();
+		return numCreated;
+	}
+
+	// createTilePair() without checking whether there's a tile at pos already:
+	Tile* buildTilePair(glm::vec3 pos, SuperTileType type)
+	{
 		// create the new tile pair and center nodes:
 		// indices are used because apparently pointers are unsafe if the vector resizes itself.
 		TileType frontType = tnav::getTileType(type, true);
@@ -472,6 +800,9 @@ public:
 		reconnectTile(tiles[newFrontTileIndex]);
 		reconnectTile(tiles[newBackTileIndex]);
 
+		bvh.setTile(newFrontTileIndex, getTileBounds(tiles[newFrontTileIndex]));
+		bvh.setTile(newBackTileIndex, getTileBounds(tiles[newBackTileIndex]));
+
 		checkCornerConnections();
 
 		return &tiles[newFrontTileIndex];
@@ -727,6 +1058,7 @@ public:
 
 	void reconnectTile(Tile& tile)
 	{
+		gpuTilesDirty = true;
 		CenterNode* centerNode = static_cast<CenterNode*>(nodes[tile.centerNodeIndex]);
 		for (LocalDirection d : tnav::ORTHOGONAL_DIRECTION_SET) {
 			MapType m = getSecondNeighborMap(*centerNode, d);
@@ -0,0 +1,36 @@
+#pragma once
+#include <atomic>
+
+// One writer thread hands the newest T to one reader thread without either ever waiting on the other.
+// The writer fills writeSlot() then publish()es it, the reader calls update() and then read()s.  If the writer
+// publishes twice before the reader looks, the older one is just dropped.
+template <typename T>
+struct TripleBuffer {
+	T slots[3];
+
+private:
+	static const int INDEX_MASK = 0x3;
+	static const int NEW_BIT = 0x4; // set on latest until the reader takes it.
+
+	std::atomic<int> latest{ 0 }; // the slot that's neither being written nor read.
+	int writeIndex = 1;
+	int readIndex = 2;
+
+public:
+	T& writeSlot() { return slots[writeIndex]; }
+
+	void publish()
+	{
+		writeIndex = latest.exchange(writeIndex | NEW_BIT, std::memory_order_acq_rel) & INDEX_MASK;
+	}
+
+	// Swaps in the newest published slot, if there's one the reader hasn't seen.
+	bool update()
+	{
+		if ((latest.load(std::memory_order_relaxed) & NEW_BIT) == 0) return false;
+		readIndex = latest.exchange(readIndex, std::memory_order_acq_rel) & INDEX_MASK;
+		return true;
+	}
+
+	const T& read() const { return slots[readIndex]; }
+};
@@ -157,7 +157,7 @@ bool vechelp::isLeft(glm::vec2 point, glm::vec2 lineSegPoint1, glm::vec2 lineSeg
 }
 
 // Checking if a point is inside a polygon
-bool vechelp::point_in_polygon(glm::vec2 point, std::vector<glm::vec2> polygon)
+bool vechelp::point_in_polygon(glm::vec2 point, const std::vector<glm::vec2>& polygon)
 {
 
 	int num_vertices = (int)polygon.size();
@@ -276,14 +276,15 @@ bool vechelp::doIntersect(glm::vec2 p1, glm::vec2 q1, glm::vec2 p2, glm::vec2 q2
 
 // Crops subjectPoly to cropToPoly.  Both need to be wound clockwise!
 bool vechelp::cropFrustumToFrustum(std::vector<glm::vec2>& subjectPoly,
-								 std::vector<glm::vec2> cropToPoly)
+								 const std::vector<glm::vec2>& cropToPoly)
 {
 	if (cropToPoly.size() < 3) {
 		subjectPoly.clear();
 		return false;
 	}
 
-	glm::vec2* cropToP1, * cropToP2, * inputP1, * inputP2;
+	const glm::vec2* cropToP1, * cropToP2;
+	glm::vec2* inputP1, * inputP2;
 	std::vector<glm::vec2> croppedPoly;
 	std::vector<glm::vec2>* inputPoly = &subjectPoly;
 	std::vector<glm::vec2>* outputPoly = &croppedPoly;
@@ -405,7 +406,7 @@ bool vechelp::cropTileToFrustum(std::vector<glm::vec2>& subjectPolyVerts,
 
 
 // Crops subjectPoly to cropToPoly.  Both need to be wound clockwise!
-bool vechelp::sutherlandHodgemanPolyCrop(std::vector<glm::vec2>& subjectPoly, std::vector<glm::vec2> cropToPoly,
+bool vechelp::sutherlandHodgemanPolyCrop(std::vector<glm::vec2>& subjectPoly, const std::vector<glm::vec2>& cropToPoly,
 									   bool removeDuplicatePoints)
 {
 	if (cropToPoly.size() < 2) {
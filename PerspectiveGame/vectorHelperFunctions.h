@@ -80,7 +80,7 @@ namespace vechelp {
 	}
 
 	// Checking if a point is inside a polygon
-	bool point_in_polygon(glm::vec2 point, std::vector<glm::vec2> polygon);
+	bool point_in_polygon(glm::vec2 point, const std::vector<glm::vec2>& polygon);
 
 	float getVecAngle(glm::vec2 vec);
 
@@ -108,7 +108,7 @@ namespace vechelp {
 
 	// Crops subjectPoly to cropToPoly.  Both need to be wound clockwise!
 	bool cropFrustumToFrustum(std::vector<glm::vec2>& subjectPoly,
-									 std::vector<glm::vec2> cropToPoly);
+									 const std::vector<glm::vec2>& cropToPoly);
 
 	// Crops subjectPoly to cropToPoly.  Both need to be wound clockwise!
 	bool cropTileToFrustum(std::vector<glm::vec2>& subjectPolyVerts,
@@ -116,7 +116,8 @@ namespace vechelp {
 								  glm::vec2 cropToPoly[3]);
 
 	// Crops subjectPoly to cropToPoly.  Both need to be wound clockwise!
-	bool sutherlandHodgemanPolyCrop(std::vector<glm::vec2>& subjectPoly, std::vector<glm::vec2> cropToPoly,
+	// Allocates for every call, see polygonClip.h for the versions that don't (and do many polygons at once).
+	bool sutherlandHodgemanPolyCrop(std::vector<glm::vec2>& subjectPoly, const std::vector<glm::vec2>& cropToPoly,
 								   bool removeDuplicatePoints);
 
 	std::vector<glm::vec2> sutherlandHodgemanLineCrop(std::vector<glm::vec2> subjectPoly, std::vector<glm::vec2>* cropToLine,
@@ -5,6 +5,7 @@
 #include"dependancyHeaders.h"
 
 #include"shaderManager.h"
+#include"memoryAccounting.h"
 
 extern std::vector<GLfloat> verts;
 extern std::vector<GLuint> indices;
@@ -24,7 +25,10 @@ struct VertexManager {
 	VertexManager() {}
 	~VertexManager() {
 		glDeleteVertexArrays(1, &vertArrayObj);
+		GlobalGlBufferMemory.remove(vertBuffObj);
+		GlobalGlBufferMemory.remove(elementBuffObj);
 		glDeleteBuffers(1, &vertBuffObj);
+		glDeleteBuffers(1, &elementBuffObj);
 	}
 
 	void init(ShaderManager* shaderManager) {
@@ -36,11 +40,13 @@ struct VertexManager {
 		glGenBuffers(1, &vertBuffObj);
 		glBindBuffer(GL_ARRAY_BUFFER, vertBuffObj);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(float) * verts.size(), verts.data(), GL_STATIC_DRAW);
+		GlobalGlBufferMemory.set(vertBuffObj, sizeof(float) * verts.size());
 
 		setVertAttribVec3PosVec3NormVec3ColorVec2TextCoord();
 
 		glGenBuffers(1, &elementBuffObj);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementBuffObj);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), indices.data(), GL_STATIC_DRAW);
+		GlobalGlBufferMemory.set(elementBuffObj, sizeof(unsigned int) * indices.size());
 	}
 };
\ No newline at end of file
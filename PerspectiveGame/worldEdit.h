@@ -0,0 +1,49 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#include "tileNavigation.h"
+
+enum WorldEditType {
+	WORLD_EDIT_CREATE_TILE_PAIR,
+	WORLD_EDIT_REMOVE_TILE_PAIR,
+};
+
+// A change to the node network asked for on the input thread and done on the simulation thread (see Simulation).
+// Only holds indices and positions, never pointers, since the world can change between the two.
+struct WorldEdit {
+	WorldEditType type;
+	glm::vec3 pos = glm::vec3(0);          // create only.
+	SuperTileType superTileType = TILE_TYPE_XY; // create only.
+	int tileIndex = -1;                    // remove only.
+
+	static WorldEdit createTilePair(glm::vec3 pos, SuperTileType type)
+	{
+		WorldEdit e;
+		e.type = WORLD_EDIT_CREATE_TILE_PAIR;
+		e.pos = pos;
+		e.superTileType = type;
+		return e;
+	}
+
+	static WorldEdit removeTilePair(int tileIndex)
+	{
+		WorldEdit e;
+		e.type = WORLD_EDIT_REMOVE_TILE_PAIR;
+		e.tileIndex = tileIndex;
+		return e;
+	}
+};
+
+// Center of the tile pair on lattice cell (i, j, k), the cube above the XY tile at (i, j, k): its bottom (XY), its
+// -y side (XZ) or its -x side (YZ).  The constructor's first tile is the bottom of cell (0, 0, 0).
+inline glm::vec3 latticeTilePos(SuperTileType type, int i, int j, int k)
+{
+	switch (type) {
+	case TILE_TYPE_XZ: return glm::vec3(i, j - 0.5f, k + 0.5f);
+	case TILE_TYPE_YZ: return glm::vec3(i - 0.5f, j, k + 0.5f);
+	default: return glm::vec3(i, j, k);
+	}
+}